@@ -0,0 +1,146 @@
+#include "test.h"
+#include "render/renderQueue.h"
+#include "bounding/boundsArray.h"
+#include "util/jobSystem.h"
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// Every operator new of the test program counts, so vectors, std::function & job queues show up
+static std::atomic<uint> GlobalAllocations(0);
+
+void* operator new(size_t size) {
+	GlobalAllocations++;
+	void* p = malloc(size > 0 ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size) {
+	GlobalAllocations++;
+	void* p = malloc(size > 0 ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	free(p);
+}
+
+#define ARENA_TEST_MESHES 32
+#define ARENA_TEST_CHUNK 1024 // Boxes one cull job takes
+
+// Instance indices of one mesh, taken from arena at first visible object like InstanceData
+struct MeshIndices {
+	uint* indices;
+	int count, maxCount;
+};
+
+// Frame data prepare builds each frame: cull masks, node queues & per mesh instance lists
+struct ArenaFrame {
+	FrameArena* arena;
+	Queue* queue;
+	Queue* animQueue;
+	std::vector<MeshIndices> meshes;
+};
+
+static void SetupFrustum(Frustum* frustum) {
+	vec3 eye(0, 10, 0), center(100, 10, 100);
+	mat4 viewProject = perspective(60, 16.0 / 9.0, 1, 1000) * lookAt(eye, center, vec3(0, 1, 0));
+	frustum->update(viewProject.GetInverse(), (center - eye).GetNormalized());
+}
+
+// Same steps as RenderManager::prepareFrame on its frame data: flush, reset, cull & gather
+static void PrepareArenaFrame(ArenaFrame* frame, const Frustum* frustum, const BoundsArray* bounds, std::vector<Node*>& nodes) {
+	frame->queue->flush();
+	frame->animQueue->flush();
+	for (uint m = 0; m < frame->meshes.size(); m++) {
+		frame->meshes[m].count = 0;
+		frame->meshes[m].indices = NULL;
+	}
+	frame->arena->reset();
+
+	uint* masks = frame->arena->allocArray<uint>(bounds->count);
+	memset(masks, 0, bounds->count * sizeof(uint));
+	uint chunks = (bounds->count + ARENA_TEST_CHUNK - 1) / ARENA_TEST_CHUNK;
+	JobSystem::jobSystem->parallelFor(chunks, 1, [&](uint begin, uint end) {
+		for (uint c = begin; c < end; c++) {
+			int first = c * ARENA_TEST_CHUNK;
+			int last = first + ARENA_TEST_CHUNK < bounds->count ? first + ARENA_TEST_CHUNK : bounds->count;
+			CullBoxes(frustum, bounds, first, last, 1, masks);
+		}
+	});
+
+	for (int i = 0; i < bounds->count; i++) {
+		if (!(masks[i] & 1)) continue;
+		if (i & 7) frame->queue->push(nodes[i]);
+		else frame->animQueue->push(nodes[i]);
+		MeshIndices& mesh = frame->meshes[i % ARENA_TEST_MESHES];
+		if (!mesh.indices) mesh.indices = frame->arena->allocArray<uint>(mesh.maxCount);
+		if (mesh.count < mesh.maxCount) mesh.indices[mesh.count++] = i;
+	}
+}
+
+// Once the same layout has been culled from the same view for a while,
+//   a frame must not reach heap through the arena or anything else
+void TestFrameArena() {
+	JobSystem::Init();
+	const int boxCount = 50000, frames = 120, warmFrames = 8;
+	std::vector<AABB*> boxes;
+	std::vector<Node*> nodes;
+	BoundsArray bounds(boxCount);
+	unsigned int seed = 5;
+	for (int i = 0; i < boxCount; i++) {
+		vec3 center(TestRandom(seed, -500, 500), TestRandom(seed, -20, 40), TestRandom(seed, -500, 500));
+		boxes.push_back(new AABB(center, TestRandom(seed, 1, 20), TestRandom(seed, 1, 20), TestRandom(seed, 1, 20)));
+		bounds.add(boxes.back());
+		nodes.push_back((Node*)(size_t)(i + 1)); // Queues only keep the pointers
+	}
+	Frustum frustum;
+	SetupFrustum(&frustum);
+
+	// Double buffered like frames of RenderManager, arenas start small so they have to grow
+	ArenaFrame frameData[2];
+	for (int f = 0; f < 2; f++) {
+		frameData[f].arena = new FrameArena(4096);
+		frameData[f].queue = new Queue(0, frameData[f].arena);
+		frameData[f].animQueue = new Queue(0, frameData[f].arena);
+		frameData[f].meshes.resize(ARENA_TEST_MESHES);
+		for (int m = 0; m < ARENA_TEST_MESHES; m++) {
+			frameData[f].meshes[m].indices = NULL;
+			frameData[f].meshes[m].count = 0;
+			frameData[f].meshes[m].maxCount = boxCount / ARENA_TEST_MESHES + 1;
+		}
+	}
+
+	uint visible = 0, arenaAllocations = 0, globalAllocations = 0;
+	for (int f = 0; f < frames; f++) {
+		ArenaFrame* frame = &frameData[f & 1];
+		uint arenaBefore = frame->arena->getHeapAllocations();
+		uint globalBefore = GlobalAllocations.load();
+		PrepareArenaFrame(frame, &frustum, &bounds, nodes);
+		if (f >= warmFrames) {
+			arenaAllocations += frame->arena->getHeapAllocations() - arenaBefore;
+			globalAllocations += GlobalAllocations.load() - globalBefore;
+		}
+		if (f == 0) visible = frame->queue->size + frame->animQueue->size;
+		else CHECK(frame->queue->size + frame->animQueue->size == (int)visible);
+	}
+	CHECK(visible > 0 && visible < (uint)boxCount);
+	CHECK(frameData[0].arena->getUsed() <= frameData[0].arena->getCapacity());
+	CHECK(arenaAllocations == 0);
+	CHECK(globalAllocations == 0);
+
+	for (int f = 0; f < 2; f++) {
+		delete frameData[f].queue;
+		delete frameData[f].animQueue;
+		delete frameData[f].arena;
+	}
+	for (uint i = 0; i < boxes.size(); i++) delete boxes[i];
+}
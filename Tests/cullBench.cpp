@@ -0,0 +1,128 @@
+#include "test.h"
+#include "bounding/bvh.h"
+#include "util/util.h"
+
+static const int BenchBoxCount = 100000;
+
+static void SetupFrustum(Frustum* frustum) {
+	vec3 eye(0, 10, 0), center(0, 10, 100);
+	mat4 viewProject = perspective(60, 16.0 / 9.0, 1, 1000) * lookAt(eye, center, vec3(0, 1, 0));
+	frustum->update(viewProject.GetInverse(), (center - eye).GetNormalized());
+}
+
+// Boxes scattered around the camera, roughly 1/6 of them inside the frustum
+static void CreateBoxes(int count, std::vector<AABB*>& boxes, BoundsArray* bounds) {
+	unsigned int seed = 12345;
+	for (int i = 0; i < count; i++) {
+		vec3 center(TestRandom(seed, -1000, 1000), TestRandom(seed, -50, 70), TestRandom(seed, -1000, 1000));
+		float size = TestRandom(seed, 0.5, 40);
+		AABB* box = new AABB(center, size, TestRandom(seed, 0.5, 40), size);
+		boxes.push_back(box);
+		bounds->add(box);
+	}
+}
+
+static void DeleteBoxes(std::vector<AABB*>& boxes) {
+	for (uint i = 0; i < boxes.size(); i++)
+		delete boxes[i];
+	boxes.clear();
+}
+
+void TestCullBoxes() {
+	Frustum frustum;
+	SetupFrustum(&frustum);
+	std::vector<AABB*> boxes;
+	BoundsArray bounds(1024);
+	CreateBoxes(10000, boxes, &bounds);
+
+	// Odd ranges exercise the scalar tail after 4 or 8 wide batches
+	bounds.clearMasks();
+	CullBoxes(&frustum, &bounds, 0, 3, 1);
+	CullBoxes(&frustum, &bounds, 3, bounds.count, 1);
+	CullBoxes(&frustum, &bounds, 0, bounds.count, 2);
+
+	int kept = 0;
+	for (int i = 0; i < bounds.count; i++) {
+		BoundingBox* box = boxes[i];
+		bool corner = box->checkWithCamera(&frustum, 1);
+		bool exact = box->checkWithCamera(&frustum, 2);
+		bool plane = (bounds.masks[i] & 1) != 0;
+		// Plane test is conservative: it keeps every box the corner or exact test keeps
+		if (corner) CHECK(plane);
+		if (exact) CHECK(plane);
+		CHECK(((bounds.masks[i] >> 1) & 1) == (bounds.masks[i] & 1));
+		if (plane) kept++;
+	}
+	CHECK(kept > 0 && kept < bounds.count);
+	DeleteBoxes(boxes);
+}
+
+// Two culls over one tree keep separate results, both same as culling every box
+void TestBvhCull() {
+	Frustum frustum;
+	SetupFrustum(&frustum);
+	std::vector<AABB*> boxes;
+	BoundsArray bounds(1024);
+	CreateBoxes(10000, boxes, &bounds);
+	BVH bvh;
+	bvh.build(&bounds);
+
+	BvhCull first, second;
+	first.reserve(bvh.getBoxCount());
+	second.reserve(bvh.getBoxCount());
+	bvh.cull(&frustum, 1, &first);
+	bvh.collectAll(2, &second);
+
+	bounds.clearMasks();
+	CullBoxes(&frustum, &bounds, 0, bounds.count, 1);
+	int expected = 0;
+	for (int i = 0; i < bounds.count; i++) {
+		CHECK(first.masks[i] == bounds.masks[i]);
+		CHECK(second.masks[i] == 2);
+		expected += bounds.masks[i];
+	}
+	CHECK(first.visibleCount == expected);
+	CHECK(second.visibleCount == bounds.count);
+
+	first.reset();
+	for (int i = 0; i < bounds.count; i++)
+		CHECK(first.masks[i] == 0);
+	DeleteBoxes(boxes);
+}
+
+void BenchCullBoxes() {
+	Frustum frustum;
+	SetupFrustum(&frustum);
+	std::vector<AABB*> boxes;
+	BoundsArray bounds(BenchBoxCount);
+	CreateBoxes(BenchBoxCount, boxes, &bounds);
+
+	const int rounds = 20;
+	int keptOld = 0, keptNew = 0;
+
+	// Old path: virtual call on each heap allocated box, corner test
+	TestTime start = TestNow();
+	for (int r = 0; r < rounds; r++) {
+		keptOld = 0;
+		for (uint i = 0; i < boxes.size(); i++) {
+			BoundingBox* box = boxes[i];
+			if (box->checkWithCamera(&frustum, 1)) keptOld++;
+		}
+	}
+	double oldMs = ElapsedMs(start) / rounds;
+
+	// New path: center/extent arrays, several boxes per iteration
+	start = TestNow();
+	for (int r = 0; r < rounds; r++) {
+		bounds.clearMasks();
+		CullBoxes(&frustum, &bounds, 0, bounds.count, 1);
+		keptNew = 0;
+		for (int i = 0; i < bounds.count; i++)
+			keptNew += bounds.masks[i] & 1;
+	}
+	double newMs = ElapsedMs(start) / rounds;
+
+	printf("  %d boxes, per box AABB: %.3f ms (%d kept), CullBoxes: %.3f ms (%d kept), %.1fx\n",
+		BenchBoxCount, oldMs, keptOld, newMs, keptNew, oldMs / newMs);
+	DeleteBoxes(boxes);
+}
@@ -0,0 +1,92 @@
+#include "test.h"
+#include "referenceCulling.h"
+#include "util/util.h"
+
+static void RandomFrustum(unsigned int& seed, Frustum* frustum, vec3& eye, float& zFar) {
+	eye = vec3(TestRandom(seed, -100, 100), TestRandom(seed, -20, 50), TestRandom(seed, -100, 100));
+	vec3 lookDir(TestRandom(seed, -1, 1), TestRandom(seed, -0.7, 0.7), TestRandom(seed, -1, 1));
+	if (lookDir.GetLength() < 0.1) lookDir = vec3(0, 0, 1);
+	lookDir.Normalize();
+	float zNear = TestRandom(seed, 0.5, 5);
+	zFar = TestRandom(seed, 50, 500);
+	mat4 viewProject = perspective(TestRandom(seed, 30, 90), TestRandom(seed, 1, 2), zNear, zFar) *
+		lookAt(eye, eye + lookDir, vec3(0, 1, 0));
+	frustum->update(viewProject.GetInverse(), lookDir);
+}
+
+// Box sizes from a fraction of a unit up to larger than the whole frustum
+static void RandomBox(unsigned int& seed, const vec3& eye, float zFar, vec3& center, vec3& halfSize) {
+	center = eye + vec3(TestRandom(seed, -1, 1), TestRandom(seed, -1, 1), TestRandom(seed, -1, 1)) * zFar * 1.2;
+	float scale = powf(10, TestRandom(seed, -1, 2.7));
+	halfSize = vec3(TestRandom(seed, 0.1, 1), TestRandom(seed, 0.1, 1), TestRandom(seed, 0.1, 1)) * scale;
+}
+
+void TestSeparatingAxis() {
+	unsigned int seed = 7;
+	const int frustumCount = 200, boxCount = 2000;
+	const float epsilon = 0.01;
+	int visible = 0, missedByReference = 0, total = frustumCount * boxCount;
+
+	for (int f = 0; f < frustumCount; f++) {
+		Frustum frustum;
+		vec3 eye; float zFar;
+		RandomFrustum(seed, &frustum, eye, zFar);
+
+		for (int b = 0; b < boxCount; b++) {
+			vec3 center, halfSize;
+			RandomBox(seed, eye, zFar, center, halfSize);
+			vec3 grown = halfSize + vec3(epsilon, epsilon, epsilon);
+			vec3 shrunk = halfSize - vec3(epsilon, epsilon, epsilon);
+
+			bool reference = ReferenceCheckWithCamera(&frustum, center - halfSize, center + halfSize, 4);
+			int exact = BoxIntersectsFrustum(&frustum, center, halfSize, 2);
+
+			// Corner level is unchanged
+			CHECK(ReferenceCheckWithCamera(&frustum, center - halfSize, center + halfSize, 1) ==
+				(BoxIntersectsFrustum(&frustum, center, halfSize, 1) != FRUSTUM_OUTSIDE));
+			// Everything the ray tests find is a real overlap, the exact test must keep it
+			if (reference) CHECK(BoxIntersectsFrustum(&frustum, center, grown, 2) != FRUSTUM_OUTSIDE);
+			// Inside means every corner is inside
+			if (exact == FRUSTUM_INSIDE) CHECK(BoxIntersectsFrustum(&frustum, center, shrunk, 1) == FRUSTUM_INSIDE);
+
+			if (exact != FRUSTUM_OUTSIDE) {
+				visible++;
+				// Rays skip some edges, so they may miss an overlap the exact test finds
+				if (!ReferenceCheckWithCamera(&frustum, center - grown, center + grown, 4)) missedByReference++;
+			}
+		}
+	}
+
+	printf("  %d boxes, %d visible, %d overlaps missed by ray tests\n", total, visible, missedByReference);
+	CHECK(visible > total / 20 && visible < total - total / 20);
+	CHECK(missedByReference * 100 < visible);
+}
+
+void BenchSeparatingAxis() {
+	unsigned int seed = 11;
+	const int frustumCount = 50, boxCount = 20000;
+	std::vector<vec3> centers(boxCount), halfSizes(boxCount);
+	double referenceMs = 0, exactMs = 0;
+	int referenceKept = 0, exactKept = 0;
+
+	for (int f = 0; f < frustumCount; f++) {
+		Frustum frustum;
+		vec3 eye; float zFar;
+		RandomFrustum(seed, &frustum, eye, zFar);
+		for (int b = 0; b < boxCount; b++)
+			RandomBox(seed, eye, zFar, centers[b], halfSizes[b]);
+
+		TestTime start = TestNow();
+		for (int b = 0; b < boxCount; b++)
+			referenceKept += ReferenceCheckWithCamera(&frustum, centers[b] - halfSizes[b], centers[b] + halfSizes[b], 4);
+		referenceMs += ElapsedMs(start);
+
+		start = TestNow();
+		for (int b = 0; b < boxCount; b++)
+			exactKept += BoxIntersectsFrustum(&frustum, centers[b], halfSizes[b], 2) != FRUSTUM_OUTSIDE;
+		exactMs += ElapsedMs(start);
+	}
+
+	printf("  %d boxes, ray tests level 4: %.2f ms (%d kept), separating axis: %.2f ms (%d kept), %.1fx\n",
+		frustumCount * boxCount, referenceMs, referenceKept, exactMs, exactKept, referenceMs / exactMs);
+}
@@ -0,0 +1,82 @@
+#include "test.h"
+#include "util/jobSystem.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+void TestJobSystem() {
+	JobSystem::Init();
+	JobSystem* jobs = JobSystem::jobSystem;
+
+	// More live jobs than a ring chunk holds, the ring grows instead of reusing them
+	std::atomic<int> done(0);
+	Job* group = jobs->create(JobFunc());
+	const int count = JOB_RING_SIZE * 2 + 10;
+	for (int i = 0; i < count; i++)
+		jobs->submit(jobs->create([&done]() { done++; }, group));
+	jobs->submit(group);
+	jobs->wait(group);
+	CHECK(done.load() == count);
+
+	// Threads outside the system create, submit & wait too
+	std::atomic<int> sum(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 3; t++) {
+		threads.push_back(std::thread([jobs, &sum]() {
+			for (int r = 0; r < 50; r++) {
+				Job* parent = jobs->create(JobFunc());
+				for (int i = 0; i < 20; i++)
+					jobs->submit(jobs->create([&sum]() { sum++; }, parent));
+				jobs->submit(parent);
+				jobs->wait(parent);
+			}
+			jobs->parallelFor(1000, 10, [&sum](uint begin, uint end) { sum += end - begin; });
+		}));
+	}
+	for (uint t = 0; t < threads.size(); t++)
+		threads[t].join();
+	CHECK(sum.load() == 3 * (50 * 20 + 1000));
+
+	// Fine grained ranges, as culling of visible leaves uses, each run once
+	std::vector<int> hits(5000, 0);
+	jobs->parallelFor(hits.size(), 4, [&hits](uint begin, uint end) {
+		for (uint i = begin; i < end; i++) hits[i]++;
+	});
+	int wrong = 0;
+	for (uint i = 0; i < hits.size(); i++) 
+		if (hits[i] != 1) wrong++;
+	CHECK(wrong == 0);
+
+	// A long job submitted from worker 0, as the frame job from the draw thread, is not run
+	//   by worker 0 while it waits for other jobs, even with every worker thread busy
+	std::atomic<int> blocked(0);
+	std::atomic<bool> release(false);
+	Job* blockers = jobs->create(JobFunc());
+	for (uint i = 1; i < jobs->getWorkerCount(); i++) {
+		jobs->submit(jobs->create([&blocked, &release]() {
+			blocked++;
+			while (!release.load()) std::this_thread::yield();
+		}, blockers));
+	}
+	jobs->submit(blockers);
+	while (blocked.load() < (int)jobs->getWorkerCount() - 1) std::this_thread::yield();
+
+	std::thread::id longThread;
+	Job* longJob = jobs->create([&longThread]() { longThread = std::this_thread::get_id(); });
+	jobs->submitLong(longJob);
+	Job* gate = jobs->create(JobFunc());
+	Job* late = jobs->create(JobFunc(), gate);
+	jobs->submit(gate);
+	std::thread submitter([jobs, late]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(30));
+		jobs->submit(late);
+	});
+	jobs->wait(gate);
+	submitter.join();
+	release = true;
+	jobs->wait(longJob);
+	jobs->wait(blockers);
+	CHECK(longThread != std::this_thread::get_id());
+
+	JobSystem::Release();
+}
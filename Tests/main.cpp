@@ -0,0 +1,50 @@
+#include "test.h"
+#include <string.h>
+
+int TestFailures = 0;
+
+struct TestCase {
+	const char* name;
+	void (*func)();
+	bool bench;
+};
+
+static TestCase cases[] = {
+	{ "CullBoxes", TestCullBoxes, false },
+	{ "CullBoxes", BenchCullBoxes, true },
+	{ "BvhCull", TestBvhCull, false },
+	{ "SeparatingAxis", TestSeparatingAxis, false },
+	{ "SeparatingAxis", BenchSeparatingAxis, true },
+	{ "Pool", TestPool, false },
+	{ "Pool", BenchPool, true },
+	{ "InstanceRecord", TestInstanceRecord, false },
+	{ "InstanceRecord", BenchInstanceRecord, true },
+	{ "JobSystem", TestJobSystem, false },
+	{ "FramePipeline", BenchFramePipeline, true },
+	{ "SlotMap", TestSlotMap, false },
+	{ "FrameArena", TestFrameArena, false },
+	{ "RadixSort", TestRadixSort, false },
+	{ "SceneCommandQueue", TestSceneCommandQueue, false },
+	{ "UpdateSelect", TestUpdateSelect, false },
+	{ "Simplifier", TestSimplifier, false },
+	{ "MeshOptimizer", TestMeshOptimizer, false },
+	{ "ModelWeld", TestModelWeld, false },
+	{ "ObjParse", TestObjParse, false },
+};
+
+int main(int argc, char** argv) {
+	bool bench = argc > 1 && strcmp(argv[1], "bench") == 0;
+	const char* filter = argc > 2 ? argv[2] : NULL;
+
+	int count = sizeof(cases) / sizeof(TestCase);
+	for (int i = 0; i < count; i++) {
+		if (cases[i].bench != bench) continue;
+		if (filter && !strstr(cases[i].name, filter)) continue;
+		printf("%s %s\n", bench ? "bench" : "test", cases[i].name);
+		cases[i].func();
+	}
+
+	if (TestFailures > 0) printf("%d checks failed\n", TestFailures);
+	else printf("all passed\n");
+	return TestFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,74 @@
+#include "test.h"
+#include "mesh/meshOptimizer.h"
+#include <algorithm>
+#include <vector>
+
+// Row by row grid, rows longer than the cache miss most shared vertices
+static void CreateGrid(int width, int height, std::vector<int>& indices, std::vector<vec3>& positions) {
+	for (int j = 0; j <= height; j++)
+		for (int i = 0; i <= width; i++)
+			positions.push_back(vec3((float)i, 0, (float)j));
+	for (int j = 0; j < height; j++) {
+		for (int i = 0; i < width; i++) {
+			int v = j * (width + 1) + i;
+			int quad[6] = { v, v + width + 1, v + 1, v + 1, v + width + 1, v + width + 2 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+// Triangles rotated to start at their lowest index, so order changes but winding does not
+static std::vector<std::vector<int> > TriangleSet(const std::vector<int>& indices) {
+	std::vector<std::vector<int> > triangles;
+	for (uint t = 0; t < indices.size(); t += 3) {
+		int first = 0;
+		for (int k = 1; k < 3; k++)
+			if (indices[t + k] < indices[t + first]) first = k;
+		std::vector<int> tri(3);
+		for (int k = 0; k < 3; k++) tri[k] = indices[t + (first + k) % 3];
+		triangles.push_back(tri);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+void TestMeshOptimizer() {
+	std::vector<int> indices;
+	std::vector<vec3> positions;
+	CreateGrid(64, 64, indices, positions);
+	int vertexCount = positions.size();
+	std::vector<int> original = indices;
+
+	CacheStats before = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount, MESH_CACHE_SIZE);
+	std::vector<int> clusters;
+	OptimizeVertexCache(indices.data(), indices.size(), vertexCount, MESH_CACHE_SIZE, &clusters);
+	CacheStats after = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount, MESH_CACHE_SIZE);
+	CHECK(after.acmr <= before.acmr);
+	CHECK(after.atvr <= before.atvr);
+	CHECK(after.acmr < 0.8); // Grid ideal is 0.5, row order is about 1
+	CHECK(clusters.size() > 0);
+
+	// Same triangles, same windings, only their order changed
+	std::vector<int> sortedBefore = original, sortedAfter = indices;
+	std::sort(sortedBefore.begin(), sortedBefore.end());
+	std::sort(sortedAfter.begin(), sortedAfter.end());
+	CHECK(sortedBefore == sortedAfter);
+	CHECK(TriangleSet(original) == TriangleSet(indices));
+
+	// Overdraw order moves whole clusters, cache order of each stays
+	std::vector<int> cached = indices;
+	OptimizeOverdraw(indices.data(), indices.size(), positions.data(), clusters);
+	CHECK(TriangleSet(cached) == TriangleSet(indices));
+
+	// Fetch order renumbers vertices by first use, remap turns old triangles into new ones
+	std::vector<int> renumbered = indices, remap;
+	OptimizeVertexFetch(renumbered.data(), renumbered.size(), vertexCount, remap);
+	bool firstUse = true, mapped = true;
+	int next = 0;
+	for (uint i = 0; i < renumbered.size(); i++) {
+		if (renumbered[i] > next) firstUse = false;
+		if (renumbered[i] == next) next++;
+		if (renumbered[i] != remap[indices[i]]) mapped = false;
+	}
+	CHECK(firstUse && mapped && next == vertexCount);
+}
@@ -0,0 +1,223 @@
+#include "test.h"
+#include "model/objloader.h"
+#include "model/textParser.h"
+#include "util/jobSystem.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#define PARSE_TEST_OBJ "parseTest.obj"
+#define PARSE_TEST_VT 2
+
+// Floats equal to what strtof gives, within an ulp or so
+static bool NearFloat(float value, float expected) {
+	return fabs(value - expected) <= fabs(expected) * 2.5e-7f;
+}
+
+static bool ParsesAs(const char* text, float expected, int used) {
+	const char* end = text + strlen(text);
+	float value = -12345.0f;
+	const char* p = ParseFloat(text, end, value);
+	return p == text + used && NearFloat(value, expected);
+}
+
+// Number in one of the forms obj exporters write
+static void PrintNumber(std::string& out, unsigned int& seed) {
+	char buf[64];
+	float x = TestRandom(seed, -100, 100);
+	switch ((int)TestRandom(seed, 0, 6)) {
+	case 0: snprintf(buf, sizeof(buf), "%d", (int)x); break;
+	case 1: snprintf(buf, sizeof(buf), "%.6f", x); break;
+	case 2: snprintf(buf, sizeof(buf), "%.4e", x * 1e-7f); break;
+	case 3: snprintf(buf, sizeof(buf), "%.3E", x * 1e12f); break;
+	case 4: snprintf(buf, sizeof(buf), "%.22f", x * 0.01f); break;
+	default: snprintf(buf, sizeof(buf), "+%.2f", fabs(x)); break;
+	}
+	out += buf;
+	out += ' ';
+}
+
+// Corner with random form, negative indices count back from what was read so far
+static void PrintCorner(std::string& out, unsigned int& seed, const std::vector<size_t>& offsets, int form, bool& farBack) {
+	char buf[64];
+	int vs = offsets.size(), vts = vs, vns = vs;
+	int v = (int)TestRandom(seed, 0, (float)vs), vt = (int)TestRandom(seed, 0, (float)vts), vn = (int)TestRandom(seed, 0, (float)vns);
+	bool relative = TestRandom(seed, 0, 1) < 0.5f;
+	int iv = relative ? v - vs : v + 1, ivt = relative ? vt - vts : vt + 1, ivn = relative ? vn - vns : vn + 1;
+	if (relative && out.size() - offsets[v] > OBJ_CHUNK_SIZE) farBack = true; // Into a chunk before
+	switch (form) {
+	case 0: snprintf(buf, sizeof(buf), "%d ", iv); break;
+	case 1: snprintf(buf, sizeof(buf), "%d/%d ", iv, ivt); break;
+	case 2: snprintf(buf, sizeof(buf), "%d//%d ", iv, ivn); break;
+	default: snprintf(buf, sizeof(buf), "%d/%d/%d ", iv, ivt, ivn); break;
+	}
+	out += buf;
+}
+
+// Several chunks of text, usemtl far apart so most chunks start with faces of a material set before them
+static std::string CreateObjText(bool& farBack) {
+	unsigned int seed = 31;
+	std::string out = "# parse test\n";
+	static const char* names[] = { "stone", "wood", "metal" };
+	std::vector<size_t> offsets; // Of each v line
+	farBack = false;
+	for (int block = 0; out.size() < OBJ_CHUNK_SIZE * 5; block++) {
+		if (block > 0 && block % 4 == 0) {
+			out += "usemtl ";
+			out += names[(block / 4 - 1) % 3];
+			out += "\n";
+		}
+		for (int i = 0; i < 100; i++) {
+			offsets.push_back(out.size());
+			out += "v ";
+			for (int k = 0; k < 3; k++) PrintNumber(out, seed);
+			out += "\nvt ";
+			for (int k = 0; k < PARSE_TEST_VT; k++) PrintNumber(out, seed);
+			out += "\nvn ";
+			for (int k = 0; k < 3; k++) PrintNumber(out, seed);
+			out += "\n";
+		}
+		for (int i = 0; i < 80; i++) {
+			out += "f ";
+			int corners = TestRandom(seed, 0, 1) < 0.3f ? 4 : 3, form = (int)TestRandom(seed, 0, 4);
+			for (int c = 0; c < corners; c++) PrintCorner(out, seed, offsets, form, farBack);
+			out += "\n";
+		}
+	}
+	out += "f 1 2 100000000\n"; // Out of range, kept as -1
+	return out;
+}
+
+// Line by line parse with strtod, the result chunked parsing has to match
+struct SerialObj {
+	std::vector<float> v, vt, vn;
+	std::vector<int> fv, ft, fn, mt;
+	std::vector<std::string> names;
+};
+
+static void ParseSerial(const std::string& text, SerialObj& obj) {
+	obj.names.push_back("");
+	int material = 0;
+	size_t pos = 0;
+	while (pos < text.size()) {
+		size_t eol = text.find('\n', pos);
+		if (eol == std::string::npos) eol = text.size();
+		std::string line = text.substr(pos, eol - pos);
+		pos = eol + 1;
+		const char* p = line.c_str();
+		char* next = NULL;
+		if (line.compare(0, 2, "v ") == 0) {
+			for (int k = 0; k < 3; k++, p = next) obj.v.push_back(strtof(p + (k == 0 ? 1 : 0), &next));
+		} else if (line.compare(0, 3, "vt ") == 0) {
+			p += 2;
+			for (int k = 0; k < PARSE_TEST_VT; k++, p = next) obj.vt.push_back(strtof(p, &next));
+		} else if (line.compare(0, 3, "vn ") == 0) {
+			p += 2;
+			for (int k = 0; k < 3; k++, p = next) obj.vn.push_back(strtof(p, &next));
+		} else if (line.compare(0, 7, "usemtl ") == 0) {
+			std::string name = line.substr(7);
+			uint m = 0;
+			while (m < obj.names.size() && obj.names[m] != name) m++;
+			if (m == obj.names.size()) obj.names.push_back(name);
+			material = m;
+		} else if (line.compare(0, 2, "f ") == 0) {
+			int counts[3] = { (int)obj.v.size() / 3, (int)obj.vt.size() / PARSE_TEST_VT, (int)obj.vn.size() / 3 };
+			std::vector<int> polygon;
+			p += 1;
+			while (true) {
+				long first = strtol(p, &next, 10);
+				if (next == p) break;
+				int index[3] = { (int)first, 0, 0 };
+				p = next;
+				if (*p == '/') {
+					p++;
+					if (*p != '/') { index[1] = strtol(p, &next, 10); p = next; }
+					if (*p == '/') { index[2] = strtol(p + 1, &next, 10); p = next; }
+				}
+				for (int k = 0; k < 3; k++)
+					polygon.push_back(index[k] > 0 ? index[k] - 1 : (index[k] < 0 ? counts[k] + index[k] : -1));
+			}
+			for (uint c = 1; c + 1 < polygon.size() / 3; c++) {
+				uint fan[3] = { 0, c, c + 1 };
+				for (int k = 0; k < 3; k++) {
+					obj.fv.push_back(polygon[fan[k] * 3]);
+					obj.ft.push_back(polygon[fan[k] * 3 + 1]);
+					obj.fn.push_back(polygon[fan[k] * 3 + 2]);
+				}
+				obj.mt.push_back(material);
+			}
+		}
+	}
+	int counts[3] = { (int)obj.v.size() / 3, (int)obj.vt.size() / PARSE_TEST_VT, (int)obj.vn.size() / 3 };
+	std::vector<int>* faces[3] = { &obj.fv, &obj.ft, &obj.fn };
+	for (int a = 0; a < 3; a++) {
+		for (uint i = 0; i < faces[a]->size(); i++)
+			if ((*faces[a])[i] >= counts[a]) (*faces[a])[i] = -1;
+	}
+}
+
+static bool NearFloats(const std::vector<float>& values, const std::vector<float>& expected) {
+	if (values.size() != expected.size()) return false;
+	for (uint i = 0; i < values.size(); i++)
+		if (!NearFloat(values[i], expected[i])) return false;
+	return true;
+}
+
+static bool SameAsSerial(const ObjLoader& loader, const SerialObj& obj) {
+	if (loader.faceCount != (int)obj.mt.size() || loader.mtNames != obj.names) return false;
+	if (!NearFloats(loader.vArr, obj.v) || !NearFloats(loader.vtArr, obj.vt) || !NearFloats(loader.vnArr, obj.vn)) return false;
+	return loader.fvArr == obj.fv && loader.ftArr == obj.ft && loader.fnArr == obj.fn && loader.mtArr == obj.mt;
+}
+
+void TestObjParse() {
+	// Exponents, long mantissas & partial numbers
+	CHECK(ParsesAs("1.5e-3", 1.5e-3f, 6));
+	CHECK(ParsesAs("-2E+2 ", -200.0f, 5));
+	CHECK(ParsesAs("6.02214076e23", 6.02214076e23f, 13));
+	CHECK(ParsesAs("1e-30", 1e-30f, 5));
+	CHECK(ParsesAs("0.1234567890123456789012345", 0.12345679f, 27));
+	CHECK(ParsesAs("123456789012345678901234567890", 1.2345679e29f, 30));
+	CHECK(ParsesAs("-0.000000000000000000123456789", -1.23456789e-19f, 30));
+	CHECK(ParsesAs(".5", 0.5f, 2));
+	CHECK(ParsesAs("5.", 5.0f, 2));
+	CHECK(ParsesAs("+3/", 3.0f, 2));
+	CHECK(ParsesAs("2e", 2.0f, 1));
+	CHECK(ParsesAs("2e+", 2.0f, 1));
+	CHECK(ParsesAs("e5", -12345.0f, 0));
+	CHECK(ParsesAs("-", -12345.0f, 0));
+
+	bool farBack = false;
+	std::string text = CreateObjText(farBack);
+	CHECK(text.size() > OBJ_CHUNK_SIZE * 4);
+	CHECK(farBack);
+	FILE* file = fopen(PARSE_TEST_OBJ, "wb");
+	if (!file) {
+		CHECK(file != NULL);
+		return;
+	}
+	fwrite(text.data(), 1, text.size(), file);
+	fclose(file);
+
+	SerialObj serial;
+	ParseSerial(text, serial);
+	CHECK(serial.names.size() == 4 && serial.mt.size() > 0 && serial.mt[0] == 0);
+
+	// Chunks parsed one after another, then on job workers
+	JobSystem* jobs = JobSystem::jobSystem;
+	JobSystem::jobSystem = NULL;
+	ObjLoader* inOrder = new ObjLoader(PARSE_TEST_OBJ, "", PARSE_TEST_VT);
+	CHECK(SameAsSerial(*inOrder, serial));
+	delete inOrder;
+	JobSystem::jobSystem = jobs;
+
+	JobSystem::Init();
+	ObjLoader* parallel = new ObjLoader(PARSE_TEST_OBJ, "", PARSE_TEST_VT);
+	CHECK(SameAsSerial(*parallel, serial));
+	delete parallel;
+	JobSystem::Release();
+
+	remove(PARSE_TEST_OBJ);
+}
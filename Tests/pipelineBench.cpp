@@ -0,0 +1,142 @@
+#include "test.h"
+#include "bounding/boundsArray.h"
+#include "render/framePipeline.h"
+#include "util/util.h"
+#include <algorithm>
+#include <string.h>
+#include <atomic>
+#include <thread>
+
+// Synthetic frame: prepare culls boxes from the camera the draw side snapshotted,
+//   draw walks what the packet kept. Latency is from snapshot to end of its draw
+struct BenchPacket {
+	std::vector<uint> masks;
+	TestTime snapshot;
+};
+
+static void SetupFrustum(Frustum* frustum, float yaw) {
+	vec3 eye(0, 10, 0), center(100 * sinf(yaw), 10, 100 * cosf(yaw));
+	mat4 viewProject = perspective(60, 16.0 / 9.0, 1, 1000) * lookAt(eye, center, vec3(0, 1, 0));
+	frustum->update(viewProject.GetInverse(), (center - eye).GetNormalized());
+}
+
+static void PreparePacket(BenchPacket* packet, const BoundsArray* bounds, float yaw, const TestTime& snapshot) {
+	Frustum frustum;
+	SetupFrustum(&frustum, yaw);
+	memset(&packet->masks[0], 0, packet->masks.size() * sizeof(uint));
+	CullBoxes(&frustum, bounds, 0, bounds->count, 1, &packet->masks[0]);
+	packet->snapshot = snapshot;
+}
+
+// Stands for building & submitting draw calls of visible boxes
+static float DrawPacket(const BenchPacket* packet, const BoundsArray* bounds) {
+	float sum = 0;
+	for (int pass = 0; pass < 12; pass++) {
+		for (uint i = 0; i < packet->masks.size(); i++) {
+			if (packet->masks[i] & 1)
+				sum += bounds->centerX[i] * bounds->extentY[i] + bounds->centerZ[i] * (float)pass;
+		}
+	}
+	return sum;
+}
+
+struct PipelineResult {
+	double fps, meanLatency, p95Latency;
+};
+
+static PipelineResult Summarize(std::vector<double>& latencies, double totalMs) {
+	PipelineResult result;
+	result.fps = latencies.size() * 1000.0 / totalMs;
+	double sum = 0;
+	for (uint i = 0; i < latencies.size(); i++) sum += latencies[i];
+	result.meanLatency = sum / latencies.size();
+	std::sort(latencies.begin(), latencies.end());
+	result.p95Latency = latencies[latencies.size() * 95 / 100];
+	return result;
+}
+
+// Act, prepare & draw one after another on one thread, as without dualthread
+static PipelineResult RunSerial(const BoundsArray* bounds, int frames, float& sink) {
+	BenchPacket packet;
+	packet.masks.resize(bounds->count);
+	std::vector<double> latencies;
+	TestTime start = TestNow();
+	for (int f = 0; f < frames; f++) {
+		TestTime snapshot = TestNow();
+		PreparePacket(&packet, bounds, f * 0.01f, snapshot);
+		sink += DrawPacket(&packet, bounds);
+		latencies.push_back(ElapsedMs(snapshot));
+	}
+	return Summarize(latencies, ElapsedMs(start));
+}
+
+// Draw on this thread, prepare on another one through a FramePipeline of depth
+static PipelineResult RunPipelined(const BoundsArray* bounds, uint depth, int frames, float& sink) {
+	FramePipeline pipeline(depth);
+	std::vector<BenchPacket> packets(pipeline.getDepth());
+	for (uint i = 0; i < packets.size(); i++) {
+		packets[i].masks.assign(bounds->count, 0);
+		packets[i].snapshot = TestNow();
+	}
+
+	// Camera as draw side last saw it, prepare reads it when it starts a packet
+	std::atomic<int> snapshotFrame(0);
+	std::atomic<long long> snapshotTicks(TestNow().time_since_epoch().count());
+	std::atomic<bool> quit(false);
+	std::thread prepareThread([&]() {
+		while (!quit.load()) {
+			int slot = pipeline.beginPrepare();
+			if (slot < 0) {
+				std::this_thread::yield();
+				continue;
+			}
+			float yaw = snapshotFrame.load() * 0.01f;
+			TestTime snapshot = TestTime(TestTime::duration(snapshotTicks.load()));
+			PreparePacket(&packets[slot], bounds, yaw, snapshot);
+			pipeline.endPrepare();
+		}
+	});
+
+	std::vector<double> latencies;
+	TestTime start = TestNow();
+	for (int f = 0; f < frames; f++) {
+		snapshotTicks = TestNow().time_since_epoch().count();
+		snapshotFrame = f;
+		int slot = pipeline.acquire();
+		while (slot < 0) {
+			std::this_thread::yield();
+			slot = pipeline.acquire();
+		}
+		sink += DrawPacket(&packets[slot], bounds);
+		latencies.push_back(ElapsedMs(packets[slot].snapshot));
+	}
+	double total = ElapsedMs(start);
+	quit = true;
+	prepareThread.join();
+	return Summarize(latencies, total);
+}
+
+void BenchFramePipeline() {
+	const int boxCount = 200000, frames = 300;
+	std::vector<AABB*> boxes;
+	BoundsArray bounds(boxCount);
+	unsigned int seed = 21;
+	for (int i = 0; i < boxCount; i++) {
+		vec3 center(TestRandom(seed, -1000, 1000), TestRandom(seed, -50, 70), TestRandom(seed, -1000, 1000));
+		float size = TestRandom(seed, 0.5, 40);
+		boxes.push_back(new AABB(center, size, TestRandom(seed, 0.5, 40), size));
+		bounds.add(boxes.back());
+	}
+
+	float sink = 0;
+	printf("  %d boxes, %d frames, %u hardware threads\n", boxCount, frames, std::thread::hardware_concurrency());
+	PipelineResult serial = RunSerial(&bounds, frames, sink);
+	printf("  serial:  %.1f fps, latency mean %.2f ms, p95 %.2f ms\n", serial.fps, serial.meanLatency, serial.p95Latency);
+	for (uint depth = MIN_FRAME_DEPTH; depth <= MAX_FRAME_DEPTH; depth++) {
+		PipelineResult result = RunPipelined(&bounds, depth, frames, sink);
+		printf("  depth %u: %.1f fps, latency mean %.2f ms, p95 %.2f ms\n", depth, result.fps, result.meanLatency, result.p95Latency);
+	}
+	if (sink == 0.12345f) printf("\n");
+
+	for (uint i = 0; i < boxes.size(); i++) delete boxes[i];
+}
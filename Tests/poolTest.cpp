@@ -0,0 +1,209 @@
+#include "test.h"
+#include "util/pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <set>
+#ifdef _WIN32
+#include <malloc.h>
+#define HeapUsableSize(p) _msize(p)
+#else
+#include <malloc.h>
+#define HeapUsableSize(p) malloc_usable_size(p)
+#endif
+
+// Sizes of a static object, its bounding box & its packed transform record on x64
+static const size_t ObjectSize = 640, BoundsSize = 72, RecordSize = 48;
+
+void TestPool() {
+	// Sizes here are not used by the engine, so these pools start empty
+	const size_t size = 1000;
+	MemoryPool* pool = GetSizedPool(size);
+	std::vector<void*> elements;
+	std::set<void*> unique;
+	for (int i = 0; i < POOL_BLOCK_COUNT * 3; i++) {
+		void* element = PoolAlloc(size);
+		CHECK(((size_t)element % POOL_ALIGN) == 0);
+		memset(element, 0xab, size);
+		elements.push_back(element);
+		unique.insert(element);
+	}
+	CHECK(unique.size() == elements.size());
+	CHECK(pool->getBlockCount() >= 3);
+
+	// Released elements are reused
+	void* last = elements.back();
+	PoolFree(last, size);
+	CHECK(PoolAlloc(size) == last);
+
+	// Blocks with a live element stay, fully released ones are freed
+	void* kept = elements[0];
+	for (uint i = 1; i < elements.size(); i++) 
+		PoolFree(elements[i], size);
+	uint blocks = pool->getBlockCount();
+	CHECK(ReleasePools() > 0);
+	CHECK(pool->getBlockCount() >= 1 && pool->getBlockCount() < blocks);
+	CHECK(pool->getLiveCount() == 1);
+	PoolFree(kept, size);
+	ReleasePools();
+	CHECK(pool->getBlockCount() == 0);
+	CHECK(pool->getLiveCount() == 0);
+
+	// Elements allocated on one thread and released on others
+	const size_t sharedSize = 992;
+	std::vector<void*> shared;
+	for (int i = 0; i < 20000; i++) 
+		shared.push_back(PoolAlloc(sharedSize));
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++) {
+		threads.push_back(std::thread([&shared, t, sharedSize]() {
+			for (uint i = t; i < shared.size(); i += 4) 
+				PoolFree(shared[i], sharedSize);
+			std::vector<void*> own;
+			for (int i = 0; i < 5000; i++) 
+				own.push_back(PoolAlloc(sharedSize));
+			for (uint i = 0; i < own.size(); i++) 
+				PoolFree(own[i], sharedSize);
+		}));
+	}
+	for (uint t = 0; t < threads.size(); t++) 
+		threads[t].join();
+	// Ended threads returned their caches
+	ReleasePools();
+	CHECK(GetSizedPool(sharedSize)->getLiveCount() == 0);
+	CHECK(GetSizedPool(sharedSize)->getBlockCount() == 0);
+}
+
+struct BenchItem {
+	void* object;
+	void* bounds;
+	void* record;
+};
+
+// Touch every item in creation order, as a node update or gather walks its objects
+static float ScanItems(const std::vector<BenchItem>& items) {
+	float sum = 0;
+	for (uint i = 0; i < items.size(); i++) 
+		sum += ((float*)items[i].object)[4] + ((float*)items[i].bounds)[2] + ((float*)items[i].record)[1];
+	return sum;
+}
+
+static void FillItem(BenchItem& item) {
+	memset(item.object, 0, ObjectSize);
+	memset(item.bounds, 0, BoundsSize);
+	memset(item.record, 0, RecordSize);
+}
+
+// Heap noise between loads, like meshes, textures & vectors allocated while a scene loads
+static void* Noise(unsigned int& seed) {
+	return malloc((size_t)TestRandom(seed, 16, 2048));
+}
+
+void BenchPool() {
+	const int count = 20000, rounds = 10;
+	double heapLoad = 0, poolLoad = 0, heapScan = 0, poolScan = 0, heapFree = 0, poolFree = 0;
+	double heapFirstLoad = 0, poolFirstLoad = 0;
+	size_t heapBytes = 0, poolBytes = 0;
+	float sum = 0;
+
+	for (int r = 0; r < rounds; r++) {
+		std::vector<BenchItem> items(count);
+		std::vector<void*> noise;
+		unsigned int seed = 5;
+
+		TestTime start = TestNow();
+		for (int i = 0; i < count; i++) {
+			items[i].object = malloc(ObjectSize);
+			items[i].bounds = malloc(BoundsSize);
+			items[i].record = malloc(RecordSize);
+			FillItem(items[i]);
+			noise.push_back(Noise(seed));
+		}
+		heapLoad += ElapsedMs(start);
+		if (r == 0) {
+			heapFirstLoad = heapLoad;
+			for (int i = 0; i < count; i++) 
+				heapBytes += HeapUsableSize(items[i].object) + HeapUsableSize(items[i].bounds) + HeapUsableSize(items[i].record);
+		}
+		start = TestNow();
+		sum += ScanItems(items);
+		heapScan += ElapsedMs(start);
+		start = TestNow();
+		for (int i = 0; i < count; i++) {
+			free(items[i].object);
+			free(items[i].bounds);
+			free(items[i].record);
+		}
+		heapFree += ElapsedMs(start);
+		for (uint i = 0; i < noise.size(); i++) free(noise[i]);
+		noise.clear();
+
+		seed = 5;
+		start = TestNow();
+		for (int i = 0; i < count; i++) {
+			items[i].object = PoolAlloc(ObjectSize);
+			items[i].bounds = PoolAlloc(BoundsSize);
+			items[i].record = PoolAlloc(RecordSize);
+			FillItem(items[i]);
+			noise.push_back(Noise(seed));
+		}
+		poolLoad += ElapsedMs(start);
+		if (r == 0) {
+			poolFirstLoad = poolLoad;
+			size_t sizes[3] = { ObjectSize, BoundsSize, RecordSize };
+			for (int s = 0; s < 3; s++) {
+				MemoryPool* pool = GetSizedPool(sizes[s]);
+				poolBytes += (size_t)pool->getBlockCount() * POOL_BLOCK_COUNT * pool->getElementSize();
+			}
+		}
+		start = TestNow();
+		sum += ScanItems(items);
+		poolScan += ElapsedMs(start);
+		start = TestNow();
+		for (int i = 0; i < count; i++) {
+			PoolFree(items[i].object, ObjectSize);
+			PoolFree(items[i].bounds, BoundsSize);
+			PoolFree(items[i].record, RecordSize);
+		}
+		ReleasePools();
+		poolFree += ElapsedMs(start);
+		for (uint i = 0; i < noise.size(); i++) free(noise[i]);
+	}
+
+	printf("  %d objects with bounds & transform record, %d rounds\n", count, rounds);
+	// First load runs on fresh memory, later ones on memory the heap kept from the last round
+	printf("  heap: first load %.2f ms, load %.2f ms, scan %.3f ms, free %.2f ms, %.2f MB usable without headers\n",
+		heapFirstLoad, heapLoad / rounds, heapScan / rounds, heapFree / rounds, heapBytes / 1048576.0);
+	printf("  pool: first load %.2f ms, load %.2f ms, scan %.3f ms, free %.2f ms, %.2f MB in blocks (%.2f MB requested)\n",
+		poolFirstLoad, poolLoad / rounds, poolScan / rounds, poolFree / rounds, poolBytes / 1048576.0,
+		count * (ObjectSize + BoundsSize + RecordSize) / 1048576.0);
+
+	// Several threads allocating & releasing, each lock is taken once per batch
+	const int threadCount = 4, perThread = 200000;
+	for (int mode = 0; mode < 2; mode++) {
+		TestTime start = TestNow();
+		std::vector<std::thread> threads;
+		for (int t = 0; t < threadCount; t++) {
+			threads.push_back(std::thread([mode, perThread]() {
+				std::vector<void*> live(64, (void*)NULL);
+				for (int i = 0; i < perThread; i++) {
+					void*& slot = live[i & 63];
+					if (slot) {
+						if (mode == 0) free(slot);
+						else PoolFree(slot, BoundsSize);
+					}
+					slot = mode == 0 ? malloc(BoundsSize) : PoolAlloc(BoundsSize);
+				}
+				for (uint i = 0; i < live.size(); i++) {
+					if (mode == 0) free(live[i]);
+					else PoolFree(live[i], BoundsSize);
+				}
+			}));
+		}
+		for (uint t = 0; t < threads.size(); t++) 
+			threads[t].join();
+		printf("  %s: %d threads x %d alloc & free %.2f ms\n", mode == 0 ? "heap" : "pool", 
+			threadCount, perThread, ElapsedMs(start));
+	}
+	if (sum != 0) printf("  %f\n", sum);
+}
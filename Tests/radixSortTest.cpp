@@ -0,0 +1,78 @@
+#include "test.h"
+#include "util/radixSort.h"
+#include <algorithm>
+#include <vector>
+
+struct KeyValue {
+	u64 key;
+	uint value;
+};
+
+// Radix sort is stable, so it must match stable_sort of the same pairs exactly
+static bool SortsLikeStable(const std::vector<u64>& input) {
+	uint count = input.size();
+	std::vector<u64> keys(input), tmpKeys(count + 1);
+	std::vector<uint> values(count + 1), tmpValues(count + 1);
+	std::vector<KeyValue> expected(count);
+	for (uint i = 0; i < count; i++) {
+		values[i] = i;
+		expected[i].key = input[i];
+		expected[i].value = i;
+	}
+	std::stable_sort(expected.begin(), expected.end(), [](const KeyValue& l, const KeyValue& r) {
+		return l.key < r.key;
+	});
+	RadixSort(keys.data(), values.data(), count, tmpKeys.data(), tmpValues.data());
+	for (uint i = 0; i < count; i++) {
+		if (keys[i] != expected[i].key || values[i] != expected[i].value) return false;
+	}
+	return true;
+}
+
+static u64 RandomKey(unsigned int& seed) {
+	u64 high = (u64)(TestRandom(seed, 0, 65536)) << 48 | (u64)(TestRandom(seed, 0, 65536)) << 32;
+	return high | (u64)(TestRandom(seed, 0, 65536)) << 16 | (u64)(TestRandom(seed, 0, 65536));
+}
+
+void TestRadixSort() {
+	unsigned int seed = 17;
+	std::vector<u64> keys;
+
+	// Random full width keys
+	for (int i = 0; i < 5000; i++) keys.push_back(RandomKey(seed));
+	CHECK(SortsLikeStable(keys));
+
+	// Many duplicates, stability decides the order of values
+	keys.clear();
+	for (int i = 0; i < 5000; i++) keys.push_back(RandomKey(seed) % 7);
+	CHECK(SortsLikeStable(keys));
+
+	// Constant bytes skip passes, an odd number of done passes ends in temporary arrays
+	for (int varying = 1; varying <= 8; varying++) {
+		keys.clear();
+		for (int i = 0; i < 3000; i++) {
+			u64 key = 0x0123456789abcdefull;
+			for (int d = 0; d < varying; d++) {
+				int digit = (d * 3) % 8;
+				key = (key & ~(0xffull << (digit * 8))) | (u64)(RandomKey(seed) & 0xff) << (digit * 8);
+			}
+			keys.push_back(key);
+		}
+		CHECK(SortsLikeStable(keys));
+	}
+
+	// All keys equal, nothing to do
+	keys.assign(1000, 42);
+	CHECK(SortsLikeStable(keys));
+
+	// Zero middle bytes between varying ones
+	keys.clear();
+	for (int i = 0; i < 2000; i++) keys.push_back((RandomKey(seed) & 0x8000ffff0000ffffull));
+	CHECK(SortsLikeStable(keys));
+
+	// Empty & single item
+	keys.clear();
+	CHECK(SortsLikeStable(keys));
+	keys.push_back(RandomKey(seed));
+	CHECK(SortsLikeStable(keys));
+}
@@ -0,0 +1,115 @@
+#include "test.h"
+#include "instance/instanceRecord.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+// Same as DecodeRotation of multiCull.comp
+static vec4 DecodeRotation(uint packed) {
+	float v[3];
+	for (int i = 0; i < 3; i++) {
+		int bits = (int)((packed >> (i * 10)) & 0x3ff);
+		if (bits & 0x200) bits -= 0x400;
+		v[i] = bits / (511.0f * 1.41421356f);
+	}
+	float l = sqrtf(fmaxf(0.0f, 1.0f - v[0] * v[0] - v[1] * v[1] - v[2] * v[2]));
+	uint largest = packed >> 30;
+	if (largest == 0) return vec4(l, v[0], v[1], v[2]);
+	if (largest == 1) return vec4(v[0], l, v[1], v[2]);
+	if (largest == 2) return vec4(v[0], v[1], l, v[2]);
+	return vec4(v[0], v[1], v[2], l);
+}
+
+static vec4 RandomQuat(unsigned int& seed) {
+	vec4 q(TestRandom(seed, -1, 1), TestRandom(seed, -1, 1), TestRandom(seed, -1, 1), TestRandom(seed, -1, 1));
+	float l = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+	return vec4(q.x / l, q.y / l, q.z / l, q.w / l);
+}
+
+void TestInstanceRecord() {
+	CHECK(sizeof(InstanceRecord) == 32);
+
+	// Rotation angle between packed & source quaternion
+	unsigned int seed = 11;
+	float worst = 0;
+	for (int i = 0; i < 20000; i++) {
+		vec4 q = RandomQuat(seed);
+		vec4 d = DecodeRotation(PackRotation(q));
+		float dot = fabsf(q.x * d.x + q.y * d.y + q.z * d.z + q.w * d.w);
+		float angle = 2.0f * acosf(fminf(dot, 1.0f)) * 57.2957795f;
+		if (angle > worst) worst = angle;
+	}
+	CHECK(worst < 0.5f);
+
+	// Frame rows bone.vert floors stay whole past what half float keeps
+	float frames[] = { 0.0f, 0.99f, 1.0f, 37.5f, 2047.9f, 2049.5f, 4097.3f, 30000.7f };
+	for (uint i = 0; i < sizeof(frames) / sizeof(float); i++) {
+		InstanceRecord record;
+		memset(&record, 0, sizeof(record));
+		record.boundZ = 0x1234;
+		PackAnimFrame(&record, 3, frames[i], 7);
+		CHECK((record.extra & 0xffff) == (uint)floorf(frames[i]));
+		CHECK((record.extra >> 16) == 3);
+		CHECK((record.boundZ >> 16) == 7 && (record.boundZ & 0xffff) == 0x1234);
+	}
+}
+
+// Animation queues gather one record per visible object & upload them
+void BenchInstanceRecord() {
+	const int count = 100000, rounds = 20;
+	std::vector<float> fulls(count * 16);
+	std::vector<InstanceRecord> records(count);
+	std::vector<uint> order(count);
+	unsigned int seed = 3;
+	for (int i = 0; i < count; i++) {
+		order[i] = i;
+		for (int k = 0; k < 16; k++) fulls[i * 16 + k] = TestRandom(seed, -100, 100);
+	}
+	// Visible objects come in cull order, not creation order
+	for (int i = count - 1; i > 0; i--) {
+		int j = (int)TestRandom(seed, 0, (float)i + 0.999f);
+		uint t = order[i]; order[i] = order[j]; order[j] = t;
+	}
+
+	float transforms[4] = { 10, 2, -5, 1.5 };
+	vec4 bound(2, 3, 4, 1.5);
+	double pack = 0;
+	for (int r = 0; r < rounds; r++) {
+		TestTime start = TestNow();
+		for (int i = 0; i < count; i++) {
+			transforms[0] = (float)i;
+			PackInstance(&records[i], transforms, vec4(0, 0.3827f, 0, 0.9239f), bound);
+		}
+		pack += ElapsedMs(start);
+	}
+	printf("  %d instances, %d rounds\n", count, rounds);
+	printf("  pack: %.2f ms, %.1f ns per record\n", pack / rounds, pack / rounds * 1e6 / count);
+
+	std::vector<float> fullOut(count * 16);
+	std::vector<InstanceRecord> recordOut(count);
+	float sum = 0;
+	for (int shuffled = 0; shuffled < 2; shuffled++) {
+		std::vector<uint> gather(count);
+		for (int i = 0; i < count; i++) gather[i] = shuffled ? order[i] : i;
+		double fullGather = 0, recordGather = 0;
+		for (int r = 0; r < rounds; r++) {
+			TestTime start = TestNow();
+			for (int i = 0; i < count; i++)
+				memcpy(&fullOut[i * 16], &fulls[gather[i] * 16], 16 * sizeof(float));
+			fullGather += ElapsedMs(start);
+
+			start = TestNow();
+			for (int i = 0; i < count; i++) {
+				recordOut[i] = records[gather[i]];
+				PackAnimFrame(&recordOut[i], 1, (float)(i & 4095) + 0.5f, 2);
+			}
+			recordGather += ElapsedMs(start);
+			sum += fullOut[r] + recordOut[r].position[0];
+		}
+		// Cull order misses cache once per object in both layouts, which narrows the gain
+		printf("  %s: gather 16 floats %.2f ms (%.2f MB), gather records & pack frame %.2f ms (%.2f MB), %.2fx\n",
+			shuffled ? "cull order" : "creation order", fullGather / rounds, count * 64 / 1048576.0,
+			recordGather / rounds, count * 32 / 1048576.0, fullGather / recordGather);
+	}
+	if (sum == 0.12345f) printf("\n");
+}
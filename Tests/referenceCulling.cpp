@@ -0,0 +1,161 @@
+#include "referenceCulling.h"
+
+// Face corners per plane. The old table had 3, 7, 5, 6 for the right face,
+//   a skewed quad that kept some boxes lying outside, corrected to 3, 7, 5, 1
+static const uint PlaneVertexIndex[24] = {
+	0, 4, 6, 2,
+	3, 7, 5, 1,
+	1, 5, 4, 0,
+	2, 6, 7, 3,
+	0, 2, 3, 1,
+	4, 5, 7, 6
+};
+
+static bool VertexInsideCamera(const vec3& vertex, const Frustum* frustum) {
+	for (int i = 0; i < 6; i++) {
+		if (frustum->normals[i].DotProduct(vertex) + frustum->ds[i] < 0)
+			return false;
+	}
+	return true;
+}
+
+static bool CameraVertexInside(const vec3& vertex, const vec3& minVertex, const vec3& maxVertex) {
+	return vertex.x >= minVertex.x && vertex.x <= maxVertex.x &&
+		vertex.y >= minVertex.y && vertex.y <= maxVertex.y &&
+		vertex.z >= minVertex.z && vertex.z <= maxVertex.z;
+}
+
+static bool BoxIntersectsWidthRay(const vec3& minVertex, const vec3& maxVertex, const vec3& origin, const vec3& dir, float maxDistance) {
+	float distance = 0;
+	vec3 vertex;
+
+	if (dir.x != 0) {
+		float d[2] = { minVertex.x, maxVertex.x };
+		float invDirX = 1.0 / dir.x;
+		for (int i = 0; i < 2; i++) {
+			distance = (d[i] - origin.x) * invDirX;
+			if (distance >= 0 && distance <= maxDistance) {
+				vertex = dir * distance + origin;
+				if (vertex.y >= minVertex.y && vertex.y <= maxVertex.y && vertex.z >= minVertex.z && vertex.z <= maxVertex.z)
+					return true;
+			}
+		}
+	}
+
+	if (dir.y != 0) {
+		float d[2] = { minVertex.y, maxVertex.y };
+		float invDirY = 1.0 / dir.y;
+		for (int i = 0; i < 2; i++) {
+			distance = (d[i] - origin.y) * invDirY;
+			if (distance >= 0 && distance <= maxDistance) {
+				vertex = dir * distance + origin;
+				if (vertex.x >= minVertex.x && vertex.x <= maxVertex.x && vertex.z >= minVertex.z && vertex.z <= maxVertex.z)
+					return true;
+			}
+		}
+	}
+
+	if (dir.z != 0) {
+		float d[2] = { minVertex.z, maxVertex.z };
+		float invDirZ = 1.0 / dir.z;
+		for (int i = 0; i < 2; i++) {
+			distance = (d[i] - origin.z) * invDirZ;
+			if (distance >= 0 && distance <= maxDistance) {
+				vertex = dir * distance + origin;
+				if (vertex.x >= minVertex.x && vertex.x <= maxVertex.x && vertex.y >= minVertex.y && vertex.y <= maxVertex.y)
+					return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+static bool FrustumIntersectsWidthRay(const Frustum* frustum, const vec3& origin, const vec3& dir, float maxDistance) {
+	Line line(dir, origin);
+	vec3 interPoint(0, 0, 0);
+	for (uint i = 0; i < 6; i++) {
+		bool isInter = CaculateIntersect(&line, &frustum->planes[i], maxDistance, interPoint);
+		if (!isInter) continue;
+		vec3 ia = frustum->worldVertex[PlaneVertexIndex[i * 4]] - interPoint;
+		vec3 ib = frustum->worldVertex[PlaneVertexIndex[i * 4 + 1]] - interPoint;
+		vec3 ic = frustum->worldVertex[PlaneVertexIndex[i * 4 + 2]] - interPoint;
+		vec3 id = frustum->worldVertex[PlaneVertexIndex[i * 4 + 3]] - interPoint;
+		vec3 aib = ia.CrossProduct(ib);
+		vec3 bic = ib.CrossProduct(ic);
+		vec3 cid = ic.CrossProduct(id);
+		vec3 dia = id.CrossProduct(ia);
+		if ((aib.DotProduct(bic) >= 0 && bic.DotProduct(cid) >= 0 && cid.DotProduct(dia) >= 0 && dia.DotProduct(aib) >= 0) ||
+			(aib.DotProduct(bic) <= 0 && bic.DotProduct(cid) <= 0 && cid.DotProduct(dia) <= 0 && dia.DotProduct(aib) <= 0))
+			return true;
+	}
+	return false;
+}
+
+bool ReferenceCheckWithCamera(const Frustum* frustum, const vec3& minVertex, const vec3& maxVertex, int checkLevel) {
+	if (checkLevel < 1) return true;
+
+	vec3 vertices[8];
+	for (int i = 0; i < 8; i++) {
+		vertices[i].x = (i & 1) ? maxVertex.x : minVertex.x;
+		vertices[i].y = (i & 2) ? maxVertex.y : minVertex.y;
+		vertices[i].z = (i & 4) ? maxVertex.z : minVertex.z;
+	}
+	vec3 size = maxVertex - minVertex;
+
+	for (int i = 0; i < 8; i++) {
+		if (VertexInsideCamera(vertices[i], frustum))
+			return true;
+	}
+
+	if (checkLevel >= 2) {
+		for (int i = 0; i < 8; i++) {
+			if (CameraVertexInside(frustum->worldVertex[i], minVertex, maxVertex))
+				return true;
+		}
+
+		for (int i = 0; i < 4; i++) {
+			vec3 edgeDir = frustum->worldVertex[i] - frustum->worldVertex[i + 4];
+			float edgeLength = edgeDir.GetLength();
+			edgeDir /= edgeLength;
+			if (BoxIntersectsWidthRay(minVertex, maxVertex, frustum->worldVertex[i + 4], edgeDir, edgeLength))
+				return true;
+		}
+	}
+
+	if (checkLevel >= 3) {
+		vec3 right(1, 0, 0), far(0, 0, 1), left(-1, 0, 0), near(0, 0, -1);
+
+		if (FrustumIntersectsWidthRay(frustum, vertices[0], right, size.x))
+			return true;
+		if (FrustumIntersectsWidthRay(frustum, vertices[0], far, size.z))
+			return true;
+		if (FrustumIntersectsWidthRay(frustum, vertices[7], left, size.x))
+			return true;
+		if (FrustumIntersectsWidthRay(frustum, vertices[7], near, size.z))
+			return true;
+		if (FrustumIntersectsWidthRay(frustum, vertices[4], right, size.x))
+			return true;
+		if (FrustumIntersectsWidthRay(frustum, vertices[3], left, size.x))
+			return true;
+		if (FrustumIntersectsWidthRay(frustum, vertices[2], far, size.z))
+			return true;
+		if (FrustumIntersectsWidthRay(frustum, vertices[1], far, size.z))
+			return true;
+	}
+
+	if (checkLevel >= 4) {
+		vec3 up(0, 1, 0), down(0, -1, 0);
+
+		if (FrustumIntersectsWidthRay(frustum, vertices[0], up, size.y))
+			return true;
+		if (FrustumIntersectsWidthRay(frustum, vertices[7], down, size.y))
+			return true;
+		if (FrustumIntersectsWidthRay(frustum, vertices[4], up, size.y))
+			return true;
+		if (FrustumIntersectsWidthRay(frustum, vertices[1], up, size.y))
+			return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,11 @@
+#ifndef REFERENCE_CULLING_H_
+#define REFERENCE_CULLING_H_
+
+#include "bounding/aabb.h"
+
+// Box-frustum test as it was before the separating axis test:
+//   corners, then frustum vertices & edges, then rays along box edges.
+//   Kept to check the exact test against, checkLevel 1 to 4 as before.
+bool ReferenceCheckWithCamera(const Frustum* frustum, const vec3& minVertex, const vec3& maxVertex, int checkLevel);
+
+#endif
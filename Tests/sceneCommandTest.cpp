@@ -0,0 +1,78 @@
+#include "test.h"
+#include "scene/sceneCommand.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define SCENE_TEST_PRODUCERS 4
+#define SCENE_TEST_COMMANDS 50000 // Per producer
+
+void TestSceneCommandQueue() {
+	// A full queue refuses commands until the consumer frees a cell
+	SceneCommandQueue small(8);
+	SceneCommand command;
+	command.type = SCENE_CMD_TRANSLATE_NODE;
+	command.node = command.child = 0;
+	command.x = command.y = command.z = 0;
+	int pushed = 0;
+	for (uint i = 0; i < 8; i++) {
+		command.object = i;
+		if (small.push(command)) pushed++;
+	}
+	CHECK(pushed == 8);
+	command.object = 8;
+	CHECK(!small.push(command));
+	SceneCommand taken;
+	CHECK(small.pop(taken) && taken.object == 0);
+	CHECK(small.push(command));
+	uint expect = 1;
+	bool ordered = true;
+	while (small.pop(taken)) ordered = ordered && taken.object == expect++;
+	CHECK(ordered && expect == 9);
+	CHECK(!small.pop(taken));
+
+	// Producers retry while the queue is full, queue is small so that happens often.
+	//   Node is the producer & object its counter, the consumer sees each once in order
+	SceneCommandQueue queue(1024);
+	std::atomic<int> started(0);
+	std::vector<std::thread> producers;
+	for (uint p = 0; p < SCENE_TEST_PRODUCERS; p++) {
+		producers.push_back(std::thread([&queue, &started, p]() {
+			SceneCommand cmd;
+			cmd.type = SCENE_CMD_TRANSLATE_NODE;
+			cmd.node = p;
+			cmd.child = 0;
+			cmd.x = cmd.y = cmd.z = (float)p;
+			started++;
+			while (started.load() < SCENE_TEST_PRODUCERS) std::this_thread::yield();
+			for (uint i = 0; i < SCENE_TEST_COMMANDS; i++) {
+				cmd.object = i;
+				while (!queue.push(cmd)) std::this_thread::yield();
+			}
+		}));
+	}
+
+	std::vector<uint> next(SCENE_TEST_PRODUCERS, 0);
+	uint received = 0, outOfOrder = 0, corrupt = 0;
+	while (received < SCENE_TEST_PRODUCERS * SCENE_TEST_COMMANDS) {
+		if (!queue.pop(taken)) {
+			std::this_thread::yield();
+			continue;
+		}
+		received++;
+		if (taken.node >= SCENE_TEST_PRODUCERS || taken.x != (float)taken.node) {
+			corrupt++;
+			continue;
+		}
+		if (taken.object != next[taken.node]) outOfOrder++;
+		next[taken.node] = taken.object + 1;
+	}
+	for (uint p = 0; p < producers.size(); p++) producers[p].join();
+
+	CHECK(corrupt == 0);
+	CHECK(outOfOrder == 0); // Also catches lost & duplicated commands
+	bool complete = true;
+	for (uint p = 0; p < SCENE_TEST_PRODUCERS; p++) complete = complete && next[p] == SCENE_TEST_COMMANDS;
+	CHECK(complete);
+	CHECK(!queue.pop(taken));
+}
@@ -0,0 +1,182 @@
+#include "test.h"
+#include "mesh/simplifier.h"
+#include <stdlib.h>
+#include <map>
+#include <vector>
+
+#define SIMPLIFIER_TEST_GRID 16 // Quads along a side of each patch
+
+// Mesh filled from given arrays, only what Simplifier reads
+class TestMesh: public Mesh {
+private:
+	virtual void initFaces() {}
+public:
+	TestMesh(const std::vector<vec3>& positions, const std::vector<vec2>& uvs, const std::vector<vec3>& norms, const std::vector<int>& tris) :Mesh() {
+		vertexCount = positions.size();
+		vertices = new vec4[vertexCount];
+		normals = new vec3[vertexCount];
+		texcoords = new vec2[vertexCount];
+		materialids = new int[vertexCount];
+		for (int i = 0; i < vertexCount; i++) {
+			vertices[i] = vec4(positions[i].x, positions[i].y, positions[i].z, 1.0);
+			normals[i] = norms[i];
+			texcoords[i] = uvs[i];
+			materialids[i] = 0;
+		}
+		indexCount = tris.size();
+		indices = (int*)malloc(indexCount * sizeof(int));
+		for (int i = 0; i < indexCount; i++) indices[i] = tris[i];
+		caculateExData();
+	}
+};
+
+// Grid of (n + 1)^2 vertices on patch p(s, t), s & t in [-1, 1], counter clockwise seen from outside
+template <typename F>
+static void AddPatch(const F& patch, int n, std::vector<vec3>& positions, std::vector<vec2>& uvs, std::vector<int>& tris) {
+	int first = positions.size();
+	for (int j = 0; j <= n; j++) {
+		for (int i = 0; i <= n; i++) {
+			positions.push_back(patch(2.0f * i / n - 1.0f, 2.0f * j / n - 1.0f));
+			uvs.push_back(vec2((float)i / n, (float)j / n));
+		}
+	}
+	for (int j = 0; j < n; j++) {
+		for (int i = 0; i < n; i++) {
+			int v = first + j * (n + 1) + i;
+			int quad[6] = { v, v + 1, v + n + 2, v, v + n + 2, v + n + 1 };
+			tris.insert(tris.end(), quad, quad + 6);
+		}
+	}
+}
+
+// Cube of six patches pushed onto a unit sphere, patches own their vertices so cube edges are uv seams.
+//   Every coordinate is one of +-1, s or t, so seam vertices of two patches get equal positions
+static TestMesh* CreateSphereMesh() {
+	std::vector<vec3> positions, norms;
+	std::vector<vec2> uvs;
+	std::vector<int> tris;
+	AddPatch([](float s, float t) { return vec3(1, s, t); }, SIMPLIFIER_TEST_GRID, positions, uvs, tris);
+	AddPatch([](float s, float t) { return vec3(-1, t, s); }, SIMPLIFIER_TEST_GRID, positions, uvs, tris);
+	AddPatch([](float s, float t) { return vec3(t, 1, s); }, SIMPLIFIER_TEST_GRID, positions, uvs, tris);
+	AddPatch([](float s, float t) { return vec3(s, -1, t); }, SIMPLIFIER_TEST_GRID, positions, uvs, tris);
+	AddPatch([](float s, float t) { return vec3(s, t, 1); }, SIMPLIFIER_TEST_GRID, positions, uvs, tris);
+	AddPatch([](float s, float t) { return vec3(t, s, -1); }, SIMPLIFIER_TEST_GRID, positions, uvs, tris);
+	for (uint i = 0; i < positions.size(); i++) {
+		positions[i] = positions[i].GetNormalized();
+		norms.push_back(positions[i]);
+	}
+	return new TestMesh(positions, uvs, norms, tris);
+}
+
+// Open height field, its border has to stay where it is
+static TestMesh* CreateTerrainMesh() {
+	std::vector<vec3> positions, norms;
+	std::vector<vec2> uvs;
+	std::vector<int> tris;
+	AddPatch([](float s, float t) { return vec3(s, 0.1f * sin(s * 3.0f) * cos(t * 2.0f), -t); }, SIMPLIFIER_TEST_GRID * 2, positions, uvs, tris);
+	for (uint i = 0; i < positions.size(); i++) norms.push_back(vec3(0, 1, 0));
+	return new TestMesh(positions, uvs, norms, tris);
+}
+
+struct PositionLess {
+	bool operator()(const vec3& l, const vec3& r) const {
+		if (l.x != r.x) return l.x < r.x;
+		if (l.y != r.y) return l.y < r.y;
+		return l.z < r.z;
+	}
+};
+
+static bool SamePosition(const Mesh* mesh, int a, int b) {
+	return mesh->vertices3[a] == mesh->vertices3[b];
+}
+
+// Output triangles have three positions and face the way the surface does at their vertices
+static bool FacesValid(const Mesh* mesh, const Simplifier& simplifier) {
+	for (uint t = 0; t < simplifier.indices.size(); t += 3) {
+		int a = simplifier.vertices[simplifier.indices[t]];
+		int b = simplifier.vertices[simplifier.indices[t + 1]];
+		int c = simplifier.vertices[simplifier.indices[t + 2]];
+		if (SamePosition(mesh, a, b) || SamePosition(mesh, a, c) || SamePosition(mesh, b, c)) return false;
+		const vec3* p = mesh->vertices3;
+		vec3 normal = (p[b] - p[a]).CrossProduct(p[c] - p[a]);
+		if (normal.GetLength() <= 0.0) return false;
+		vec3 surface = mesh->normals[a] + mesh->normals[b] + mesh->normals[c];
+		if (normal.DotProduct(surface) <= 0.0) return false;
+	}
+	return true;
+}
+
+// Every edge between positions is used by two output triangles, so seams did not tear
+static bool Closed(const Mesh* mesh, const Simplifier& simplifier) {
+	std::map<vec3, int, PositionLess> ids;
+	std::map<std::pair<int, int>, int> edges;
+	std::vector<int> tri(3);
+	for (uint t = 0; t < simplifier.indices.size(); t += 3) {
+		for (int k = 0; k < 3; k++) {
+			vec3 p = mesh->vertices3[simplifier.vertices[simplifier.indices[t + k]]];
+			if (ids.find(p) == ids.end()) {
+				int id = ids.size();
+				ids[p] = id;
+			}
+			tri[k] = ids[p];
+		}
+		for (int k = 0; k < 3; k++) {
+			int p0 = tri[k], p1 = tri[(k + 1) % 3];
+			edges[p0 < p1 ? std::make_pair(p0, p1) : std::make_pair(p1, p0)]++;
+		}
+	}
+	for (std::map<std::pair<int, int>, int>::iterator it = edges.begin(); it != edges.end(); ++it)
+		if (it->second != 2) return false;
+	return edges.size() > 0;
+}
+
+void TestSimplifier() {
+	TestMesh* sphere = CreateSphereMesh();
+	int triangles = sphere->indexCount / 3;
+	Simplifier simplifier(sphere);
+	simplifier.simplify(0.25);
+	int simplified = simplifier.indices.size() / 3;
+	CHECK(simplified <= triangles / 4 + 2 && simplified >= triangles / 8);
+	CHECK(FacesValid(sphere, simplifier));
+	CHECK(Closed(sphere, simplifier));
+
+	// Wedges used from a seam position stay with the other wedges there,
+	//   patch corners, where three patches meet, keep all three wedges
+	std::vector<bool> used(sphere->vertexCount, false);
+	for (uint i = 0; i < simplifier.vertices.size(); i++) used[simplifier.vertices[i]] = true;
+	bool seamsKept = true, cornersKept = true;
+	for (int v = 0; v < sphere->vertexCount; v++) {
+		int wedges = 0, usedWedges = 0;
+		for (int w = 0; w < sphere->vertexCount; w++) {
+			if (!SamePosition(sphere, v, w)) continue;
+			wedges++;
+			if (used[w]) usedWedges++;
+		}
+		if (used[v] && wedges > 1 && usedWedges != wedges) seamsKept = false;
+		if (wedges == 3 && usedWedges != 3) cornersKept = false;
+	}
+	CHECK(seamsKept);
+	CHECK(cornersKept);
+	delete sphere;
+
+	// Border vertices are locked, all of them stay
+	TestMesh* terrain = CreateTerrainMesh();
+	triangles = terrain->indexCount / 3;
+	Simplifier border(terrain);
+	border.simplify(0.25);
+	simplified = border.indices.size() / 3;
+	CHECK(simplified <= triangles / 4 + 2);
+	CHECK(FacesValid(terrain, border));
+	int n = SIMPLIFIER_TEST_GRID * 2;
+	std::vector<bool> kept(terrain->vertexCount, false);
+	for (uint i = 0; i < border.vertices.size(); i++) kept[border.vertices[i]] = true;
+	bool bordersKept = true;
+	for (int j = 0; j <= n; j++) {
+		for (int i = 0; i <= n; i++) {
+			if (i > 0 && i < n && j > 0 && j < n) continue;
+			if (!kept[j * (n + 1) + i]) bordersKept = false;
+		}
+	}
+	CHECK(bordersKept);
+	delete terrain;
+}
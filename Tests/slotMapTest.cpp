@@ -0,0 +1,60 @@
+#include "test.h"
+#include "util/slotMap.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+void TestSlotMap() {
+	SlotMap<int*> map;
+	std::vector<int> items(3000);
+	std::vector<uint> handles;
+	for (uint i = 0; i < items.size(); i++) {
+		items[i] = i;
+		handles.push_back(map.add(&items[i]));
+		CHECK(handles.back() != INVALID_HANDLE);
+	}
+	CHECK(map.size() == items.size());
+
+	// Removed handles go stale, reused slots get a new generation
+	for (uint i = 0; i < items.size(); i += 3) CHECK(map.remove(handles[i]));
+	int* value = NULL;
+	CHECK(!map.get(handles[0], value) && !map.contains(handles[0]));
+	CHECK(!map.remove(handles[0]));
+	uint reused = map.add(&items[0]);
+	uint slot = reused & SLOT_INDEX_MASK;
+	CHECK(slot < items.size() && slot % 3 == 0 && reused != handles[slot]);
+	CHECK(map.get(reused, value) && value == &items[0]);
+	CHECK(!map.get(handles[slot], value));
+	for (uint i = 1; i < items.size(); i++) {
+		bool alive = i % 3 != 0;
+		CHECK(map.get(handles[i], value) == alive);
+		if (alive) CHECK(value == &items[i]);
+	}
+
+	// Dense values stay paired with their handles
+	bool paired = true;
+	for (uint i = 0; i < map.size(); i++)
+		paired = paired && map.get(map.handles[i], value) && value == map.values[i];
+	CHECK(paired);
+
+	// Lock free readers see a live value or a stale handle, never another one's value
+	std::vector<uint> readHandles = handles;
+	std::atomic<bool> quit(false);
+	std::atomic<int> wrong(0);
+	std::thread reader([&]() {
+		while (!quit.load()) {
+			for (uint i = 1; i < readHandles.size(); i++) {
+				int* found = NULL;
+				if (map.get(readHandles[i], found) && found != &items[i]) wrong++;
+			}
+		}
+	});
+	for (int round = 0; round < 200; round++) {
+		for (uint i = 1; i < handles.size(); i += 7) {
+			if (map.remove(handles[i])) handles[i] = map.add(&items[i]);
+		}
+	}
+	quit = true;
+	reader.join();
+	CHECK(wrong.load() == 0);
+}
@@ -0,0 +1,50 @@
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <stdio.h>
+#include <chrono>
+
+extern int TestFailures;
+
+#define CHECK(cond) \
+	do { if (!(cond)) { printf("  %s:%d check failed: %s\n", __FILE__, __LINE__, #cond); TestFailures++; } } while (0)
+
+typedef std::chrono::high_resolution_clock::time_point TestTime;
+
+inline TestTime TestNow() {
+	return std::chrono::high_resolution_clock::now();
+}
+
+inline double ElapsedMs(const TestTime& start) {
+	return std::chrono::duration<double, std::milli>(TestNow() - start).count();
+}
+
+// Deterministic random numbers, so failures can be reproduced
+inline float TestRandom(unsigned int& seed, float low, float high) {
+	seed = seed * 1664525u + 1013904223u;
+	return low + (high - low) * ((seed >> 8) / 16777216.0f);
+}
+
+// Tests are cheap checks run by default, benchmarks run with "bench" argument
+void TestCullBoxes();
+void BenchCullBoxes();
+void TestBvhCull();
+void TestSeparatingAxis();
+void BenchSeparatingAxis();
+void TestPool();
+void BenchPool();
+void TestInstanceRecord();
+void BenchInstanceRecord();
+void TestJobSystem();
+void BenchFramePipeline();
+void TestSlotMap();
+void TestFrameArena();
+void TestRadixSort();
+void TestSceneCommandQueue();
+void TestUpdateSelect();
+void TestSimplifier();
+void TestMeshOptimizer();
+void TestModelWeld();
+void TestObjParse();
+
+#endif
@@ -0,0 +1,74 @@
+#include "test.h"
+#include "scene/updateSelect.h"
+#include <limits.h>
+#include <vector>
+
+// Fields of Node that SelectUpdates reads
+struct UpdateNode {
+	uint deferredFrames;
+	bool needUpdateBounds;
+	bool inView;
+	std::vector<int> objects;
+	UpdateNode(uint objectCount, bool view) :deferredFrames(0), needUpdateBounds(false), inView(view), objects(objectCount) {}
+};
+
+// One frame of Scene::updateNodeList with given passes, updated nodes are finished & removed,
+//   returns whether node was updated
+static bool RunUpdateFrame(std::vector<UpdateNode*>& pending, UpdateNode* node, float budgetCount, int passes) {
+	bool updated = false;
+	for (int pass = 0; pass < passes; pass++) {
+		std::vector<UpdateNode*> updateList;
+		SelectUpdates(pending, updateList, [](UpdateNode* n) { return n->inView; }, budgetCount, pass == passes - 1);
+		for (uint i = 0; i < updateList.size(); i++) {
+			updateList[i]->deferredFrames = 0;
+			updateList[i]->needUpdateBounds = false;
+			if (updateList[i] == node) updated = true;
+		}
+	}
+	return updated;
+}
+
+void TestUpdateSelect() {
+	// An off-screen node with no budget is put off UPDATE_MAX_DEFER frames, then forced through,
+	//   frames with two passes (partition relocate) count once
+	UpdateNode offScreen(10, false);
+	std::vector<UpdateNode*> pending;
+	int frame = 0;
+	bool updated = false;
+	while (!updated && frame <= UPDATE_MAX_DEFER + 1) {
+		pending.push_back(&offScreen);
+		updated = RunUpdateFrame(pending, &offScreen, 0, 2);
+		if (!updated) {
+			CHECK(pending.size() == 1 && pending[0] == &offScreen);
+			pending.clear();
+		}
+		frame++;
+	}
+	CHECK(updated && frame == UPDATE_MAX_DEFER + 1);
+	CHECK(pending.empty() && offScreen.deferredFrames == 0);
+
+	// A node with stale bounds is never deferred, even off-screen with no budget
+	UpdateNode moved(10, false);
+	moved.needUpdateBounds = true;
+	pending.assign(1, &moved);
+	CHECK(RunUpdateFrame(pending, &moved, 0, 1));
+	CHECK(pending.empty() && moved.deferredFrames == 0);
+
+	// In view nodes always go, off-screen ones only while budget lasts
+	UpdateNode visible(100, true), small(5, false), large(50, false);
+	pending.clear();
+	pending.push_back(&large);
+	pending.push_back(&visible);
+	pending.push_back(&small);
+	std::vector<UpdateNode*> updateList;
+	uint objectCount = SelectUpdates(pending, updateList, [](UpdateNode* n) { return n->inView; }, 120, true);
+	CHECK(objectCount == 105 && updateList.size() == 2);
+	CHECK(updateList[0] == &visible && updateList[1] == &small);
+	CHECK(pending.size() == 1 && pending[0] == &large && large.deferredFrames == 1);
+
+	// Without budget limit everything goes
+	pending.assign(1, &large);
+	updateList.clear();
+	CHECK(SelectUpdates(pending, updateList, [](UpdateNode* n) { return n->inView; }, (float)UINT_MAX, true) == 50);
+	CHECK(pending.empty() && updateList.size() == 1);
+}
@@ -0,0 +1,80 @@
+#include "test.h"
+#include "mesh/model.h"
+#include "material/materialManager.h"
+#include <stdio.h>
+
+#define WELD_TEST_OBJ "weldTest.obj"
+#define WELD_TEST_MTL "weldTest.mtl"
+
+static void WriteText(const char* path, const char* text) {
+	FILE* file = fopen(path, "wb");
+	if (!file) return;
+	fputs(text, file);
+	fclose(file);
+}
+
+// Triangle strip over count positions, each corner used by up to three faces welds into one vertex
+static void WriteStrip(const char* path, int count) {
+	FILE* file = fopen(path, "wb");
+	if (!file) return;
+	for (int i = 0; i < count; i++)
+		fprintf(file, "v %d %d 0\n", i / 2, i % 2);
+	fprintf(file, "vt 0 0\nvn 0 0 1\n");
+	for (int i = 0; i + 2 < count; i++) {
+		if (i % 2 == 0) fprintf(file, "f %d/1/1 %d/1/1 %d/1/1\n", i + 1, i + 2, i + 3);
+		else fprintf(file, "f %d/1/1 %d/1/1 %d/1/1\n", i + 2, i + 1, i + 3);
+	}
+	fclose(file);
+}
+
+// Expected vertices are counted by hand in the comments: a new corner is a position used
+//   with a texcoord, normal or material it did not have before
+static const char* WeldObj =
+	"mtllib weldTest.mtl\n"
+	"v 0 0 0\nv 1 0 0\nv 2 0 0\nv 0 1 0\nv 1 1 0\nv 2 1 0\n"
+	"vt 0 0\nvt 0.5 0\nvt 1 0\nvt 0 1\nvt 0.5 1\nvt 1 1\nvt 0.25 0.25\n"
+	"vn 0 0 1\n"
+	"usemtl red\n"
+	"f 1/1/1 2/2/1 5/5/1 4/4/1\n" // 1 2 5 4 new: 4
+	"f 2/2/1 3/3/1 6/6/1 5/5/1\n" // 3 6 new: 6
+	"f 1/1/1 5/5/1 4/4/1\n" // All shared: 6
+	"f 2/7/1 3/3/1 5/5/1\n" // 2 on a uv seam: 7
+	"usemtl blue\n"
+	"f 4/4/1 5/5/1 6/6/1\n" // Other material: 10
+	"f 4/4/1 6/6/1 5/5/1\n" // Same corners: 10
+	"f 1/1 2/2 4/4\n"; // Face normal equals vn 1, 1 & 2 new in blue: 12
+
+static const char* WeldMtl =
+	"newmtl red\nKd 1 0 0\n"
+	"newmtl blue\nKd 0 0 1\n";
+
+void TestModelWeld() {
+	MaterialManager::Init();
+	WriteText(WELD_TEST_OBJ, WeldObj);
+	WriteText(WELD_TEST_MTL, WeldMtl);
+	Model* model = new Model(WELD_TEST_OBJ, WELD_TEST_MTL, 2);
+	CHECK(model->vertexCount == 12);
+	CHECK(model->indexCount == 9 * 3);
+	bool inRange = true;
+	for (int i = 0; i < model->indexCount; i++)
+		inRange = inRange && model->indices[i] >= 0 && model->indices[i] < model->vertexCount;
+	CHECK(inRange);
+	delete model;
+
+	// Most vertices 16 bit indices address is SHORT_INDEX_VERTICES, one more needs 32 bit
+	WriteStrip(WELD_TEST_OBJ, SHORT_INDEX_VERTICES);
+	model = new Model(WELD_TEST_OBJ, WELD_TEST_MTL, 2);
+	CHECK(model->vertexCount == SHORT_INDEX_VERTICES);
+	CHECK(model->indexCount == (SHORT_INDEX_VERTICES - 2) * 3);
+	CHECK(model->fitsShortIndex());
+	delete model;
+
+	WriteStrip(WELD_TEST_OBJ, SHORT_INDEX_VERTICES + 1);
+	model = new Model(WELD_TEST_OBJ, WELD_TEST_MTL, 2);
+	CHECK(model->vertexCount == SHORT_INDEX_VERTICES + 1);
+	CHECK(!model->fitsShortIndex());
+	delete model;
+
+	remove(WELD_TEST_OBJ);
+	remove(WELD_TEST_MTL);
+}
@@ -8,6 +8,7 @@ Animation::Animation(const char* path) {
 	vertCount=0;
 	faceCount=0;
 	boneCount=0;
+	animationId=-1;
 	boneTransformMats=NULL;
 	aVertices.clear();
 	aNormals.clear();
@@ -101,6 +101,7 @@ public:
 
 	int animCount;
 	AnimFrame** animFrames;
+	int animationId; // Dense id given by AssetManager, -1 before
 public:
 	Animation(const char* path);
 	~Animation();
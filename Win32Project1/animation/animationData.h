@@ -4,6 +4,7 @@
 #include "../animation/animation.h"
 #include "../object/animationObject.h"
 #include "../constants/constants.h"
+#include "../util/arena.h"
 
 class AnimationDrawcall;
 
@@ -19,9 +20,11 @@ struct AnimationData {
 	half* weights;
 	ushort* indices;
 	int indexCount, vertexCount, animCount, maxAnim;
-	buff* transformsFull;
+	InstanceRecord* records;
+	FrameArena* arena; // If set transforms are taken from it each frame
 
-	AnimationData(Animation* anim, int maxCount) {
+	AnimationData(Animation* anim, int maxCount, FrameArena* frameArena = NULL) {
+		arena = frameArena;
 		animId = -1;
 		indexCount = anim->aIndices.size();
 		vertexCount = anim->aVertices.size();
@@ -62,14 +65,17 @@ struct AnimationData {
 			indices[i] = (ushort)(anim->aIndices[i]);
 
 		maxAnim = maxCount;
-		transformsFull = (buff*)malloc(maxAnim * 16 * sizeof(buff));
-		memset(transformsFull, 0, maxAnim * 16 * sizeof(buff));
+		records = NULL;
+		if (!arena) {
+			records = (InstanceRecord*)malloc(maxAnim * sizeof(InstanceRecord));
+			memset(records, 0, maxAnim * sizeof(InstanceRecord));
+		}
 		animCount = 0;
 	}
 	~AnimationData() {
 		releaseAnimData();
-		free(transformsFull);
-		transformsFull = NULL;
+		if (records && !arena) free(records);
+		records = NULL;
 	}
 	void releaseAnimData() {
 		if (vertices) free(vertices); vertices = NULL;
@@ -84,16 +90,17 @@ struct AnimationData {
 	}
 	void resetAnims() {
 		animCount = 0;
+		if (arena) records = NULL;
 	}
 	void addAnimObject(Object* object) {
-		if (transformsFull) {
-			memcpy(transformsFull + (animCount * 16), object->transformsFull, 12 * sizeof(buff));
+		if (animCount >= maxAnim) return;
+		if (!records && arena)
+			records = arena->allocArray<InstanceRecord>(maxAnim);
+		if (records && object->record) {
+			records[animCount] = *(object->record);
 
 			AnimationObject* animObj = (AnimationObject*)object;
-			transformsFull[animCount * 16 + 12] = animObj->fid + 0.1;
-			transformsFull[animCount * 16 + 13] = animObj->getCurFrame();
-			transformsFull[animCount * 16 + 14] = 0.0;
-			transformsFull[animCount * 16 + 15] = animId + 0.1;
+			PackAnimFrame(records + animCount, animObj->fid, animObj->getCurFrame(), animId);
 			animCount++;
 		}
 	}
@@ -22,6 +22,11 @@ Application::Application() {
 	config->getBool("dynsky", cfgs->dynsky);
 	config->getBool("cartoon", cfgs->cartoon);
 	config->getBool("debug", cfgs->debug);
+	config->getBool("partition", cfgs->partition);
+	config->getBool("coherentcull", cfgs->coherentcull);
+	config->getInt("framedepth", cfgs->frameDepth);
+	config->getFloat("updatebudget", cfgs->updateBudget);
+	config->getInt("tribudget", cfgs->triBudget);
 
 	windowWidth = cfgs->width;
 	windowHeight = cfgs->height;
@@ -38,16 +43,20 @@ Application::Application() {
 
 void Application::init() {
 	printf("Init app\n");
+	JobSystem::Init();
 	render = new Render();
 	render->initShaders(cfgs);
 	AssetManager::Init();
 	MaterialManager::Init();
+	InstanceBuffer::Init();
 	scene = new Scene();
+	scene->updateBudget = cfgs->updateBudget;
 	input = new Input();
 
-	float lowDist = cfgs->graphQuality > 4 ? 800 : 200;
-	float farDist = cfgs->graphQuality > 4 ? 1500 : 800;
-	renderMgr = new RenderManager(cfgs, scene->mainCamera, lowDist, farDist, vec3(-1, -1, -1));
+	// Projected radius in pixels objects switch to mid & low mesh below
+	float midPixels = cfgs->graphQuality > 4 ? 8 : 24;
+	float lowPixels = cfgs->graphQuality > 4 ? 3 : 8;
+	renderMgr = new RenderManager(cfgs, scene->mainCamera, midPixels, lowPixels, vec3(-1, -1, -1));
 
 	if (!cfgs->ssr)
 		scene->createReflectCamera();
@@ -64,11 +73,13 @@ Application::~Application() {
 	MaterialManager::Release();
 	AssetManager::Release();
 	delete scene; scene = NULL;
+	InstanceBuffer::Release();
 	delete render; render = NULL;
 	delete input; input = NULL;
 	delete renderMgr; renderMgr = NULL;
 	delete config;
 	free(cfgs);
+	JobSystem::Release();
 }
 
 void Application::act(long startTime, long currentTime, float velocity) {
@@ -96,10 +107,23 @@ void Application::mouseKey(bool press, bool isMain) {
 	pressed = press;
 }
 
-void Application::prepare(bool swapQueue) {
-	scene->mainCamera->updateFrustum(); // Update main camera's frustum for cull
-	renderMgr->updateMainLight(); // Update shadow cameras' frustum for cull
-	renderMgr->swapRenderQueues(scene, swapQueue); // Caculate cull result
+// On draw thread, camera state the following prepares cull with
+void Application::snapshotFrame() {
+	renderMgr->snapshotCamera(scene->mainCamera);
+}
+
+bool Application::canPrepare() {
+	return renderMgr->canPrepareFrame();
+}
+
+// Caculate cull result into a free frame, false if all frames are in use
+bool Application::prepare() {
+	return renderMgr->prepareFrame(scene);
+}
+
+// On draw thread, draw next prepared frame if there is one
+bool Application::acquireFrame() {
+	return renderMgr->acquireFrame();
 }
 
 void Application::animate(float velocity) {
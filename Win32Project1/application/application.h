@@ -6,6 +6,8 @@
 #include "../render/renderManager.h"
 #include "../material/materialManager.h"
 #include "../assets/assetManager.h"
+#include "../instance/instanceBuffer.h"
+#include "../util/jobSystem.h"
 
 class Application {
 private:
@@ -34,7 +36,10 @@ public:
 	virtual void wheelAct(int dir);
 	virtual void moveMouse(const float mx, const float my, const float cx, const float cy);
 	virtual void mouseKey(bool press, bool isMain);
-	void prepare(bool swapQueue);
+	void snapshotFrame();
+	bool canPrepare();
+	bool prepare();
+	bool acquireFrame();
 	void animate(float velocity);
 	virtual void resize(int width, int height);
 	virtual void keyDown(int key);
@@ -4,7 +4,9 @@
 #include "../mesh/board.h"
 #include "../mesh/quad.h"
 #include "../mesh/terrain.h"
+#include "../mesh/model.h"
 #include "../constants/constants.h"
+#include <set>
 using namespace std;
 
 AssetManager* AssetManager::assetManager = NULL;
@@ -25,9 +27,13 @@ AssetManager::AssetManager() {
 }
 
 AssetManager::~AssetManager() {
+	// Lod names may alias the level before
+	set<Mesh*> owned;
 	map<string, Mesh*>::iterator itor;
 	for (itor = meshes.begin(); itor != meshes.end(); itor++)
-		delete itor->second;
+		owned.insert(itor->second);
+	for (set<Mesh*>::iterator it = owned.begin(); it != owned.end(); it++)
+		delete *it;
 	meshes.clear();
 	map<string, Animation*>::iterator iter;
 	for (iter = animations.begin(); iter != animations.end(); iter++)
@@ -138,14 +144,64 @@ void AssetManager::createHeightTex() {
 	heightTexture = new Texture2D(MAP_SIZE, MAP_SIZE, TEXTURE_TYPE_COLOR, HIGH_PRE, 1, true, heightData);
 }
 
+// Meshes used by objects without being added by name get an id on first use
+int AssetManager::assignMeshId(Mesh* mesh) {
+	if (mesh->meshId < 0) {
+		mesh->meshId = meshList.size();
+		meshList.push_back(mesh);
+	}
+	return mesh->meshId;
+}
+
+int AssetManager::assignAnimationId(Animation* animation) {
+	if (animation->animationId < 0) {
+		animation->animationId = animationList.size();
+		animationList.push_back(animation);
+	}
+	return animation->animationId;
+}
+
 void AssetManager::addMesh(const char* name, Mesh* mesh, bool billboard, bool drawShadow) {
+	assignMeshId(mesh);
 	mesh->setName(name);
 	meshes[name] = mesh;
 	meshes[name]->setIsBillboard(billboard);
 	meshes[name]->drawShadow = drawShadow;
 }
 
+// Simplified levels of model name added as name + "Mid" & name + "Low",
+//   each keeps ratio of the triangles of the level before, a level removing
+//   less than LOD_MIN_REDUCTION of what was asked is dropped & aliases the level before
+void AssetManager::addMeshLods(const char* name, float ratio) {
+	if (meshes.count(name) <= 0) return;
+	Model* model = dynamic_cast<Model*>(meshes[name]);
+	if (!model) return;
+
+	static const char* suffixes[] = { "Mid", "Low" };
+	std::string base(name);
+	Model* last = model;
+	bool reduced = true;
+	for (int i = 0; i < 2; i++) {
+		std::string levelName = base + suffixes[i];
+		if (reduced) {
+			Model* level = new Model(*last, ratio);
+			float kept = (float)level->indexCount / last->indexCount;
+			reduced = 1.0 - kept >= (1.0 - ratio) * LOD_MIN_REDUCTION;
+			printf("mesh %s: %d -> %d triangles, kept %.2f of asked %.2f%s\n", levelName.data(), 
+				last->indexCount / 3, level->indexCount / 3, kept, ratio, reduced ? "" : ", use level before");
+			if (reduced) {
+				addMesh(levelName.data(), level, model->isBillboard, model->drawShadow);
+				last = level;
+				continue;
+			}
+			delete level;
+		}
+		meshes[levelName] = last;
+	}
+}
+
 void AssetManager::addAnimation(const char* name, Animation* animation) {
+	assignAnimationId(animation);
 	animations[name] = animation;
 	animation->setName(name);
 	frames->addAnimation(animation);
@@ -2,6 +2,7 @@
 #define ASSETMANAGER_H_
 
 #define COMMON_TEXTURE "texture/common"
+#define LOD_MIN_REDUCTION 0.9 // Part of asked triangle reduction a generated lod must reach
 
 #include "../mesh/mesh.h"
 #include "../animation/frameMgr.h"
@@ -18,6 +19,8 @@ public:
 public:
 	std::map<std::string, Mesh*> meshes;
 	std::map<std::string, Animation*> animations;
+	std::vector<Mesh*> meshList; // Indexed by mesh id
+	std::vector<Animation*> animationList; // Indexed by animation id
 	FrameMgr* frames;
 	TextureBindless* texBld;
 	CubeMap* skyTexture;
@@ -31,7 +34,12 @@ private:
 	~AssetManager();
 public:
 	void addMesh(const char* name, Mesh* mesh, bool billboard = false, bool drawShadow = true);
+	void addMeshLods(const char* name, float ratio);
 	void addAnimation(const char* name, Animation* animation);
+	int assignMeshId(Mesh* mesh);
+	int assignAnimationId(Animation* animation);
+	uint getMeshCount() { return meshList.size(); }
+	uint getAnimationCount() { return animationList.size(); }
 	void initFrames();
 	void addTextureBindless(const char* name, bool srgb, int wrap = WRAP_REPEAT);
 	void initTextureBindless(MaterialManager* mtls);
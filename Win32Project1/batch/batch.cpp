@@ -18,6 +18,7 @@ Batch::Batch() {
 	fullStatic = false;
 	type = BATCH_TYPE_DYNAMIC;
 	objectCount = 0;
+	materialSet = 0;
 	modelMatrices = NULL;
 	matrixDataPtr = NULL;
 	normalMatrices = NULL;
@@ -57,6 +58,7 @@ void Batch::flushBatchBuffers() {
 	vertexCount = 0;
 	indexCount = 0;
 	objectCount = 0;
+	materialSet = 0;
 }
 
 void Batch::initBatchBuffers(int vertCount, int indCount) {
@@ -94,6 +96,7 @@ void Batch::pushMeshToBuffers(Mesh* mesh,int mid,bool fullStatic,const mat4& tra
 
 		if (mesh->materialids)
 			mat = MaterialManager::materials->find(mesh->materialids[i]);
+		materialSet |= (u64)1 << (mat->id & 63);
 
 		if (!fullStatic) {
 			vec3 vertex3 = mesh->vertices3[i];
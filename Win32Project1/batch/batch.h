@@ -37,6 +37,7 @@ public:
 
 	bool fullStatic;
 	unsigned short objectCount;
+	u64 materialSet; // Bit per material id modulo 64 packed into buffers
 	float* modelMatrices;
 	float* normalMatrices;
 	float* matrixDataPtr;
@@ -1,4 +1,5 @@
 #include "aabb.h"
+#include <math.h>
 
 AABB::AABB(const vec3& min,const vec3& max) {
 	minVertex.x=min.x; minVertex.y=min.y; minVertex.z=min.z;
@@ -10,15 +11,6 @@ AABB::AABB(const vec3& min,const vec3& max) {
 	position.x = minVertex.x + halfSize.x;
 	position.y = minVertex.y + halfSize.y;
 	position.z = minVertex.z + halfSize.z;
-
-	vertices[0]=vec3(min.x,min.y,min.z);
-	vertices[1]=vec3(max.x,min.y,min.z);
-	vertices[2]=vec3(min.x,max.y,min.z);
-	vertices[3]=vec3(max.x,max.y,min.z);
-	vertices[4]=vec3(min.x,min.y,max.z);
-	vertices[5]=vec3(max.x,min.y,max.z);
-	vertices[6]=vec3(min.x,max.y,max.z);
-	vertices[7]=vec3(max.x,max.y,max.z);
 }
 
 AABB::AABB(const vec3& pos,float sx,float sy,float sz) {
@@ -27,15 +19,6 @@ AABB::AABB(const vec3& pos,float sx,float sy,float sz) {
 	sizex=sx; sizey=sy; sizez=sz;
 	halfSize = vec3(sizex, sizey, sizez) * 0.5;
 	position.x=pos.x; position.y=pos.y; position.z=pos.z;
-
-	vertices[0]=vec3(minVertex.x,minVertex.y,minVertex.z);
-	vertices[1]=vec3(maxVertex.x,minVertex.y,minVertex.z);
-	vertices[2]=vec3(minVertex.x,maxVertex.y,minVertex.z);
-	vertices[3]=vec3(maxVertex.x,maxVertex.y,minVertex.z);
-	vertices[4]=vec3(minVertex.x,minVertex.y,maxVertex.z);
-	vertices[5]=vec3(maxVertex.x,minVertex.y,maxVertex.z);
-	vertices[6]=vec3(minVertex.x,maxVertex.y,maxVertex.z);
-	vertices[7]=vec3(maxVertex.x,maxVertex.y,maxVertex.z);
 }
 
 AABB::AABB(const AABB& rhs) {
@@ -48,8 +31,6 @@ AABB::AABB(const AABB& rhs) {
 	position.x=rhs.position.x;
 	position.y=rhs.position.y;
 	position.z=rhs.position.z;
-	for(int i=0;i<8;i++)
-		vertices[i]=rhs.vertices[i];
 }
 
 AABB::~AABB() {
@@ -66,15 +47,6 @@ void AABB::update(const vec3& newMinVertex,const vec3& newMaxVertex) {
 	position.x = minVertex.x + halfSize.x;
 	position.y = minVertex.y + halfSize.y;
 	position.z = minVertex.z + halfSize.z;
-
-	vertices[0].x=newMinVertex.x; vertices[0].y=newMinVertex.y; vertices[0].z=newMinVertex.z;
-	vertices[1].x=newMaxVertex.x; vertices[1].y=newMinVertex.y; vertices[1].z=newMinVertex.z;
-	vertices[2].x=newMinVertex.x; vertices[2].y=newMaxVertex.y; vertices[2].z=newMinVertex.z;
-	vertices[3].x=newMaxVertex.x; vertices[3].y=newMaxVertex.y; vertices[3].z=newMinVertex.z;
-	vertices[4].x=newMinVertex.x; vertices[4].y=newMinVertex.y; vertices[4].z=newMaxVertex.z;
-	vertices[5].x=newMaxVertex.x; vertices[5].y=newMinVertex.y; vertices[5].z=newMaxVertex.z;
-	vertices[6].x=newMinVertex.x; vertices[6].y=newMaxVertex.y; vertices[6].z=newMaxVertex.z;
-	vertices[7].x=newMaxVertex.x; vertices[7].y=newMaxVertex.y; vertices[7].z=newMaxVertex.z;
 }
 
 void AABB::update(float sx, float sy, float sz) {
@@ -90,7 +62,7 @@ AABB* AABB::clone() {
 	return new AABB(*this);
 }
 
-bool AABB::vertexInsideCamera(const vec3& vertex, const Frustum* frustum) {
+static bool VertexInsideFrustum(const vec3& vertex, const Frustum* frustum) {
 	for(int i=0;i<6;i++) {
 		if(frustum->normals[i].DotProduct(vertex)+frustum->ds[i]<0)
 			return false;
@@ -98,156 +70,83 @@ bool AABB::vertexInsideCamera(const vec3& vertex, const Frustum* frustum) {
 	return true;
 }
 
-bool AABB::intersectsWidthRay(const vec3& origin,const vec3& dir,float maxDistance) {
-	float distance=0;
-	static vec3 vertex;
-
-	if(dir.x!=0) {
-		float d[2]={vertices[0].x,vertices[7].x};
-		float invDirX = 1.0 / dir.x;
-		for(int i=0;i<2;i++) {
-			distance=(d[i]-origin.x)*invDirX;
-			if(distance>=0&&distance<=maxDistance) {
-				vertex=dir*distance+origin;
-				if(vertex.y>=vertices[0].y&&vertex.y<=vertices[7].y&&vertex.z>=vertices[0].z&&vertex.z<=vertices[7].z)
-					return true;
-			}
-		}
-	}
-
-	if(dir.y!=0) {
-		float d[2]={vertices[0].y,vertices[7].y};
-		float invDirY = 1.0 / dir.y;
-		for(int i=0;i<2;i++) {
-			distance=(d[i]-origin.y)*invDirY;
-			if(distance>=0&&distance<=maxDistance) {
-				vertex=dir*distance+origin;
-				if(vertex.x>=vertices[0].x&&vertex.x<=vertices[7].x&&vertex.z>=vertices[0].z&&vertex.z<=vertices[7].z)
-					return true;
-			}
-		}
+// Exact box-frustum test, the box is outside if any axis separates them
+static int SeparatingAxisTest(const Frustum* frustum, const vec3& position, const vec3& halfSize) {
+	bool inside = true;
+	for (int i = 0; i < 6; i++) {
+		const vec3& n = frustum->normals[i];
+		float dist = n.DotProduct(position) + frustum->ds[i];
+		float radius = fabsf(n.x) * halfSize.x + fabsf(n.y) * halfSize.y + fabsf(n.z) * halfSize.z;
+		if (dist + radius < 0) return FRUSTUM_OUTSIDE;
+		if (dist - radius < 0) inside = false;
 	}
-
-	if(dir.z!=0) {
-		float d[2]={vertices[0].z,vertices[7].z};
-		float invDirZ = 1.0 / dir.z;
-		for(int i=0;i<2;i++) {
-			distance=(d[i]-origin.z)*invDirZ;
-			if(distance>=0&&distance<=maxDistance) {
-				vertex=dir*distance+origin;
-				if(vertex.x>=vertices[0].x&&vertex.x<=vertices[7].x&&vertex.y>=vertices[0].y&&vertex.y<=vertices[7].y)
-					return true;
-			}
-		}
+	if (inside) return FRUSTUM_INSIDE;
+
+	if (frustum->maxVertex.x < position.x - halfSize.x || frustum->minVertex.x > position.x + halfSize.x ||
+		frustum->maxVertex.y < position.y - halfSize.y || frustum->minVertex.y > position.y + halfSize.y ||
+		frustum->maxVertex.z < position.z - halfSize.z || frustum->minVertex.z > position.z + halfSize.z)
+		return FRUSTUM_OUTSIDE;
+
+	for (int i = 0; i < frustum->axisCount; i++) {
+		const vec3& axis = frustum->axes[i];
+		float center = axis.DotProduct(position);
+		float radius = fabsf(axis.x) * halfSize.x + fabsf(axis.y) * halfSize.y + fabsf(axis.z) * halfSize.z;
+		if (center + radius < frustum->axisMin[i] || center - radius > frustum->axisMax[i])
+			return FRUSTUM_OUTSIDE;
 	}
-
-	return false;
-}
-
-bool AABB::cameraVertexInside(const vec3& vertex) {
-	if(vertex.x<minVertex.x)
-		return false;
-	if(vertex.x>maxVertex.x)
-		return false;
-	if(vertex.y<minVertex.y)
-		return false;
-	if(vertex.y>maxVertex.y)
-		return false;
-	if(vertex.z<minVertex.z)
-		return false;
-	if(vertex.z>maxVertex.z)
-		return false;
-	return true;
+	return FRUSTUM_INTERSECT;
 }
 
-bool AABB::checkWithCamera(Frustum* frustum, int checkLevel) {
-	if (checkLevel < 1) return true;
+// checkLevel 0: no culling, 1: box corners only, 2 and above: exact
+int BoxIntersectsFrustum(const Frustum* frustum, const vec3& center, const vec3& halfSize, int checkLevel) {
+	if (checkLevel < 1) return FRUSTUM_INTERSECT;
+	if (checkLevel >= 2) return SeparatingAxisTest(frustum, center, halfSize);
 
+	int insideCount = 0;
 	for (int i = 0; i < 8; i++) {
-		if (vertexInsideCamera(vertices[i], frustum))
-			return true;
-	}
-
-	if (checkLevel >= 2) {
-		for (int i = 0; i < 8; i++) {
-			if (cameraVertexInside(frustum->worldVertex[i]))
-				return true;
-		}
-
-		for (int i = 0; i < 4; i++) {
-			if (intersectsWidthRay(frustum->worldVertex[i + 4],
-					frustum->edgeDir[i], frustum->edgeLength[i]))
-				return true;
-		}
-	}
-
-	if (checkLevel >= 3) {
-		static vec3 right = vec3(1, 0, 0);
-		static vec3 far = vec3(0, 0, 1);
-		static vec3 left = vec3(-1, 0, 0);
-		static vec3 near = vec3(0, 0, -1);
-
-		if (frustum->intersectsWidthRay(vertices[0], right, sizex))
-			return true;
-		if (frustum->intersectsWidthRay(vertices[0], far, sizez))
-			return true;
-		if (frustum->intersectsWidthRay(vertices[7], left, sizex))
-			return true;
-		if (frustum->intersectsWidthRay(vertices[7], near, sizez))
-			return true;
-		if (frustum->intersectsWidthRay(vertices[4], right, sizex))
-			return true;
-		if (frustum->intersectsWidthRay(vertices[3], left, sizex))
-			return true;
-		if (frustum->intersectsWidthRay(vertices[2], far, sizez))
-			return true;
-		if (frustum->intersectsWidthRay(vertices[1], far, sizez))
-			return true;
+		vec3 corner(center.x + ((i & 1) ? halfSize.x : -halfSize.x),
+			center.y + ((i & 2) ? halfSize.y : -halfSize.y),
+			center.z + ((i & 4) ? halfSize.z : -halfSize.z));
+		if (VertexInsideFrustum(corner, frustum))
+			insideCount++;
 	}
+	if (insideCount == 8) return FRUSTUM_INSIDE;
+	return insideCount > 0 ? FRUSTUM_INTERSECT : FRUSTUM_OUTSIDE;
+}
 
-	if (checkLevel >= 4) {
-		static vec3 up = vec3(0, 1, 0);
-		static vec3 down = vec3(0, -1, 0);
-
-		if (frustum->intersectsWidthRay(vertices[0], up, sizey))
-			return true;
-		if (frustum->intersectsWidthRay(vertices[7], down, sizey))
-			return true;
-		if (frustum->intersectsWidthRay(vertices[4], up, sizey))
-			return true;
-		if (frustum->intersectsWidthRay(vertices[1], up, sizey))
-			return true;
-	}
+int AABB::intersectsFrustum(Frustum* frustum, int checkLevel) {
+	return BoxIntersectsFrustum(frustum, position, halfSize, checkLevel);
+}
 
-	return false;
+bool AABB::checkWithCamera(Frustum* frustum, int checkLevel) {
+	return intersectsFrustum(frustum, checkLevel) != FRUSTUM_OUTSIDE;
 }
 
+// Boxes may contain NULL for objects without bounding
 void AABB::merge(const std::vector<BoundingBox*>& others) {
-	if (others.size() > 0) {
-		AABB* first = (AABB*)(others[0]);
-		vec3 min = first->minVertex;
-		vec3 max = first->maxVertex;
-		if (others.size() > 1) {
-			for (unsigned int i = 1; i < others.size(); i++) {
-				AABB* other = (AABB*)(others[i]);
-				float sx = other->minVertex.x;
-				float sy = other->minVertex.y;
-				float sz = other->minVertex.z; 
-				float lx = other->maxVertex.x;
-				float ly = other->maxVertex.y;
-				float lz = other->maxVertex.z;
-
-				min.x = min.x > sx ? sx : min.x;
-				min.y = min.y > sy ? sy : min.y;
-				min.z = min.z > sz ? sz : min.z;
-				max.x = max.x < lx ? lx : max.x;
-				max.y = max.y < ly ? ly : max.y;
-				max.z = max.z < lz ? lz : max.z;
-			}
-		}
-		minVertex.x = min.x; minVertex.y = min.y; minVertex.z = min.z;
-		maxVertex.x = max.x; maxVertex.y = max.y; maxVertex.z = max.z;
-		update(minVertex, maxVertex);
+	uint first = 0;
+	while (first < others.size() && !others[first]) first++;
+	if (first >= others.size()) return;
+
+	AABB* firstBox = (AABB*)(others[first]);
+	vec3 min = firstBox->minVertex;
+	vec3 max = firstBox->maxVertex;
+	for (uint i = first + 1; i < others.size(); i++) {
+		AABB* other = (AABB*)(others[i]);
+		if (!other) continue;
+		float sx = other->minVertex.x;
+		float sy = other->minVertex.y;
+		float sz = other->minVertex.z; 
+		float lx = other->maxVertex.x;
+		float ly = other->maxVertex.y;
+		float lz = other->maxVertex.z;
+
+		min.x = min.x > sx ? sx : min.x;
+		min.y = min.y > sy ? sy : min.y;
+		min.z = min.z > sz ? sz : min.z;
+		max.x = max.x < lx ? lx : max.x;
+		max.y = max.y < ly ? ly : max.y;
+		max.z = max.z < lz ? lz : max.z;
 	}
+	update(min, max);
 }
-
@@ -12,17 +12,11 @@
 #include <vector>
 
 class AABB: public BoundingBox {
-private:
-	vec3 vertices[8];
 public:
 	float sizex, sizey, sizez;
 	vec3 halfSize;
 	vec3 minVertex, maxVertex;
 
-private:
-	bool vertexInsideCamera(const vec3& vertex, const Frustum* frustum);
-	bool intersectsWidthRay(const vec3& origin,const vec3& dir,float maxDistance);
-	bool cameraVertexInside(const vec3& vertex);
 public:
 	AABB(const vec3& min,const vec3& max);
 	AABB(const vec3& pos,float sx,float sy,float sz);
@@ -30,11 +24,14 @@ public:
 	virtual ~AABB();
 	virtual AABB* clone();
 	virtual bool checkWithCamera(Frustum* frustum, int checkLevel);
+	virtual int intersectsFrustum(Frustum* frustum, int checkLevel);
 	void update(const vec3& newMinVertex,const vec3& newMaxVertex);
 	void update(float sx, float sy, float sz);
 	virtual void update(const vec3& pos);
 	virtual void merge(const std::vector<BoundingBox*>& others);
 };
 
+// Box given by center & half size against frustum, same result as AABB::intersectsFrustum
+int BoxIntersectsFrustum(const Frustum* frustum, const vec3& center, const vec3& halfSize, int checkLevel);
 
 #endif /* AABB_H_ */
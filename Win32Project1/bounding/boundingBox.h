@@ -10,8 +10,13 @@
 
 #include "../maths/Maths.h"
 #include "../camera/camera.h"
+#include "../util/pool.h"
 #include <vector>
 
+#define FRUSTUM_OUTSIDE 0
+#define FRUSTUM_INTERSECT 1
+#define FRUSTUM_INSIDE 2
+
 class BoundingBox {
 public:
 	vec3 position;
@@ -19,8 +24,11 @@ public:
 	BoundingBox() :position(vec3(0, 0, 0)) {}
 	BoundingBox(const BoundingBox& rhs) {}
 	virtual ~BoundingBox() {}
+	static void* operator new(size_t size) { return PoolAlloc(size); }
+	static void operator delete(void* p, size_t size) { PoolFree(p, size); }
 	virtual BoundingBox* clone()=0;
 	virtual bool checkWithCamera(Frustum* frustum,int checkLevel)=0;
+	virtual int intersectsFrustum(Frustum* frustum, int checkLevel)=0;
 	virtual void update(const vec3& pos)=0;
 	virtual void merge(const std::vector<BoundingBox*>& others)=0;
 };
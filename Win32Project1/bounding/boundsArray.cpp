@@ -0,0 +1,164 @@
+#include "boundsArray.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__AVX__)
+#define CULL_AVX
+#include <immintrin.h>
+#elif defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULL_SSE
+#include <emmintrin.h>
+#endif
+
+// Box without bounding should never be culled
+#define UNBOUNDED_EXTENT 1e18
+
+float* AllocBoundsData(int size) {
+#if defined(CULL_AVX) || defined(CULL_SSE)
+	return (float*)_mm_malloc(size * sizeof(float), 32);
+#else
+	return (float*)malloc(size * sizeof(float));
+#endif
+}
+
+void FreeBoundsData(void* data) {
+	if (!data) return;
+#if defined(CULL_AVX) || defined(CULL_SSE)
+	_mm_free(data);
+#else
+	free(data);
+#endif
+}
+
+BoundsArray::BoundsArray(int size) {
+	centerX = NULL; centerY = NULL; centerZ = NULL;
+	extentX = NULL; extentY = NULL; extentZ = NULL;
+	masks = NULL;
+	count = 0;
+	capacity = 0;
+	reserve(size);
+}
+
+BoundsArray::~BoundsArray() {
+	FreeBoundsData(centerX); FreeBoundsData(centerY); FreeBoundsData(centerZ);
+	FreeBoundsData(extentX); FreeBoundsData(extentY); FreeBoundsData(extentZ);
+	FreeBoundsData(masks);
+}
+
+void BoundsArray::reserve(int size) {
+	if (size <= capacity) return;
+	int newCapacity = ((size + 7) / 8) * 8;
+	float** arrays[6] = { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ };
+	for (int i = 0; i < 6; i++) {
+		float* data = AllocBoundsData(newCapacity);
+		if (*arrays[i]) {
+			memcpy(data, *arrays[i], count * sizeof(float));
+			FreeBoundsData(*arrays[i]);
+		}
+		*arrays[i] = data;
+	}
+	FreeBoundsData(masks);
+	masks = (uint*)AllocBoundsData(newCapacity);
+	capacity = newCapacity;
+}
+
+void BoundsArray::add(const BoundingBox* box) {
+	reserve(count + 1);
+	set(count++, box);
+}
+
+void BoundsArray::set(int i, const BoundingBox* box) {
+	if (box) {
+		const AABB* aabb = (const AABB*)box;
+		centerX[i] = aabb->position.x;
+		centerY[i] = aabb->position.y;
+		centerZ[i] = aabb->position.z;
+		extentX[i] = aabb->halfSize.x;
+		extentY[i] = aabb->halfSize.y;
+		extentZ[i] = aabb->halfSize.z;
+	} else {
+		centerX[i] = 0; centerY[i] = 0; centerZ[i] = 0;
+		extentX[i] = UNBOUNDED_EXTENT; 
+		extentY[i] = UNBOUNDED_EXTENT; 
+		extentZ[i] = UNBOUNDED_EXTENT;
+	}
+}
+
+void BoundsArray::clearMasks() {
+	if (count > 0) memset(masks, 0, count * sizeof(uint));
+}
+
+// A box is outside if it lies completely behind one of the frustum planes:
+//   dot(n, center) + d + dot(abs(n), extent) < 0
+void CullBoxes(const Frustum* frustum, BoundsArray* bounds, int start, int end, uint bit) {
+	CullBoxes(frustum, bounds, start, end, bit, bounds->masks);
+}
+
+void CullBoxes(const Frustum* frustum, const BoundsArray* bounds, int start, int end, uint bit, uint* masks) {
+	float nx[6], ny[6], nz[6], ax[6], ay[6], az[6], d[6];
+	for (int p = 0; p < 6; p++) {
+		nx[p] = frustum->normals[p].x; ax[p] = fabsf(nx[p]);
+		ny[p] = frustum->normals[p].y; ay[p] = fabsf(ny[p]);
+		nz[p] = frustum->normals[p].z; az[p] = fabsf(nz[p]);
+		d[p] = frustum->ds[p];
+	}
+
+	const float* cx = bounds->centerX;
+	const float* cy = bounds->centerY;
+	const float* cz = bounds->centerZ;
+	const float* ex = bounds->extentX;
+	const float* ey = bounds->extentY;
+	const float* ez = bounds->extentZ;
+	int i = start;
+
+#if defined(CULL_AVX)
+	const __m256 zero8 = _mm256_setzero_ps();
+	const __m256 bit8 = _mm256_castsi256_ps(_mm256_set1_epi32(bit));
+	for (; i + 8 <= end; i += 8) {
+		__m256 bcx = _mm256_loadu_ps(cx + i), bcy = _mm256_loadu_ps(cy + i), bcz = _mm256_loadu_ps(cz + i);
+		__m256 bex = _mm256_loadu_ps(ex + i), bey = _mm256_loadu_ps(ey + i), bez = _mm256_loadu_ps(ez + i);
+		__m256 outside = zero8;
+		for (int p = 0; p < 6; p++) {
+			__m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(bcx, _mm256_set1_ps(nx[p])), 
+				_mm256_mul_ps(bcy, _mm256_set1_ps(ny[p]))), 
+				_mm256_add_ps(_mm256_mul_ps(bcz, _mm256_set1_ps(nz[p])), _mm256_set1_ps(d[p])));
+			__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(bex, _mm256_set1_ps(ax[p])), 
+				_mm256_mul_ps(bey, _mm256_set1_ps(ay[p]))), _mm256_mul_ps(bez, _mm256_set1_ps(az[p])));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(dist, radius), zero8, _CMP_LT_OQ));
+		}
+		float* out = (float*)(masks + i);
+		_mm256_storeu_ps(out, _mm256_or_ps(_mm256_loadu_ps(out), _mm256_andnot_ps(outside, bit8)));
+	}
+#endif
+
+#if defined(CULL_AVX) || defined(CULL_SSE)
+	const __m128 zero4 = _mm_setzero_ps();
+	const __m128 bit4 = _mm_castsi128_ps(_mm_set1_epi32(bit));
+	for (; i + 4 <= end; i += 4) {
+		__m128 bcx = _mm_loadu_ps(cx + i), bcy = _mm_loadu_ps(cy + i), bcz = _mm_loadu_ps(cz + i);
+		__m128 bex = _mm_loadu_ps(ex + i), bey = _mm_loadu_ps(ey + i), bez = _mm_loadu_ps(ez + i);
+		__m128 outside = zero4;
+		for (int p = 0; p < 6; p++) {
+			__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(bcx, _mm_set1_ps(nx[p])), 
+				_mm_mul_ps(bcy, _mm_set1_ps(ny[p]))), 
+				_mm_add_ps(_mm_mul_ps(bcz, _mm_set1_ps(nz[p])), _mm_set1_ps(d[p])));
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(bex, _mm_set1_ps(ax[p])), 
+				_mm_mul_ps(bey, _mm_set1_ps(ay[p]))), _mm_mul_ps(bez, _mm_set1_ps(az[p])));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, radius), zero4));
+		}
+		float* out = (float*)(masks + i);
+		_mm_storeu_ps(out, _mm_or_ps(_mm_loadu_ps(out), _mm_andnot_ps(outside, bit4)));
+	}
+#endif
+
+	for (; i < end; i++) {
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; p++) {
+			float dist = nx[p] * cx[i] + ny[p] * cy[i] + nz[p] * cz[i] + d[p];
+			float radius = ax[p] * ex[i] + ay[p] * ey[i] + az[p] * ez[i];
+			outside = dist + radius < 0;
+		}
+		if (!outside) masks[i] |= bit;
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef BOUNDS_ARRAY_H_
+#define BOUNDS_ARRAY_H_
+
+#include "aabb.h"
+
+// Boxes stored as center/extent arrays, so that several of them 
+//   can be tested against a frustum in one go
+struct BoundsArray {
+	float* centerX;
+	float* centerY;
+	float* centerZ;
+	float* extentX;
+	float* extentY;
+	float* extentZ;
+	uint* masks; // Culling result, one bit per camera
+	int count, capacity;
+
+	BoundsArray(int size);
+	~BoundsArray();
+	void reserve(int size);
+	void clear() { count = 0; }
+	void add(const BoundingBox* box);
+	void set(int i, const BoundingBox* box);
+	void clearMasks();
+};
+
+// Set bit in bounds->masks[i] for every box i in [start, end) not outside frustum
+void CullBoxes(const Frustum* frustum, BoundsArray* bounds, int start, int end, uint bit);
+// Same, results go to masks[i] so that bounds are only read
+void CullBoxes(const Frustum* frustum, const BoundsArray* bounds, int start, int end, uint bit, uint* masks);
+
+#endif
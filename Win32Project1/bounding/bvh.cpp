@@ -0,0 +1,298 @@
+#include "bvh.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+BvhCull::BvhCull() {
+	masks = NULL;
+	visibleList = NULL;
+	visibleCount = 0;
+	leafMasks = NULL;
+	capacity = 0;
+}
+
+BvhCull::~BvhCull() {
+	if (masks) free(masks);
+	masks = NULL;
+	if (visibleList) free(visibleList);
+	visibleList = NULL;
+	if (leafMasks) free(leafMasks);
+	leafMasks = NULL;
+}
+
+// Masks are all zero after reserve & reset
+void BvhCull::reserve(int boxCount) {
+	if (boxCount <= capacity) return;
+	if (masks) free(masks);
+	if (visibleList) free(visibleList);
+	if (leafMasks) free(leafMasks);
+	capacity = boxCount;
+	masks = (uint*)malloc(capacity * sizeof(uint));
+	visibleList = (int*)malloc(capacity * sizeof(int));
+	leafMasks = (uint*)malloc(capacity * sizeof(uint));
+	memset(masks, 0, capacity * sizeof(uint));
+	visibleCount = 0;
+}
+
+// Clear the masks touched by last culling
+void BvhCull::reset() {
+	for (int i = 0; i < visibleCount; i++)
+		masks[visibleList[i]] = 0;
+	visibleCount = 0;
+}
+
+BVH::BVH() {
+	nodes = NULL;
+	nodeCount = 0;
+	indices = NULL;
+	sortedBounds = new BoundsArray(0);
+	boxCount = 0;
+}
+
+BVH::~BVH() {
+	if (nodes) delete[] nodes;
+	nodes = NULL;
+	if (indices) free(indices);
+	indices = NULL;
+	delete sortedBounds; sortedBounds = NULL;
+}
+
+float SurfaceArea(const vec3& minVertex, const vec3& maxVertex) {
+	vec3 size = maxVertex - minVertex;
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+void MergeBox(vec3& minVertex, vec3& maxVertex, const vec3& otherMin, const vec3& otherMax) {
+	minVertex.x = minVertex.x > otherMin.x ? otherMin.x : minVertex.x;
+	minVertex.y = minVertex.y > otherMin.y ? otherMin.y : minVertex.y;
+	minVertex.z = minVertex.z > otherMin.z ? otherMin.z : minVertex.z;
+	maxVertex.x = maxVertex.x < otherMax.x ? otherMax.x : maxVertex.x;
+	maxVertex.y = maxVertex.y < otherMax.y ? otherMax.y : maxVertex.y;
+	maxVertex.z = maxVertex.z < otherMax.z ? otherMax.z : maxVertex.z;
+}
+
+void BVH::build(const BoundsArray* bounds) {
+	boxCount = bounds->count;
+	if (nodes) delete[] nodes;
+	if (indices) free(indices);
+	int maxNodes = boxCount > 0 ? boxCount * 2 - 1 : 1;
+	nodes = new BvhNode[maxNodes];
+	indices = (int*)malloc((boxCount + 1) * sizeof(int));
+
+	float* centers = (float*)malloc((boxCount * 3 + 1) * sizeof(float));
+	for (int i = 0; i < boxCount; i++) {
+		indices[i] = i;
+		centers[i * 3] = bounds->centerX[i];
+		centers[i * 3 + 1] = bounds->centerY[i];
+		centers[i * 3 + 2] = bounds->centerZ[i];
+	}
+
+	nodeCount = 1;
+	buildNode(0, 0, boxCount, bounds, centers, 0);
+	free(centers);
+
+	sortedBounds->reserve(boxCount);
+	sortedBounds->count = boxCount;
+	refit(bounds);
+}
+
+void BVH::buildNode(int nodeIndex, int first, int count, const BoundsArray* bounds, float* centers, int depth) {
+	BvhNode* node = nodes + nodeIndex;
+	node->first = first;
+	node->count = count;
+	node->left = -1;
+	if (count <= BVH_LEAF_SIZE || depth >= BVH_MAX_DEPTH - 1) return;
+
+	vec3 centerMin(centers[indices[first] * 3], centers[indices[first] * 3 + 1], centers[indices[first] * 3 + 2]);
+	vec3 centerMax = centerMin;
+	for (int i = first + 1; i < first + count; i++) {
+		float* c = centers + indices[i] * 3;
+		MergeBox(centerMin, centerMax, vec3(c[0], c[1], c[2]), vec3(c[0], c[1], c[2]));
+	}
+	vec3 extent = centerMax - centerMin;
+	const float* extents = extent;
+	int axis = 0;
+	if (extents[1] > extents[axis]) axis = 1;
+	if (extents[2] > extents[axis]) axis = 2;
+	float axisMin = ((const float*)centerMin)[axis], axisLength = extents[axis];
+	if (axisLength <= 0.0) return; // All centers at one point
+
+	int binCounts[BVH_BIN_COUNT];
+	vec3 binMin[BVH_BIN_COUNT], binMax[BVH_BIN_COUNT];
+	for (int b = 0; b < BVH_BIN_COUNT; b++) binCounts[b] = 0;
+	float binScale = BVH_BIN_COUNT / axisLength;
+	for (int i = first; i < first + count; i++) {
+		int id = indices[i];
+		int b = (int)((centers[id * 3 + axis] - axisMin) * binScale);
+		b = b >= BVH_BIN_COUNT ? BVH_BIN_COUNT - 1 : b;
+		vec3 boxMin(bounds->centerX[id] - bounds->extentX[id], bounds->centerY[id] - bounds->extentY[id], bounds->centerZ[id] - bounds->extentZ[id]);
+		vec3 boxMax(bounds->centerX[id] + bounds->extentX[id], bounds->centerY[id] + bounds->extentY[id], bounds->centerZ[id] + bounds->extentZ[id]);
+		if (binCounts[b] == 0) {
+			binMin[b] = boxMin;
+			binMax[b] = boxMax;
+		} else
+			MergeBox(binMin[b], binMax[b], boxMin, boxMax);
+		binCounts[b]++;
+	}
+
+	// Sweep from the right to get the cost of every split plane
+	float rightArea[BVH_BIN_COUNT];
+	int rightCount[BVH_BIN_COUNT];
+	vec3 sumMin, sumMax;
+	int sumCount = 0;
+	for (int b = BVH_BIN_COUNT - 1; b > 0; b--) {
+		if (binCounts[b] > 0) {
+			if (sumCount == 0) { sumMin = binMin[b]; sumMax = binMax[b]; }
+			else MergeBox(sumMin, sumMax, binMin[b], binMax[b]);
+			sumCount += binCounts[b];
+		}
+		rightCount[b] = sumCount;
+		rightArea[b] = sumCount > 0 ? SurfaceArea(sumMin, sumMax) : 0.0;
+	}
+
+	int bestSplit = -1;
+	float bestCost = 0.0;
+	sumCount = 0;
+	for (int b = 0; b < BVH_BIN_COUNT - 1; b++) {
+		if (binCounts[b] > 0) {
+			if (sumCount == 0) { sumMin = binMin[b]; sumMax = binMax[b]; }
+			else MergeBox(sumMin, sumMax, binMin[b], binMax[b]);
+			sumCount += binCounts[b];
+		}
+		if (sumCount == 0 || rightCount[b + 1] == 0) continue;
+		float cost = SurfaceArea(sumMin, sumMax) * sumCount + rightArea[b + 1] * rightCount[b + 1];
+		if (bestSplit < 0 || cost < bestCost) {
+			bestSplit = b;
+			bestCost = cost;
+		}
+	}
+
+	int mid = first;
+	if (bestSplit >= 0) {
+		int last = first + count - 1;
+		while (mid <= last) {
+			int b = (int)((centers[indices[mid] * 3 + axis] - axisMin) * binScale);
+			b = b >= BVH_BIN_COUNT ? BVH_BIN_COUNT - 1 : b;
+			if (b <= bestSplit) mid++;
+			else {
+				int tmp = indices[mid]; indices[mid] = indices[last]; indices[last] = tmp;
+				last--;
+			}
+		}
+	}
+	if (mid == first || mid == first + count) mid = first + count / 2;
+
+	int left = nodeCount;
+	nodeCount += 2;
+	node->left = left;
+	buildNode(left, first, mid - first, bounds, centers, depth + 1);
+	buildNode(left + 1, mid, first + count - mid, bounds, centers, depth + 1);
+}
+
+void BVH::updateNodeBounding(BvhNode* node) {
+	if (node->left < 0) {
+		const BoundsArray* b = sortedBounds;
+		int i = node->first;
+		node->minVertex = vec3(b->centerX[i] - b->extentX[i], b->centerY[i] - b->extentY[i], b->centerZ[i] - b->extentZ[i]);
+		node->maxVertex = vec3(b->centerX[i] + b->extentX[i], b->centerY[i] + b->extentY[i], b->centerZ[i] + b->extentZ[i]);
+		for (i = node->first + 1; i < node->first + node->count; i++) {
+			MergeBox(node->minVertex, node->maxVertex, 
+				vec3(b->centerX[i] - b->extentX[i], b->centerY[i] - b->extentY[i], b->centerZ[i] - b->extentZ[i]),
+				vec3(b->centerX[i] + b->extentX[i], b->centerY[i] + b->extentY[i], b->centerZ[i] + b->extentZ[i]));
+		}
+	} else {
+		BvhNode* left = nodes + node->left;
+		BvhNode* right = left + 1;
+		node->minVertex = left->minVertex;
+		node->maxVertex = left->maxVertex;
+		MergeBox(node->minVertex, node->maxVertex, right->minVertex, right->maxVertex);
+	}
+}
+
+// Boxes moved but the tree stays, children are always stored after their parent
+void BVH::refit(const BoundsArray* bounds) {
+	if (bounds->count != boxCount) {
+		build(bounds);
+		return;
+	}
+	BoundsArray* sb = sortedBounds;
+	for (int i = 0; i < boxCount; i++) {
+		int id = indices[i];
+		sb->centerX[i] = bounds->centerX[id]; sb->centerY[i] = bounds->centerY[id]; sb->centerZ[i] = bounds->centerZ[id];
+		sb->extentX[i] = bounds->extentX[id]; sb->extentY[i] = bounds->extentY[id]; sb->extentZ[i] = bounds->extentZ[id];
+	}
+	if (boxCount <= 0) return;
+	for (int n = nodeCount - 1; n >= 0; n--)
+		updateNodeBounding(nodes + n);
+}
+
+void BVH::collect(const BvhNode* node, uint bit, BvhCull* result) const {
+	uint* masks = result->masks;
+	for (int i = node->first; i < node->first + node->count; i++) {
+		int id = indices[i];
+		if (!masks[id]) result->visibleList[result->visibleCount++] = id;
+		masks[id] |= bit;
+	}
+}
+
+void BVH::collectAll(uint bit, BvhCull* result) const {
+	if (boxCount > 0) collect(nodes, bit, result);
+}
+
+// Mark boxes known to be visible, such as a cached culling result
+void BVH::collectList(const int* list, int count, uint bit, BvhCull* result) const {
+	uint* masks = result->masks;
+	for (int i = 0; i < count; i++) {
+		int id = list[i];
+		if (!masks[id]) result->visibleList[result->visibleCount++] = id;
+		masks[id] |= bit;
+	}
+}
+
+// Test nodes against frustum planes, planes a node is fully inside are not tested for its subtree,
+//   result must be reserved for getBoxCount() boxes
+void BVH::cull(const Frustum* frustum, uint bit, BvhCull* result) const {
+	if (boxCount <= 0) return;
+	const int allPlanes = (1 << 6) - 1;
+	int nodeStack[BVH_MAX_DEPTH * 2];
+	int planeStack[BVH_MAX_DEPTH * 2];
+	int top = 0;
+	nodeStack[top] = 0; planeStack[top] = allPlanes; top++;
+
+	while (top > 0) {
+		top--;
+		const BvhNode* node = nodes + nodeStack[top];
+		int planeMask = planeStack[top];
+
+		vec3 center = (node->minVertex + node->maxVertex) * 0.5;
+		vec3 half = (node->maxVertex - node->minVertex) * 0.5;
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; p++) {
+			if (!(planeMask & (1 << p))) continue;
+			const vec3& n = frustum->normals[p];
+			float dist = n.DotProduct(center) + frustum->ds[p];
+			float radius = fabsf(n.x) * half.x + fabsf(n.y) * half.y + fabsf(n.z) * half.z;
+			if (dist + radius < 0) outside = true;
+			else if (dist - radius >= 0) planeMask &= ~(1 << p);
+		}
+		if (outside) continue;
+
+		if (planeMask == 0) 
+			collect(node, bit, result);
+		else if (node->left < 0) {
+			uint* leafMasks = result->leafMasks;
+			uint* masks = result->masks;
+			for (int i = node->first; i < node->first + node->count; i++) leafMasks[i] = 0;
+			CullBoxes(frustum, sortedBounds, node->first, node->first + node->count, bit, leafMasks);
+			for (int i = node->first; i < node->first + node->count; i++) {
+				if (!leafMasks[i]) continue;
+				int id = indices[i];
+				if (!masks[id]) result->visibleList[result->visibleCount++] = id;
+				masks[id] |= bit;
+			}
+		} else {
+			nodeStack[top] = node->left + 1; planeStack[top] = planeMask; top++;
+			nodeStack[top] = node->left; planeStack[top] = planeMask; top++;
+		}
+	}
+}
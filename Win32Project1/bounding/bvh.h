@@ -0,0 +1,55 @@
+#ifndef BVH_H_
+#define BVH_H_
+
+#include "boundsArray.h"
+
+#define BVH_LEAF_SIZE 8
+#define BVH_BIN_COUNT 12
+#define BVH_MAX_DEPTH 64
+
+struct BvhNode {
+	vec3 minVertex, maxVertex;
+	int first, count; // Boxes [first, first + count) in bvh order
+	int left; // Right child is left + 1, negative for leaf
+};
+
+// Culling result over one BVH, kept by whoever culls so that the tree
+//   is only read while culling and several culls may run on it at once
+struct BvhCull {
+	uint* masks; // Per box index, one bit per camera
+	int* visibleList; // Box indices with any bit set in masks
+	int visibleCount;
+	uint* leafMasks; // CullBoxes output, in bvh order
+	int capacity;
+
+	BvhCull();
+	~BvhCull();
+	void reserve(int boxCount);
+	void reset();
+};
+
+// Bounding volume hierarchy over a set of boxes, built with binned SAH
+class BVH {
+private:
+	BvhNode* nodes;
+	int nodeCount;
+	int* indices; // Bvh order to box index
+	BoundsArray* sortedBounds; // Boxes in bvh order
+	int boxCount;
+private:
+	void buildNode(int nodeIndex, int first, int count, const BoundsArray* bounds, float* centers, int depth);
+	void updateNodeBounding(BvhNode* node);
+	void collect(const BvhNode* node, uint bit, BvhCull* result) const;
+public:
+	BVH();
+	~BVH();
+	void build(const BoundsArray* bounds);
+	void refit(const BoundsArray* bounds);
+	void cull(const Frustum* frustum, uint bit, BvhCull* result) const;
+	void collectAll(uint bit, BvhCull* result) const;
+	void collectList(const int* list, int count, uint bit, BvhCull* result) const;
+	int getNodeCount() { return nodeCount; }
+	int getBoxCount() const { return boxCount; }
+};
+
+#endif
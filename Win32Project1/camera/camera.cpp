@@ -168,5 +168,10 @@ void Camera::copy(Camera* src) {
 	viewProjectMatrix = src->viewProjectMatrix;
 	invViewProjectMatrix = src->invViewProjectMatrix;
 	invProjMatrix = src->invProjMatrix;
+	invViewMatrix = src->invViewMatrix;
 	position = src->position;
+	lookDir = src->lookDir;
+	fovy = src->fovy, aspect = src->aspect;
+	zNear = src->zNear, zFar = src->zFar;
+	*frustum = *(src->frustum);
 }
@@ -10,12 +10,7 @@ Frustum::Frustum() {
 	ndcVertex[6]=vec4(-1.0f, 1.0f, -1.0f, 1.0f);
 	ndcVertex[7]=vec4(1.0f, 1.0f, -1.0f, 1.0f);
 
-	planeVertexIndex[0] = 0; planeVertexIndex[1] = 4; planeVertexIndex[2] = 6; planeVertexIndex[3] = 2;
-	planeVertexIndex[4] = 3; planeVertexIndex[5] = 7; planeVertexIndex[6] = 5; planeVertexIndex[7] = 6;
-	planeVertexIndex[8] = 1; planeVertexIndex[9] = 5; planeVertexIndex[10] = 4; planeVertexIndex[11] = 0;
-	planeVertexIndex[12] = 2; planeVertexIndex[13] = 6; planeVertexIndex[14] = 7; planeVertexIndex[15] = 3;
-	planeVertexIndex[16] = 0; planeVertexIndex[17] = 2; planeVertexIndex[18] = 3; planeVertexIndex[19] = 1;
-	planeVertexIndex[20] = 4; planeVertexIndex[21] = 5; planeVertexIndex[22] = 7; planeVertexIndex[23] = 6;
+	axisCount = 0;
 }
 
 Frustum::~Frustum() {}
@@ -48,46 +43,76 @@ void Frustum::update(const mat4& invViewProjectMatrix, const vec3& lookDir) {
 	ds[4] = -normals[4].DotProduct(worldVertex[0]);
 	ds[5] = -normals[5].DotProduct(worldVertex[4]);
 
-	for (int i = 0; i<4; i++) {
-		edgeDir[i] = worldVertex[i] - worldVertex[i + 4];
-		edgeLength[i] = edgeDir[i].GetLength();
-		edgeDir[i] /= edgeLength[i];
-	}
-
 	planes[0].update(normals[0], ds[0]);
 	planes[1].update(normals[1], ds[1]);
 	planes[2].update(normals[2], ds[2]);
 	planes[3].update(normals[3], ds[3]);
 	planes[4].update(normals[4], ds[4]);
 	planes[5].update(normals[5], ds[5]);
+
+	minVertex = worldVertex[0];
+	maxVertex = worldVertex[0];
+	for (int i = 1; i < 8; i++) {
+		minVertex.x = minVertex.x > worldVertex[i].x ? worldVertex[i].x : minVertex.x;
+		minVertex.y = minVertex.y > worldVertex[i].y ? worldVertex[i].y : minVertex.y;
+		minVertex.z = minVertex.z > worldVertex[i].z ? worldVertex[i].z : minVertex.z;
+		maxVertex.x = maxVertex.x < worldVertex[i].x ? worldVertex[i].x : maxVertex.x;
+		maxVertex.y = maxVertex.y < worldVertex[i].y ? worldVertex[i].y : maxVertex.y;
+		maxVertex.z = maxVertex.z < worldVertex[i].z ? worldVertex[i].z : maxVertex.z;
+	}
+
+	static const vec3 boxAxes[3] = { vec3(1, 0, 0), vec3(0, 1, 0), vec3(0, 0, 1) };
+	vec3 edges[6];
+	for (int i = 0; i < 4; i++)
+		edges[i] = worldVertex[i] - worldVertex[i + 4];
+	edges[4] = worldVertex[1] - worldVertex[0];
+	edges[5] = worldVertex[2] - worldVertex[0];
+
+	axisCount = 0;
+	for (int i = 0; i < 6; i++)
+		addAxis(normals[i]);
+	for (int i = 0; i < 6; i++) {
+		for (int j = 0; j < 3; j++)
+			addAxis(boxAxes[j].CrossProduct(edges[i]));
+	}
 }
 
-bool Frustum::intersectsWidthRay(const vec3& origin, const vec3& dir, float maxDistance) {
-	Line line(dir, origin);
-	static vec3 interPoint(0, 0, 0);
-	for (uint i = 0; i < 6; i++) {
-	//for (uint i = 0; i < 5; i++) {
-		bool isInter = CaculateIntersect(&line, &planes[i], maxDistance, interPoint);
-		if (!isInter) continue;
-		uint pi0 = planeVertexIndex[i * 4];
-		uint pi1 = planeVertexIndex[i * 4 + 1];
-		uint pi2 = planeVertexIndex[i * 4 + 2];
-		uint pi3 = planeVertexIndex[i * 4 + 3];
-		vec3 a = worldVertex[pi0];
-		vec3 b = worldVertex[pi1];
-		vec3 c = worldVertex[pi2];
-		vec3 d = worldVertex[pi3];
-		vec3 ia = a - interPoint;
-		vec3 ib = b - interPoint;
-		vec3 ic = c - interPoint;
-		vec3 id = d - interPoint;
-		vec3 aib = ia.CrossProduct(ib);
-		vec3 bic = ib.CrossProduct(ic);
-		vec3 cid = ic.CrossProduct(id);
-		vec3 dia = id.CrossProduct(ia);
-		if ((aib.DotProduct(bic) >= 0 && bic.DotProduct(cid) >= 0 && cid.DotProduct(dia) >= 0 && dia.DotProduct(aib) >= 0) ||
-			(aib.DotProduct(bic) <= 0 && bic.DotProduct(cid) <= 0 && cid.DotProduct(dia) <= 0 && dia.DotProduct(aib) <= 0))
-			return true;
+void Frustum::addAxis(const vec3& axis) {
+	float length = axis.GetLength();
+	if (length < 0.000001) return; // Parallel edges give no axis
+	vec3 dir = axis / length;
+	float minDis = dir.DotProduct(worldVertex[0]);
+	float maxDis = minDis;
+	for (int i = 1; i < 8; i++) {
+		float dis = dir.DotProduct(worldVertex[i]);
+		minDis = dis < minDis ? dis : minDis;
+		maxDis = dis > maxDis ? dis : maxDis;
 	}
-	return false;
-}
\ No newline at end of file
+	axes[axisCount] = dir;
+	axisMin[axisCount] = minDis;
+	axisMax[axisCount] = maxDis;
+	axisCount++;
+}
+
+// Copy of frustum with planes pushed out by margin, only planes & bounds are valid for culling
+void Frustum::expand(const Frustum* frustum, float margin) {
+	*this = *frustum;
+	for (int i = 0; i < 6; i++) {
+		ds[i] += margin;
+		planes[i].update(normals[i], ds[i]);
+	}
+	minVertex = minVertex - vec3(margin, margin, margin);
+	maxVertex = maxVertex + vec3(margin, margin, margin);
+	axisCount = 0;
+}
+
+// Both are convex so frustum is inside if all its corners are
+bool Frustum::contains(const Frustum* frustum) const {
+	for (int v = 0; v < 8; v++) {
+		for (int i = 0; i < 6; i++) {
+			if (normals[i].DotProduct(frustum->worldVertex[v]) + ds[i] < 0)
+				return false;
+		}
+	}
+	return true;
+}
@@ -17,15 +17,22 @@ public:
 	vec3 worldVertex[8];
 	vec3 normals[6];
 	Plane planes[6];
-	uint planeVertexIndex[24];
 	float ds[6];
-	vec3 edgeDir[4];
-	float edgeLength[4];
+	vec3 minVertex, maxVertex;
+
+	// Separating axes: plane normals & box axes cross frustum edges,
+	//   with the frustum projected onto each of them
+	vec3 axes[24];
+	float axisMin[24], axisMax[24];
+	int axisCount;
 
 	Frustum();
 	~Frustum();
 	void update(const mat4& invViewProjectMatrix, const vec3& lookDir);
-	bool intersectsWidthRay(const vec3& origin, const vec3& dir, float maxDistance);
+	void expand(const Frustum* frustum, float margin);
+	bool contains(const Frustum* frustum) const;
+private:
+	void addAxis(const vec3& axis);
 };
 
 #endif /* FRUSTUM_H_ */
@@ -1,8 +1,15 @@
 #include "instance.h"
 #include "../constants/constants.h"
 #include "../material/materialManager.h"
+#include "../assets/assetManager.h"
 
-std::map<Mesh*, int> Instance::instanceTable;
+std::vector<int> Instance::instanceTable;
+
+void Instance::CountInstance(Mesh* mesh, int delta) {
+	uint id = AssetManager::assetManager->assignMeshId(mesh);
+	if (id >= instanceTable.size()) instanceTable.resize(id + 1, 0);
+	instanceTable[id] += delta;
+}
 
 Instance::Instance(InstanceData* data) {
 	create(data->insMesh);
@@ -17,6 +24,7 @@ Instance::Instance(Mesh* mesh) {
 
 void Instance::create(Mesh* mesh) {
 	insId = -1, insSingleId = -1, insBillId = -1;
+	groupId = 0;
 	instanceMesh = mesh;
 	vertexCount = 0;
 	indexCount = 0;
@@ -27,6 +35,7 @@ void Instance::create(Mesh* mesh) {
 	texidBuffer = NULL;
 	colorBuffer = NULL;
 	indexBuffer = NULL;
+	shortIndex = true;
 
 	maxInstanceCount = 0;
 	isBillboard = instanceMesh->isBillboard;
@@ -56,8 +65,9 @@ void Instance::initInstanceBuffers(Object* object,int vertices,int indices,int c
 	colorBuffer = (byte*)malloc(vertexCount * 3 * sizeof(byte));
 
 	indexCount=indices;
+	shortIndex = instanceMesh->fitsShortIndex();
 	if (indexCount > 0)
-		indexBuffer = (ushort*)malloc(indexCount*sizeof(ushort));
+		indexBuffer = malloc(indexCount * (shortIndex ? sizeof(ushort) : sizeof(uint)));
 
 	int mid = object->material;
 	if (isBillboard) mid = object->billboard->material;
@@ -100,7 +110,8 @@ void Instance::initInstanceBuffers(Object* object,int vertices,int indices,int c
 	if(instanceMesh->indices) {
 		for(int i=0;i<indexCount;i++) {
 			int index=instanceMesh->indices[i];
-			indexBuffer[i]=(ushort)index;
+			if (shortIndex) ((ushort*)indexBuffer)[i] = (ushort)index;
+			else ((uint*)indexBuffer)[i] = (uint)index;
 		}
 	}
 
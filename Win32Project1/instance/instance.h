@@ -12,9 +12,11 @@
 
 class Instance {
 public:
-	static std::map<Mesh*, int> instanceTable;
+	static std::vector<int> instanceTable; // Instance count indexed by mesh id
+	static void CountInstance(Mesh* mesh, int delta);
 public:
 	int insId, insSingleId, insBillId;
+	int groupId; // Index in its multi instance, high bits of instance buffer entries
 	Mesh* instanceMesh;
 	int vertexCount,indexCount;
 	float* vertexBuffer;
@@ -23,7 +25,8 @@ public:
 	float* texcoordBuffer;
 	float* texidBuffer;
 	unsigned char* colorBuffer;
-	unsigned short* indexBuffer;
+	void* indexBuffer; // ushort if shortIndex, else uint
+	bool shortIndex;
 
 	int maxInstanceCount;
 
@@ -0,0 +1,115 @@
+#include "instanceBuffer.h"
+#include <string.h>
+#include <stdlib.h>
+
+InstanceBuffer* InstanceBuffer::instanceBuffer = NULL;
+
+void InstanceBuffer::Init() {
+	if (!InstanceBuffer::instanceBuffer)
+		InstanceBuffer::instanceBuffer = new InstanceBuffer();
+}
+
+void InstanceBuffer::Release() {
+	if (InstanceBuffer::instanceBuffer)
+		delete InstanceBuffer::instanceBuffer;
+	InstanceBuffer::instanceBuffer = NULL;
+}
+
+InstanceBuffer::InstanceBuffer() {
+	for (uint i = 0; i < INSTANCE_MAX_BLOCKS; i++) {
+		blocks[i] = NULL;
+		dirty[i] = false;
+	}
+	blockCount = 0;
+	freeSlots.clear();
+	retiredSlots.clear();
+	slotCount = 0;
+	snapFrames = 0;
+	snapBlocks = 0;
+	buffer = NULL;
+	gpuBlocks = 0;
+}
+
+InstanceBuffer::~InstanceBuffer() {
+	for (uint i = 0; i < blockCount; i++)
+		free(blocks[i]);
+	freeSlots.clear();
+	retiredSlots.clear();
+	if (buffer) delete buffer;
+}
+
+// Slot of a zeroed record, -1 if all slots are taken
+int InstanceBuffer::add() {
+	std::lock_guard<std::mutex> lock(slotLock);
+	uint slot = 0;
+	if (freeSlots.size() > 0) {
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	} else {
+		if (slotCount >= INSTANCE_MAX_BLOCKS * INSTANCE_BLOCK_SIZE) return -1;
+		slot = slotCount++;
+		if (slot / INSTANCE_BLOCK_SIZE >= blockCount) {
+			blocks[blockCount] = (InstanceRecord*)malloc(INSTANCE_BLOCK_SIZE * sizeof(InstanceRecord));
+			memset(blocks[blockCount], 0, INSTANCE_BLOCK_SIZE * sizeof(InstanceRecord));
+			blockCount++;
+		}
+	}
+	memset(get(slot), 0, sizeof(InstanceRecord));
+	markDirty(slot);
+	return (int)slot;
+}
+
+// Slot is free again after INSTANCE_RETIRE_FRAMES snapshots
+void InstanceBuffer::remove(uint slot) {
+	std::lock_guard<std::mutex> lock(slotLock);
+	retiredSlots.push_back(RetiredSlot(slot, snapFrames));
+}
+
+// Call in prepare thread once per frame packet after records of the frame are written,
+//   all blocks are copied when new blocks came as upload recreates the buffer then
+void InstanceBuffer::snapshot(InstanceSnapshot* snap) {
+	uint count = blockCount;
+	if (count > snapBlocks) {
+		for (uint i = 0; i < count; i++)
+			dirty[i] = true;
+		snapBlocks = count;
+	}
+	snap->blocks.clear();
+	for (uint i = 0; i < count; i++) {
+		if (dirty[i].exchange(false)) 
+			snap->blocks.push_back(i);
+	}
+	snap->records.resize(snap->blocks.size() * INSTANCE_BLOCK_SIZE);
+	for (uint i = 0; i < snap->blocks.size(); i++)
+		memcpy(&snap->records[i * INSTANCE_BLOCK_SIZE], blocks[snap->blocks[i]], INSTANCE_BLOCK_SIZE * sizeof(InstanceRecord));
+	snap->blockCount = count;
+
+	std::lock_guard<std::mutex> lock(slotLock);
+	snapFrames++;
+	uint kept = 0;
+	for (uint i = 0; i < retiredSlots.size(); i++) {
+		if (snapFrames - retiredSlots[i].frame < INSTANCE_RETIRE_FRAMES) 
+			retiredSlots[kept++] = retiredSlots[i];
+		else 
+			freeSlots.push_back(retiredSlots[i].slot);
+	}
+	retiredSlots.resize(kept, RetiredSlot(0, 0));
+}
+
+// Call in render thread once per acquired frame packet, packets upload in prepare order
+void InstanceBuffer::upload(const InstanceSnapshot* snap) {
+	if (snap->blockCount == 0) return;
+	if (!buffer || snap->blockCount > gpuBlocks) {
+		if (!buffer) buffer = new RenderBuffer(1, false);
+		gpuBlocks = snap->blockCount;
+		buffer->setBufferData(GL_SHADER_STORAGE_BUFFER, 0, GL_UNSIGNED_INT, gpuBlocks * INSTANCE_BLOCK_SIZE, sizeof(InstanceRecord) / sizeof(uint), GL_DYNAMIC_DRAW, NULL);
+	}
+	for (uint i = 0; i < snap->blocks.size(); i++) {
+		uint block = snap->blocks[i];
+		buffer->updateBufferData(0, block * INSTANCE_BLOCK_SIZE, INSTANCE_BLOCK_SIZE, (void*)&snap->records[i * INSTANCE_BLOCK_SIZE]);
+	}
+}
+
+void InstanceBuffer::use(int base) {
+	if (buffer) buffer->setShaderBase(0, base);
+}
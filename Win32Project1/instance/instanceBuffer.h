@@ -0,0 +1,66 @@
+#ifndef INSTANCE_BUFFER_H_
+#define INSTANCE_BUFFER_H_
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include "../render/renderBuffer.h"
+#include "../render/framePipeline.h"
+#include "instanceRecord.h"
+
+#define INSTANCE_BLOCK_SIZE 1024
+// Index entries pass record slot in low bits and instance group in high bits
+#define INSTANCE_SLOT_BITS 20
+#define INSTANCE_SLOT_MASK ((1 << INSTANCE_SLOT_BITS) - 1)
+#define INSTANCE_MAX_BLOCKS ((1 << INSTANCE_SLOT_BITS) / INSTANCE_BLOCK_SIZE)
+// Snapshots a removed slot waits before reuse, packets in flight may still list it
+#define INSTANCE_RETIRE_FRAMES MAX_FRAME_DEPTH
+
+// Blocks changed since previous snapshot, copied by prepare into its frame packet
+struct InstanceSnapshot {
+	std::vector<uint> blocks; // Ids of copied blocks
+	std::vector<InstanceRecord> records; // INSTANCE_BLOCK_SIZE records per copied block
+	uint blockCount; // Blocks gpu buffer holds once uploaded
+	InstanceSnapshot() :blockCount(0) {}
+};
+
+struct RetiredSlot {
+	uint slot;
+	uint frame; // Snapshot count it was removed at
+	RetiredSlot(uint s, uint f) :slot(s), frame(f) {}
+};
+
+// Transform records of all objects kept once for every queue, queues only list slots of visible ones,
+//   blocks never move so an object keeps pointing to its record. Changed blocks are snapshotted 
+//   by prepare with its frame, draw uploads them from the packet and never reads live records
+class InstanceBuffer {
+public:
+	static InstanceBuffer* instanceBuffer;
+	static void Init();
+	static void Release();
+private:
+	InstanceRecord* blocks[INSTANCE_MAX_BLOCKS];
+	std::atomic<bool> dirty[INSTANCE_MAX_BLOCKS];
+	std::atomic<uint> blockCount;
+	std::vector<uint> freeSlots;
+	std::vector<RetiredSlot> retiredSlots;
+	uint slotCount;
+	uint snapFrames; // Snapshots taken
+	uint snapBlocks; // Blocks every snapshot since growth covers
+	std::mutex slotLock;
+	RenderBuffer* buffer;
+	uint gpuBlocks;
+private:
+	InstanceBuffer();
+	~InstanceBuffer();
+public:
+	int add();
+	void remove(uint slot);
+	InstanceRecord* get(uint slot) { return blocks[slot / INSTANCE_BLOCK_SIZE] + (slot % INSTANCE_BLOCK_SIZE); }
+	void markDirty(uint slot) { dirty[slot / INSTANCE_BLOCK_SIZE] = true; }
+	void snapshot(InstanceSnapshot* snap);
+	void upload(const InstanceSnapshot* snap);
+	void use(int base);
+};
+
+#endif
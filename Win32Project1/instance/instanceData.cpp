@@ -1,43 +1,46 @@
 #include "instance.h"
+#include "instanceBuffer.h"
 
-InstanceData::InstanceData(Mesh* mesh, Object* obj, int maxCount) {
+InstanceData::InstanceData(Mesh* mesh, uint obj, int maxCount, FrameArena* frameArena) {
 	insMesh = mesh;
 	count = 0, maxInsCount = maxCount;
-	transformsFull = NULL;
+	indices = NULL;
 	object = obj;
 	instance = NULL;
+	arena = frameArena;
 
-	transformsFull = (buff*)malloc(maxCount * 16 * sizeof(buff));
-	memset(transformsFull, 0, maxCount * 16 * sizeof(buff));
+	if (!arena) {
+		indices = (uint*)malloc(maxCount * sizeof(uint));
+		memset(indices, 0, maxCount * sizeof(uint));
+	}
 }
 
 InstanceData::~InstanceData() {
-	if (transformsFull) free(transformsFull);
+	if (indices && !arena) free(indices);
 	if (instance) delete instance;
 }
 
+// Call before arena reset
 void InstanceData::resetInstance() {
 	count = 0;
+	if (arena) indices = NULL;
 }
 
 void InstanceData::addInstance(Object* object) {
-	if (transformsFull) {
-		memcpy(transformsFull + (count * 16), object->transformsFull, 12 * sizeof(buff));
+	if (count >= maxInsCount || object->instanceSlot < 0) return;
+	if (!indices && arena)
+		indices = arena->allocArray<uint>(maxInsCount);
+	if (indices) {
 		if (instance) {
-			transformsFull[count * 16 + 12] = instance->insId + 0.1;
-			transformsFull[count * 16 + 13] = instance->insSingleId + 0.1;
-			transformsFull[count * 16 + 14] = instance->insBillId + 0.1;
-			transformsFull[count * 16 + 15] = -1;
-			if (instance->isBillboard) {
-				if (object->billboard->data[2] < 0) {
-					Material* mat = NULL;
-					if (MaterialManager::materials)
-						mat = MaterialManager::materials->find(object->billboard->material);
-					object->billboard->data[2] = mat ? mat->texids.x : 0.0;
-				}
-				memcpy(transformsFull + (count * 16) + 4, object->billboard->data, 3 * sizeof(buff));
+			if (instance->isBillboard && object->billboard->data[2] < 0) {
+				Material* mat = NULL;
+				if (MaterialManager::materials)
+					mat = MaterialManager::materials->find(object->billboard->material);
+				object->billboard->data[2] = mat ? mat->texids.x : 0.0;
+				object->updateRecord();
 			}
+			indices[count] = (instance->groupId << INSTANCE_SLOT_BITS) | object->instanceSlot;
 			count++;
 		}
 	} 
-}
\ No newline at end of file
+}
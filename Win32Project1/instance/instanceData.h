@@ -3,18 +3,20 @@
 
 #include "../mesh/mesh.h"
 #include "../object/object.h"
+#include "../util/arena.h"
 
 class Instance;
 
 class InstanceData {
 public:
 	Mesh* insMesh;
-	buff* transformsFull;
+	uint* indices; // Instance buffer entries of visible objects, slot & group of instance
 	int count, maxInsCount;
-	Object* object;
+	uint object; // Handle of an object using insMesh
 	Instance* instance;
+	FrameArena* arena; // If set indices are taken from it each frame
 public:
-	InstanceData(Mesh* mesh, Object* obj, int maxCount);
+	InstanceData(Mesh* mesh, uint obj, int maxCount, FrameArena* frameArena = NULL);
 	~InstanceData();
 	void resetInstance();
 	void addInstance(Object* object);
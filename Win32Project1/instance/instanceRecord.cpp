@@ -0,0 +1,55 @@
+#include "instanceRecord.h"
+#include <math.h>
+
+inline uint PackHalf2(float low, float high) {
+	return (uint)Float2Half(low) | ((uint)Float2Half(high) << 16);
+}
+
+inline uint PackSnorm10(float v) {
+	v = v < -1.0 ? -1.0 : (v > 1.0 ? 1.0 : v);
+	int i = (int)floorf(v * 511.0 + 0.5);
+	return (uint)i & 0x3ff;
+}
+
+// Largest component is dropped and rebuilt from the other three, which lie in +-1/sqrt(2)
+uint PackRotation(const vec4& quat) {
+	float q[4] = { quat.x, quat.y, quat.z, quat.w };
+	uint largest = 0;
+	for (uint i = 1; i < 4; i++) {
+		if (fabsf(q[i]) > fabsf(q[largest])) largest = i;
+	}
+	float sign = q[largest] < 0.0 ? -1.0 : 1.0;
+	uint packed = largest << 30, shift = 0;
+	for (uint i = 0; i < 4; i++) {
+		if (i == largest) continue;
+		packed |= PackSnorm10(q[i] * sign * 1.41421356) << shift;
+		shift += 10;
+	}
+	return packed;
+}
+
+// transforms: position & uniform scale, boundInfo: bound size & bound center y
+void PackInstance(InstanceRecord* record, const float* transforms, const vec4& quat, const vec4& boundInfo) {
+	record->position[0] = transforms[0];
+	record->position[1] = transforms[1];
+	record->position[2] = transforms[2];
+	record->scaleBound = PackHalf2(transforms[3], boundInfo.w - transforms[1]);
+	record->rotation = PackRotation(quat);
+	record->boundXY = PackHalf2(boundInfo.x, boundInfo.y);
+	record->boundZ = (record->boundZ & 0xffff0000) | Float2Half(boundInfo.z);
+}
+
+// data: size x, size y & texture id
+void PackBillboard(InstanceRecord* record, const float* data) {
+	record->extra = PackHalf2(data[0], data[1]);
+	uint texid = data[2] < 0.0 ? 0 : (uint)data[2];
+	record->boundZ = (record->boundZ & 0xffff) | (texid << 16);
+}
+
+// frame: bone texture row, kept whole as bone.vert floors it and half loses rows past 2048
+void PackAnimFrame(InstanceRecord* record, int clip, float frame, int animId) {
+	uint row = frame <= 0.0 ? 0 : (uint)floorf(frame);
+	if (row > 0xffff) row = 0xffff;
+	record->extra = row | ((uint)clip << 16);
+	record->boundZ = (record->boundZ & 0xffff) | ((uint)animId << 16);
+}
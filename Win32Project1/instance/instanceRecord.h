@@ -0,0 +1,21 @@
+#ifndef INSTANCE_RECORD_H_
+#define INSTANCE_RECORD_H_
+
+#include "../util/util.h"
+
+// Packed transform of one instance, 32 bytes, decoded in multiCull.comp
+struct InstanceRecord {
+	float position[3];
+	uint scaleBound; // Half scale | half bound center y offset from position
+	uint rotation; // Quaternion smallest three 10:10:10 | index of largest 2
+	uint extra; // Billboard: half size x | half size y, animation: frame row 16 | clip id
+	uint boundXY; // Half bound size x | half bound size y
+	uint boundZ; // Half bound size z | billboard texture id or animation id
+};
+
+uint PackRotation(const vec4& quat);
+void PackInstance(InstanceRecord* record, const float* transforms, const vec4& quat, const vec4& boundInfo);
+void PackBillboard(InstanceRecord* record, const float* data);
+void PackAnimFrame(InstanceRecord* record, int clip, float frame, int animId);
+
+#endif
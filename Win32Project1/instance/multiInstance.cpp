@@ -12,7 +12,10 @@ MultiInstance::MultiInstance() {
 	boneidBuffer = NULL;
 	weightBuffer = NULL;
 	indexBuffer = NULL;
-	transforms = NULL;
+	indexType = GL_UNSIGNED_SHORT;
+	records = NULL;
+	indices = NULL;
+	groups = NULL;
 
 	insDatas.clear();
 	animDatas.clear();
@@ -44,6 +47,7 @@ void MultiInstance::releaseInstanceData() {
 	if (boneidBuffer) free(boneidBuffer); boneidBuffer = NULL;
 	if (weightBuffer) free(weightBuffer); weightBuffer = NULL;
 	if (indexBuffer) free(indexBuffer); indexBuffer = NULL;
+	if (groups) free(groups); groups = NULL;
 
 	for (uint i = 0; i < normals.size(); i++)
 		free(normals[i]);
@@ -67,7 +71,8 @@ void MultiInstance::releaseInstanceData() {
 
 MultiInstance::~MultiInstance() {
 	releaseInstanceData();
-	if (transforms) free(transforms);
+	if (records) free(records);
+	if (indices) free(indices);
 
 	insDatas.clear();
 	animDatas.clear();
@@ -129,6 +134,7 @@ void MultiInstance::initBuffers() {
 				}
 			}
 
+			ins->groupId = i;
 			vertexCount += ins->vertexCount;
 			indexCount += ins->indexCount;
 			maxInstance += ins->maxInstanceCount > MaxInstance ? MaxInstance : ins->maxInstanceCount;
@@ -166,6 +172,14 @@ void MultiInstance::initBuffers() {
 			memcpy(indirectsSingle + i, singles[i], sizeof(Indirect));
 		for (uint i = 0; i < billCount; i++)
 			memcpy(indirectsBill + i, bills[i], sizeof(Indirect));
+
+		groups = (int*)malloc(indirectCount * 4 * sizeof(int));
+		for (uint i = 0; i < indirectCount; i++) {
+			groups[i * 4 + 0] = insDatas[i]->insId;
+			groups[i * 4 + 1] = insDatas[i]->insSingleId;
+			groups[i * 4 + 2] = insDatas[i]->insBillId;
+			groups[i * 4 + 3] = -1;
+		}
 	} else {
 		indirectsAnim = (Indirect*)malloc(animCount * sizeof(Indirect));
 		for (uint i = 0; i < animCount; i++)
@@ -184,8 +198,16 @@ void MultiInstance::initBuffers() {
 		boneidBuffer = (byte*)malloc(vertexCount * 4 * sizeof(byte));
 		weightBuffer = (half*)malloc(vertexCount * 4 * sizeof(half));
 	}
-	indexBuffer = (ushort*)malloc(indexCount * sizeof(ushort));
-	transforms = (buff*)malloc(maxInstance * 16 * sizeof(buff));
+	indexType = GL_UNSIGNED_SHORT;
+	for (uint i = 0; !hasAnim && i < indirectCount; ++i) {
+		if (!insDatas[i]->shortIndex) indexType = GL_UNSIGNED_INT;
+	}
+	uint indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(ushort) : sizeof(uint);
+	indexBuffer = malloc(indexCount * indexSize);
+	if (hasAnim)
+		records = (InstanceRecord*)malloc(maxInstance * sizeof(InstanceRecord));
+	else
+		indices = (uint*)malloc(maxInstance * sizeof(uint));
 
 	uint curVertex = 0, curIndex = 0;
 	for (uint i = 0; i < indirectCount; ++i) {
@@ -197,7 +219,14 @@ void MultiInstance::initBuffers() {
 			memcpy(texcoordBuffer + curVertex * 4, ins->texcoordBuffer, ins->vertexCount * 4 * sizeof(float));
 			memcpy(texidBuffer + curVertex * 2, ins->texidBuffer, ins->vertexCount * 2 * sizeof(float));
 			memcpy(colorBuffer + curVertex * 3, ins->colorBuffer, ins->vertexCount * 3 * sizeof(byte));
-			memcpy(indexBuffer + curIndex, ins->indexBuffer, ins->indexCount * sizeof(ushort));
+			if (indexType == GL_UNSIGNED_SHORT)
+				memcpy((ushort*)indexBuffer + curIndex, ins->indexBuffer, ins->indexCount * sizeof(ushort));
+			else if (!ins->shortIndex)
+				memcpy((uint*)indexBuffer + curIndex, ins->indexBuffer, ins->indexCount * sizeof(uint));
+			else {
+				for (int j = 0; j < ins->indexCount; j++)
+					((uint*)indexBuffer)[curIndex + j] = ((ushort*)ins->indexBuffer)[j];
+			}
 			curVertex += ins->vertexCount;
 			curIndex += ins->indexCount;
 		} else {
@@ -210,7 +239,7 @@ void MultiInstance::initBuffers() {
 			memcpy(colorBuffer + curVertex * 3, anim->colors, anim->vertexCount * 3 * sizeof(byte));
 			memcpy(boneidBuffer + curVertex * 4, anim->boneids, anim->vertexCount * 4 * sizeof(byte));
 			memcpy(weightBuffer + curVertex * 4, anim->weights, anim->vertexCount * 4 * sizeof(half));
-			memcpy(indexBuffer + curIndex, anim->indices, anim->indexCount * sizeof(ushort));
+			memcpy((ushort*)indexBuffer + curIndex, anim->indices, anim->indexCount * sizeof(ushort));
 			curVertex += anim->vertexCount;
 			curIndex += anim->indexCount;
 		}
@@ -218,10 +247,11 @@ void MultiInstance::initBuffers() {
 	bufferInited = true;
 }
 
-int MultiInstance::updateTransform(buff* targetBuffer) {
+// Instances gather their entries into indices, animations their records
+int MultiInstance::updateTransform(InstanceRecord* targetBuffer) {
 	instanceCount = 0;
 	int curNorm = 0, curSing = 0, curBill = 0, curAnim = 0;
-	buff* target = targetBuffer ? targetBuffer : transforms;
+	InstanceRecord* target = targetBuffer ? targetBuffer : records;
 	for (uint i = 0; i < indirectCount; i++) {
 		if (!hasAnim) {
 			Instance* ins = insDatas[i];
@@ -235,14 +265,14 @@ int MultiInstance::updateTransform(buff* targetBuffer) {
 			}
 
 			if (ins->insData->count > 0) {
-				memcpy(target + instanceCount * 16, ins->insData->transformsFull, ins->insData->count * 16 * sizeof(buff));
+				memcpy(indices + instanceCount, ins->insData->indices, ins->insData->count * sizeof(uint));
 				instanceCount += ins->insData->count;
 			}
 		} else {
 			AnimationData* anim = animDatas[i];
 			bases[(curAnim++) * 4 + 3] = instanceCount;
 			if (anim->animCount > 0) {
-				memcpy(target + instanceCount * 16, anim->transformsFull, anim->animCount * 16 * sizeof(buff));
+				memcpy(target + instanceCount, anim->records, anim->animCount * sizeof(InstanceRecord));
 				instanceCount += anim->animCount;
 			}
 		}
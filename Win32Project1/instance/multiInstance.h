@@ -18,8 +18,11 @@ public:
 	byte* colorBuffer;
 	byte* boneidBuffer;
 	half* weightBuffer;
-	ushort* indexBuffer;
-	buff* transforms;
+	void* indexBuffer; // Of indexType, uint only if a mesh needs it
+	GLenum indexType;
+	InstanceRecord* records; // Animation records
+	uint* indices; // Instance buffer entries of all instances
+	int* groups; // Indirect ids of each instance group: normal, single, billboard & unused
 	int vertexCount, indexCount, instanceCount, maxInstance;
 	bool hasAnim;
 private:
@@ -48,7 +51,7 @@ public:
 	void add(Instance* instance);
 	void add(AnimationData* animData);
 	void initBuffers();
-	int updateTransform(buff* targetBuffer = NULL);
+	int updateTransform(InstanceRecord* targetBuffer = NULL);
 	void createDrawcall() { drawcall = new MultiDrawcall(this); }
 	bool inited() { return bufferInited; }
 };
@@ -9,15 +9,9 @@ HGLRC hrc;
 HINSTANCE hInstance;
 const TCHAR szName[]=TEXT("win");
 
-HANDLE frameThread = NULL;
-bool threadEnd;
-DWORD WINAPI FrameThreadRun(LPVOID param);
-void CreateThreads();
-void ReleaseThreads();
-bool dataPrepared = false;
-HANDLE mutex = NULL;
-void InitMutex();
-void DeleteMutex();
+Job* frameJob = NULL; // Preparing data of following frames while dualthread
+void PrepareFrame();
+void WaitFrame();
 DWORD currentTime = 0, lastTime = 0, startTime = 0;
 CirQueue<float>* dTimes = NULL;
 float velocity = 0.0;
@@ -34,6 +28,7 @@ void ReleaseApplication();
 
 bool fullscreen = false;
 bool inited = false;
+DWORD lastStatsTime = 0;
 
 void SwitchMouse() {
 	if (app->isMouseShow() && !mouseShow) {
@@ -45,10 +40,20 @@ void SwitchMouse() {
 	}
 }
 
+// Frame rate & sorted state changes of the frame just drawn in title, once a second
+void ShowDrawStats() {
+	if (currentTime - lastStatsTime < 1000) return;
+	lastStatsTime = currentTime;
+	Renderable* drawn = app->renderMgr->currentQueue;
+	char title[128];
+	sprintf_s(title, "Tiny fps: %.0f state changes: %u avoided by sorting: %u", 
+		app->getFps(), drawn->getStateChanges(), drawn->getStateChangesAvoided());
+	SetWindowTextA(hWnd, title);
+}
+
 void KillWindow() {
 	if (dTimes) delete dTimes;
-	DeleteMutex();
-	ReleaseThreads();
+	WaitFrame();
 	ReleaseApplication();
 	ShowCursor(true);
 	if (fullscreen)
@@ -61,17 +66,23 @@ void KillWindow() {
 }
 
 void ResizeWindow(int width,int height) {
+	WaitFrame();
 	app->resize(width, height);
 }
 
 void DrawWindow() {
 	if (!app->cfgs->dualthread) {
 		app->act(startTime, timeGetTime(), velocity);
-		app->prepare(false);
+		app->snapshotFrame();
+		app->prepare();
+		app->acquireFrame();
 	} else {
-		WaitForSingleObject(mutex, INFINITE);
-		dataPrepared = true;
-		ReleaseMutex(mutex);
+		// Take next prepared frame, only wait when none is ready yet
+		if (!app->acquireFrame() && frameJob) {
+			WaitFrame();
+			app->acquireFrame();
+		}
+		PrepareFrame();
 	}
 
 	currentTime = timeGetTime();
@@ -99,29 +110,33 @@ void DrawWindow() {
 		app->animate(velocity);
 
 	app->draw();
-
-	if (app->cfgs->dualthread) {
-		WaitForSingleObject(mutex, INFINITE);
-		dataPrepared = false;
-		ReleaseMutex(mutex);
-	}
+	ShowDrawStats();
 
 	SwitchMouse();
 }
 
-DWORD WINAPI FrameThreadRun(LPVOID param) {
-	while (!app->willExit && app->cfgs->dualthread) {
-		if(!dataPrepared && inited) {
+// Following frames are acted and culled by jobs while this one is drawn,
+//   until every frame of the pipeline is ready or in use
+void PrepareFrame() {
+	JobSystem* jobs = JobSystem::jobSystem;
+	if (frameJob && !jobs->isFinished(frameJob)) return;
+	frameJob = NULL;
+	if (!app->canPrepare()) return;
+
+	app->snapshotFrame();
+	frameJob = jobs->create([]() {
+		while (app->canPrepare()) {
 			app->act(startTime, timeGetTime(), velocity);
-			app->prepare(true);
-
-			WaitForSingleObject(mutex, INFINITE);
-			dataPrepared = true;
-			ReleaseMutex(mutex);
+			app->prepare();
 		}
-	}
-	threadEnd = true;
-	return 1;
+	});
+	jobs->submitLong(frameJob);
+}
+
+void WaitFrame() {
+	if (!frameJob) return;
+	JobSystem::jobSystem->wait(frameJob);
+	frameJob = NULL;
 }
 
 void InitGLWin() {
@@ -148,29 +163,9 @@ void InitGL() {
 	printf("Init GL\n");
 	app->init();
 	dTimes = new CirQueue<float>(app->cfgs->smoothframe);
-	InitMutex();
-	CreateThreads();
 	inited = true;
 }
 
-void CreateThreads() {
-	frameThread = CreateThread(NULL, 0, FrameThreadRun, NULL, 0, NULL);
-	threadEnd = false;
-}
-
-void ReleaseThreads() {
-	CloseHandle(frameThread);
-}
-
-void InitMutex() {
-	mutex = CreateMutex(NULL, FALSE, NULL);
-}
-
-void DeleteMutex() {
-	ReleaseMutex(mutex);
-	CloseHandle(mutex);
-}
-
 void CreateApplication() {
 	app = new SimpleApplication();
 	fullscreen = app->cfgs->fullscreen;
@@ -263,7 +258,6 @@ int WINAPI WinMain(HINSTANCE hInst,HINSTANCE hPrevInstance,PSTR szCmdLine,int iC
 		} 
 	}
 
-	while (!threadEnd) Sleep(0);
 	KillWindow();
 	return msg.wParam;
 }
@@ -15,6 +15,7 @@ Box::Box():Mesh() {
 	materialids = NULL;
 	initFaces();
 	caculateExData();
+	optimize(false);
 }
 
 Box::Box(const Box& rhs) {
@@ -17,6 +17,7 @@ Mesh::Mesh() {
 	indices = NULL;
 	isBillboard = false;
 	drawShadow = true;
+	meshId = -1;
 	bounding = NULL;
 
 	singleFaces.clear();
@@ -24,7 +25,20 @@ Mesh::Mesh() {
 }
 
 Mesh::Mesh(const Mesh& rhs) {
+	vertexCount = 0;
+	indexCount = 0;
+	vertices = NULL;
+	vertices3 = NULL;
+	normals = NULL;
+	normals4 = NULL;
+	tangents = NULL;
+	texcoords = NULL;
+	materialids = NULL;
+	indices = NULL;
 	isBillboard = rhs.isBillboard;
+	drawShadow = rhs.drawShadow;
+	meshId = -1;
+	bounding = NULL;
 
 	for (uint i = 0; i < rhs.singleFaces.size(); i++)
 		singleFaces.push_back(rhs.singleFaces[i]->copy());
@@ -68,6 +82,44 @@ void Mesh::caculateExData() {
 	caculateBounding();
 }
 
+template <typename T>
+static void RemapArray(T* data, const std::vector<int>& remap) {
+	if (!data) return;
+	std::vector<T> old(data, data + remap.size());
+	for (uint i = 0; i < remap.size(); i++)
+		data[remap[i]] = old[i];
+}
+
+// Call after caculateExData, reorders triangles of each face range for vertex cache 
+//   and optionally overdraw, then vertices by first use for fetch
+void Mesh::optimize(bool overdraw) {
+	if (indexCount <= 0 || vertexCount <= 0) return;
+	cacheBefore = AnalyzeVertexCache(indices, indexCount, vertexCount, MESH_CACHE_SIZE);
+
+	std::vector<FaceBuf*> ranges(singleFaces.begin(), singleFaces.end());
+	ranges.insert(ranges.end(), normalFaces.begin(), normalFaces.end());
+	FaceBuf whole(0, indexCount);
+	if (ranges.size() == 0) ranges.push_back(&whole);
+	std::vector<int> clusters;
+	for (uint i = 0; i < ranges.size(); i++) {
+		int* rangeIndices = indices + ranges[i]->start;
+		OptimizeVertexCache(rangeIndices, ranges[i]->count, vertexCount, MESH_CACHE_SIZE, &clusters);
+		if (overdraw) OptimizeOverdraw(rangeIndices, ranges[i]->count, vertices3, clusters);
+	}
+
+	std::vector<int> remap;
+	OptimizeVertexFetch(indices, indexCount, vertexCount, remap);
+	RemapArray(vertices, remap);
+	RemapArray(vertices3, remap);
+	RemapArray(normals, remap);
+	RemapArray(normals4, remap);
+	RemapArray(tangents, remap);
+	RemapArray(texcoords, remap);
+	RemapArray(materialids, remap);
+
+	cacheAfter = AnalyzeVertexCache(indices, indexCount, vertexCount, MESH_CACHE_SIZE);
+}
+
 void Mesh::caculateBounding() {
 	if (vertexCount <= 0) return;
 	vec3 first3 = vertices3[0];
@@ -9,9 +9,13 @@
 #define MESH_H_
 
 #include "../maths/Maths.h"
+#include "meshOptimizer.h"
 #include <vector>
 #include <string>
 
+// Most vertices 16 bit indices can address
+#define SHORT_INDEX_VERTICES 65536
+
 struct FaceBuf {
 	int start, count;
 	FaceBuf(int s, int n) :start(s), count(n) {}
@@ -36,20 +40,24 @@ public:
 	int* materialids;
 	int* indices;
 	bool isBillboard, drawShadow;
+	int meshId; // Dense id given by AssetManager, -1 before
 	float* bounding;
 	std::vector<FaceBuf*> singleFaces;
 	std::vector<FaceBuf*> normalFaces;
+	CacheStats cacheBefore, cacheAfter; // Of index order before & after optimize, 0 if not optimized
 public:
 	Mesh();
 	Mesh(const Mesh& rhs);
 	virtual ~Mesh();
 	void caculateExData();
+	void optimize(bool overdraw);
 	void setIsBillboard(bool billboard);
 	void setAllSingle();
 	void setAllNormal();
 	std::string getName() { return name; }
 	void setName(std::string value) { name = value; }
 	void clearFaceBuf();
+	bool fitsShortIndex() { return vertexCount <= SHORT_INDEX_VERTICES; }
 private:
 	void caculateBounding();
 };
@@ -0,0 +1,157 @@
+#include "meshOptimizer.h"
+#include "../constants/constants.h"
+#include <algorithm>
+#include <string.h>
+using namespace std;
+
+CacheStats AnalyzeVertexCache(const int* indices, int indexCount, int vertexCount, int cacheSize) {
+	CacheStats stats;
+	if (indexCount <= 0) return stats;
+
+	// Time each vertex entered cache, entries older than cacheSize misses are evicted
+	vector<int> entered(vertexCount, -1);
+	vector<bool> used(vertexCount, false);
+	int misses = 0, usedCount = 0;
+	for (int i = 0; i < indexCount; i++) {
+		int v = indices[i];
+		if (entered[v] < 0 || misses - entered[v] >= cacheSize) {
+			entered[v] = misses;
+			misses++;
+		}
+		if (!used[v]) {
+			used[v] = true;
+			usedCount++;
+		}
+	}
+	stats.acmr = (float)misses / (indexCount / 3);
+	stats.atvr = (float)misses / usedCount;
+	return stats;
+}
+
+void OptimizeVertexCache(int* indices, int indexCount, int vertexCount, int cacheSize, vector<int>* clusters) {
+	int triCount = indexCount / 3;
+	if (clusters) clusters->clear();
+	if (triCount <= 0) return;
+
+	// Triangles around each vertex, and how many of them are not emitted yet
+	vector<int> starts(vertexCount + 1, 0), lives(vertexCount, 0);
+	for (int i = 0; i < indexCount; i++) lives[indices[i]]++;
+	for (int v = 0; v < vertexCount; v++) starts[v + 1] = starts[v] + lives[v];
+	vector<int> adjacency(indexCount), fills(starts.begin(), starts.end() - 1);
+	for (int i = 0; i < indexCount; i++) adjacency[fills[indices[i]]++] = i / 3;
+
+	vector<int> cacheTimes(vertexCount, 0), deadEnd, candidates, output;
+	vector<bool> emitted(triCount, false);
+	output.reserve(indexCount);
+	int time = cacheSize + 1, cursor = 0, emittedCount = 0;
+	int fan = indices[0];
+	bool missed = true;
+	while (fan >= 0) {
+		if (missed && clusters) clusters->push_back(emittedCount);
+		candidates.clear();
+		for (int i = starts[fan]; i < starts[fan + 1]; i++) {
+			int t = adjacency[i];
+			if (emitted[t]) continue;
+			emitted[t] = true;
+			emittedCount++;
+			for (int k = 0; k < 3; k++) {
+				int v = indices[t * 3 + k];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				lives[v]--;
+				if (time - cacheTimes[v] > cacheSize) cacheTimes[v] = time++;
+			}
+		}
+
+		// Next fan from a vertex still in cache with fewest triangles left,
+		//   else from recent dead ends, else the next vertex with triangles left
+		fan = -1;
+		int best = -1;
+		for (uint i = 0; i < candidates.size(); i++) {
+			int v = candidates[i];
+			if (lives[v] <= 0) continue;
+			int priority = 0;
+			if (time - cacheTimes[v] + 2 * lives[v] <= cacheSize) priority = time - cacheTimes[v];
+			if (priority > best) {
+				best = priority;
+				fan = v;
+			}
+		}
+		missed = fan < 0;
+		while (fan < 0 && deadEnd.size() > 0) {
+			int v = deadEnd.back();
+			deadEnd.pop_back();
+			if (lives[v] > 0) fan = v;
+		}
+		while (fan < 0 && cursor < vertexCount) {
+			if (lives[cursor] > 0) fan = cursor;
+			cursor++;
+		}
+	}
+	memcpy(indices, &output[0], indexCount * sizeof(int));
+}
+
+struct Cluster {
+	int start, count;
+	float sort;
+};
+
+void OptimizeOverdraw(int* indices, int indexCount, const vec3* positions, const vector<int>& clusters) {
+	int triCount = indexCount / 3;
+	if (clusters.size() <= 1) return;
+
+	// Area weighted centroid of mesh and of each cluster with its summed normal
+	vector<Cluster> sorted(clusters.size());
+	vector<vec3> centers(clusters.size()), normals(clusters.size());
+	vec3 meshCenter(0.0, 0.0, 0.0);
+	float meshArea = 0.0;
+	for (uint c = 0; c < clusters.size(); c++) {
+		int start = clusters[c];
+		int end = c + 1 < clusters.size() ? clusters[c + 1] : triCount;
+		vec3 center(0.0, 0.0, 0.0), normal(0.0, 0.0, 0.0);
+		float area = 0.0;
+		for (int t = start; t < end; t++) {
+			vec3 p0 = positions[indices[t * 3]], p1 = positions[indices[t * 3 + 1]], p2 = positions[indices[t * 3 + 2]];
+			vec3 n = (p1 - p0).CrossProduct(p2 - p0);
+			float a = n.GetLength();
+			center += (p0 + p1 + p2) * (a / 3.0);
+			normal += n;
+			area += a;
+		}
+		meshCenter += center;
+		meshArea += area;
+		centers[c] = area > 0.0 ? center / area : positions[indices[start * 3]];
+		normals[c] = normal;
+		sorted[c].start = start;
+		sorted[c].count = end - start;
+	}
+	if (meshArea > 0.0) meshCenter = meshCenter / meshArea;
+
+	for (uint c = 0; c < clusters.size(); c++) {
+		float length = normals[c].GetLength();
+		sorted[c].sort = length > 0.0 ? (centers[c] - meshCenter).DotProduct(normals[c]) / length : 0.0;
+	}
+	stable_sort(sorted.begin(), sorted.end(), [](const Cluster& l, const Cluster& r) {
+		return l.sort > r.sort;
+	});
+
+	vector<int> output;
+	output.reserve(indexCount);
+	for (uint c = 0; c < sorted.size(); c++)
+		output.insert(output.end(), indices + sorted[c].start * 3, indices + (sorted[c].start + sorted[c].count) * 3);
+	memcpy(indices, &output[0], indexCount * sizeof(int));
+}
+
+void OptimizeVertexFetch(int* indices, int indexCount, int vertexCount, vector<int>& remap) {
+	remap.assign(vertexCount, -1);
+	int next = 0;
+	for (int i = 0; i < indexCount; i++) {
+		int v = indices[i];
+		if (remap[v] < 0) remap[v] = next++;
+		indices[i] = remap[v];
+	}
+	for (int v = 0; v < vertexCount; v++) {
+		if (remap[v] < 0) remap[v] = next++;
+	}
+}
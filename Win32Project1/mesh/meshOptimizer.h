@@ -0,0 +1,29 @@
+#ifndef MESH_OPTIMIZER_H_
+#define MESH_OPTIMIZER_H_
+
+#include "../maths/Maths.h"
+#include <vector>
+
+// Post transform cache entries simulated and optimized for
+#define MESH_CACHE_SIZE 16
+
+// Cache misses per triangle & per referenced vertex of a FIFO cache
+struct CacheStats {
+	float acmr, atvr;
+	CacheStats() :acmr(0.0), atvr(0.0) {}
+};
+
+CacheStats AnalyzeVertexCache(const int* indices, int indexCount, int vertexCount, int cacheSize);
+
+// Tipsify (Sander et al. 2007), reorders triangles by fanning around cached vertices,
+//   clusters gets the first triangle of each run started off a cache miss
+void OptimizeVertexCache(int* indices, int indexCount, int vertexCount, int cacheSize, std::vector<int>* clusters);
+
+// Clusters facing out of the mesh first so they occlude inner ones
+void OptimizeOverdraw(int* indices, int indexCount, const vec3* positions, const std::vector<int>& clusters);
+
+// Renumbers vertices by first use, remap gets new index of each old vertex,
+//   unused vertices go to the end
+void OptimizeVertexFetch(int* indices, int indexCount, int vertexCount, std::vector<int>& remap);
+
+#endif
@@ -2,8 +2,28 @@
 #include "../constants/constants.h"
 #include "../material/materialManager.h"
 #include "../util/util.h"
+#include "simplifier.h"
 #include <stdlib.h>
 #include <string.h>
+#include <unordered_map>
+
+// Exact attributes of a face corner, compared bitwise
+struct WeldKey {
+	float position[3], texcoord[2], normal[3];
+	int material;
+	bool operator==(const WeldKey& rhs) const { return memcmp(this, &rhs, sizeof(WeldKey)) == 0; }
+};
+
+// FNV-1a over the key's words
+struct WeldHash {
+	size_t operator()(const WeldKey& key) const {
+		const uint* words = (const uint*)&key;
+		size_t hash = 2166136261u;
+		for (uint i = 0; i < sizeof(WeldKey) / sizeof(uint); i++)
+			hash = (hash ^ words[i]) * 16777619u;
+		return hash;
+	}
+};
 
 Model::Model(const char* obj, const char* mtl, int vt) :Mesh() {
 	vertexCount = 0;
@@ -17,6 +37,7 @@ Model::Model(const char* obj, const char* mtl, int vt) :Mesh() {
 	mats.clear();
 	loadModel(obj, mtl, vt);
 	caculateExData();
+	optimize(true);
 }
 
 Model::Model(const Model& rhs) :Mesh(rhs) {
@@ -48,6 +69,43 @@ Model::Model(const Model& rhs) :Mesh(rhs) {
 	caculateExData();
 }
 
+// Simplified copy keeping about ratio of rhs's triangles
+Model::Model(const Model& rhs, float ratio) :Mesh(rhs) {
+	Simplifier simplifier(&rhs);
+	simplifier.simplify(ratio);
+
+	vertexCount = simplifier.vertices.size();
+	vertices = new vec4[vertexCount];
+	normals = new vec3[vertexCount];
+	tangents = new vec3[vertexCount];
+	texcoords = new vec2[vertexCount];
+	materialids = new int[vertexCount];
+	for (int i = 0; i < vertexCount; i++) {
+		int src = simplifier.vertices[i];
+		vertices[i] = rhs.vertices[src];
+		normals[i] = rhs.normals[src];
+		tangents[i] = rhs.tangents[src];
+		texcoords[i] = rhs.texcoords[src];
+		materialids[i] = rhs.materialids[src];
+	}
+
+	indexCount = simplifier.indices.size();
+	indices = (int*)malloc(indexCount * sizeof(int));
+	if (indexCount > 0) memcpy(indices, &simplifier.indices[0], indexCount * sizeof(int));
+
+	clearFaceBuf();
+	if (simplifier.singleCount > 0) 
+		singleFaces.push_back(new FaceBuf(0, simplifier.singleCount));
+	if (indexCount > simplifier.singleCount) 
+		normalFaces.push_back(new FaceBuf(simplifier.singleCount, indexCount - simplifier.singleCount));
+
+	for (uint i = 0; i < rhs.mats.size(); ++i)
+		mats.push_back(rhs.mats[i]);
+
+	caculateExData();
+	optimize(true);
+}
+
 Model::~Model() {
 	mats.clear();
 }
@@ -60,86 +118,76 @@ void Model::loadModel(const char* obj,const char* mtl,int vt) {
 }
 
 void Model::initFaces() {
-	vertexCount = loader->vCount;
-	indexCount = loader->faceCount * 3;
-	vertices = new vec4[indexCount];
-	for(int i=0;i<vertexCount;i++) {
-		vertices[i].x=loader->vArr[i][0];
-		vertices[i].y=loader->vArr[i][1];
-		vertices[i].z=loader->vArr[i][2];
-		vertices[i].w=1.0;
-	}
-
-	normals = new vec3[indexCount];
-	tangents = new vec3[indexCount];
-	texcoords = new vec2[indexCount];
-	materialids = new int[indexCount];
-	indices = (int*)malloc(indexCount*sizeof(int));
+	indices = (int*)malloc(loader->faceCount * 3 * sizeof(int));
 
 	std::vector<bool> statlst; statlst.clear();
 	std::vector<int> startlst; startlst.clear();
 	std::vector<int> countlst; countlst.clear();
 	int laststat = -1;
 
-	std::map<int, bool> texcoordMap; texcoordMap.clear();
+	// Corners equal in position, texcoord, normal & material share one vertex
+	std::unordered_map<WeldKey, int, WeldHash> weldMap;
+	weldMap.reserve(loader->faceCount * 3);
+	std::vector<WeldKey> keys;
+	std::vector<vec3> tangentSums;
+
+	std::vector<int> mids(loader->mtNames.size(), 0);
+	for (uint i = 0; i < mids.size(); i++) {
+		std::map<std::string, int>::iterator it = loader->mtlLoader->objMtls.find(loader->mtNames[i]);
+		if (it != loader->mtlLoader->objMtls.end()) mids[i] = it->second;
+	}
 
-	int dupIndex = vertexCount;
+	// Faces without a valid position are dropped, missing texcoords are zero
+	//   and missing normals take the face normal
+	static const float zero[3] = { 0.0, 0.0, 0.0 };
+	int tri = 0;
 	for (int i=0;i<loader->faceCount;i++) {
-		int index1=loader->fvArr[i][0]-1;
-		int index2=loader->fvArr[i][1]-1;
-		int index3=loader->fvArr[i][2]-1;
-
-		vec3 n1(loader->vnArr[loader->fnArr[i][0]-1][0],
-				loader->vnArr[loader->fnArr[i][0]-1][1],
-				loader->vnArr[loader->fnArr[i][0]-1][2]);
-		vec3 n2(loader->vnArr[loader->fnArr[i][1]-1][0],
-				loader->vnArr[loader->fnArr[i][1]-1][1],
-				loader->vnArr[loader->fnArr[i][1]-1][2]);
-		vec3 n3(loader->vnArr[loader->fnArr[i][2]-1][0],
-				loader->vnArr[loader->fnArr[i][2]-1][1],
-				loader->vnArr[loader->fnArr[i][2]-1][2]);
-
-		vec2 c1(loader->vtArr[loader->ftArr[i][0]-1][0],
-				loader->vtArr[loader->ftArr[i][0]-1][1]);
-		vec2 c2(loader->vtArr[loader->ftArr[i][1]-1][0],
-				loader->vtArr[loader->ftArr[i][1]-1][1]);
-		vec2 c3(loader->vtArr[loader->ftArr[i][2]-1][0],
-				loader->vtArr[loader->ftArr[i][2]-1][1]);
-		
-		// Duplicate vertex if texcoord not the same
-		if (texcoordMap.find(index1) != texcoordMap.end() && texcoords[index1] != c1) {
-			int newIndex = dupIndex++;
-			vertices[newIndex] = vertices[index1];
-			index1 = newIndex;
+		const int* fv = &loader->fvArr[i * 3];
+		const int* ft = &loader->ftArr[i * 3];
+		const int* fn = &loader->fnArr[i * 3];
+		if (fv[0] < 0 || fv[1] < 0 || fv[2] < 0) continue;
+		int mid = mids[loader->mtArr[i]];
+		vec3 faceNormal(0, 0, 0);
+		if (fn[0] < 0 || fn[1] < 0 || fn[2] < 0) {
+			vec3 p0(&loader->vArr[fv[0] * 3]), p1(&loader->vArr[fv[1] * 3]), p2(&loader->vArr[fv[2] * 3]);
+			faceNormal = (p1 - p0).CrossProduct(p2 - p0);
+			if (faceNormal.GetSquaredLength() > 0.0) faceNormal.Normalize();
 		}
-		if (texcoordMap.find(index2) != texcoordMap.end() && texcoords[index2] != c2) {
-			int newIndex = dupIndex++;
-			vertices[newIndex] = vertices[index2];
-			index2 = newIndex;
+		int corners[3];
+		for (int k = 0; k < 3; k++) {
+			const float* v = &loader->vArr[fv[k] * 3];
+			const float* t = ft[k] >= 0 ? &loader->vtArr[ft[k] * loader->vtNumber] : zero;
+			const float* n = fn[k] >= 0 ? &loader->vnArr[fn[k] * 3] : (const float*)faceNormal;
+			WeldKey key;
+			key.position[0] = v[0]; key.position[1] = v[1]; key.position[2] = v[2];
+			key.texcoord[0] = t[0]; key.texcoord[1] = t[1];
+			key.normal[0] = n[0]; key.normal[1] = n[1]; key.normal[2] = n[2];
+			key.material = mid;
+
+			std::unordered_map<WeldKey, int, WeldHash>::iterator it = weldMap.find(key);
+			if (it != weldMap.end())
+				corners[k] = it->second;
+			else {
+				corners[k] = keys.size();
+				weldMap[key] = corners[k];
+				keys.push_back(key);
+				tangentSums.push_back(vec3(0, 0, 0));
+			}
+			indices[tri * 3 + k] = corners[k];
 		}
-		if (texcoordMap.find(index3) != texcoordMap.end() && texcoords[index3] != c3) {
-			int newIndex = dupIndex++;
-			vertices[newIndex] = vertices[index3];
-			index3 = newIndex;
-		}
-		
-		normals[index1] = n1; normals[index2] = n2; normals[index3] = n3;
-		texcoords[index1] = c1; texcoords[index2] = c2; texcoords[index3] = c3;
-		texcoordMap[index1] = true; texcoordMap[index2] = true; texcoordMap[index3] = true;
-
-		vec3 faceTangent = CaculateTangent(vertices[index1], vertices[index2], vertices[index3], texcoords[index1], texcoords[index2], texcoords[index3]);
-		tangents[index1] = faceTangent;
-		tangents[index2] = faceTangent;
-		tangents[index3] = faceTangent;
 
-		indices[i * 3 + 0] = index1;
-		indices[i * 3 + 1] = index2;
-		indices[i * 3 + 2] = index3;
-
-		int mid = loader->mtlLoader->objMtls[loader->mtArr[i]];
-		materialids[index1] = mid;
-		materialids[index2] = mid;
-		materialids[index3] = mid;
+		const WeldKey& k0 = keys[corners[0]];
+		const WeldKey& k1 = keys[corners[1]];
+		const WeldKey& k2 = keys[corners[2]];
+		vec3 faceTangent = CaculateTangent(
+			vec3(k0.position[0], k0.position[1], k0.position[2]), 
+			vec3(k1.position[0], k1.position[1], k1.position[2]), 
+			vec3(k2.position[0], k2.position[1], k2.position[2]), 
+			vec2(k0.texcoord[0], k0.texcoord[1]), 
+			vec2(k1.texcoord[0], k1.texcoord[1]), 
+			vec2(k2.texcoord[0], k2.texcoord[1]));
+		for (int k = 0; k < 3; k++) 
+			tangentSums[corners[k]] += faceTangent;
 
 		int curstat = 0;
 		Material* mat = MaterialManager::materials->find(mid);
@@ -148,11 +196,29 @@ void Model::initFaces() {
 		if (laststat == curstat)
 			countlst[countlst.size() - 1] += 3;
 		else {
-			startlst.push_back(i * 3);
+			startlst.push_back(tri * 3);
 			countlst.push_back(3);
 			statlst.push_back(curstat);
 		}
 		laststat = curstat;
+		tri++;
+	}
+	indexCount = tri * 3;
+
+	vertexCount = keys.size();
+	vertices = new vec4[vertexCount];
+	normals = new vec3[vertexCount];
+	tangents = new vec3[vertexCount];
+	texcoords = new vec2[vertexCount];
+	materialids = new int[vertexCount];
+	for (int i = 0; i < vertexCount; i++) {
+		const WeldKey& key = keys[i];
+		vertices[i] = vec4(key.position[0], key.position[1], key.position[2], 1.0);
+		normals[i] = vec3(key.normal[0], key.normal[1], key.normal[2]);
+		texcoords[i] = vec2(key.texcoord[0], key.texcoord[1]);
+		materialids[i] = key.material;
+		tangents[i] = tangentSums[i];
+		if (tangents[i].GetSquaredLength() > 0.0) tangents[i].Normalize();
 	}
 
 	for (uint i = 0; i < statlst.size(); i++) {
@@ -160,7 +226,6 @@ void Model::initFaces() {
 		if (!stat) normalFaces.push_back(new FaceBuf(startlst[i], countlst[i]));
 		else singleFaces.push_back(new FaceBuf(startlst[i], countlst[i]));
 	}
-	vertexCount = dupIndex;
 
 	if (normalFaces.size() > 0 && singleFaces.size() > 0) {
 		int* tmp = (int*)malloc(indexCount * sizeof(int));
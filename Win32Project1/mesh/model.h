@@ -21,6 +21,7 @@ public:
 public:
 	Model(const char* obj, const char* mtl, int vt);
 	Model(const Model& rhs);
+	Model(const Model& rhs, float ratio);
 	virtual ~Model();
 	void loadModel(const char* obj,const char* mtl,int vt);
 };
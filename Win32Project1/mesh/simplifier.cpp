@@ -0,0 +1,423 @@
+#include "simplifier.h"
+#include "../constants/constants.h"
+#include <algorithm>
+#include <string.h>
+using namespace std;
+
+Quadric::Quadric() {
+	memset(a, 0, sizeof(a));
+	memset(b, 0, sizeof(b));
+	c = 0.0;
+}
+
+void Quadric::add(const Quadric& q) {
+	for (int i = 0; i < SIMPLIFY_QUADRIC_SIZE; i++) a[i] += q.a[i];
+	for (int i = 0; i < SIMPLIFY_ATTRIBS; i++) b[i] += q.b[i];
+	c += q.c;
+}
+
+// Plane of triangle in attribute space from two orthonormal edges e1 & e2,
+//   error(p) = |p - p1|^2 - ((p - p1).e1)^2 - ((p - p1).e2)^2
+void Quadric::addTriangle(const float* p1, const float* p2, const float* p3, double weight) {
+	double e1[SIMPLIFY_ATTRIBS], e2[SIMPLIFY_ATTRIBS];
+	double l1 = 0.0, d = 0.0, l2 = 0.0;
+	for (int i = 0; i < SIMPLIFY_ATTRIBS; i++) {
+		e1[i] = p2[i] - p1[i];
+		e2[i] = p3[i] - p1[i];
+		l1 += e1[i] * e1[i];
+	}
+	if (l1 <= 0.0) return;
+	l1 = sqrt(l1);
+	for (int i = 0; i < SIMPLIFY_ATTRIBS; i++) {
+		e1[i] /= l1;
+		d += e2[i] * e1[i];
+	}
+	for (int i = 0; i < SIMPLIFY_ATTRIBS; i++) {
+		e2[i] -= d * e1[i];
+		l2 += e2[i] * e2[i];
+	}
+	if (l2 <= 1e-20) return;
+	l2 = sqrt(l2);
+	for (int i = 0; i < SIMPLIFY_ATTRIBS; i++) e2[i] /= l2;
+
+	double p1e1 = 0.0, p1e2 = 0.0, p1p1 = 0.0;
+	for (int i = 0; i < SIMPLIFY_ATTRIBS; i++) {
+		p1e1 += p1[i] * e1[i];
+		p1e2 += p1[i] * e2[i];
+		p1p1 += p1[i] * p1[i];
+	}
+
+	int n = 0;
+	for (int i = 0; i < SIMPLIFY_ATTRIBS; i++) {
+		for (int j = i; j < SIMPLIFY_ATTRIBS; j++, n++)
+			a[n] += weight * ((i == j ? 1.0 : 0.0) - e1[i] * e1[j] - e2[i] * e2[j]);
+		b[i] += weight * (p1e1 * e1[i] + p1e2 * e2[i] - p1[i]);
+	}
+	c += weight * (p1p1 - p1e1 * p1e1 - p1e2 * p1e2);
+}
+
+double Quadric::error(const float* p) const {
+	double result = c;
+	int n = 0;
+	for (int i = 0; i < SIMPLIFY_ATTRIBS; i++) {
+		result += a[n++] * p[i] * p[i];
+		for (int j = i + 1; j < SIMPLIFY_ATTRIBS; j++, n++)
+			result += 2.0 * a[n] * p[i] * p[j];
+		result += 2.0 * b[i] * p[i];
+	}
+	return result > 0.0 ? result : 0.0;
+}
+
+struct Collapse {
+	double cost;
+	int from, to;
+};
+
+Simplifier::Simplifier(const Mesh* src) {
+	mesh = src;
+	singleCount = 0;
+
+	triangles.assign(mesh->indices, mesh->indices + mesh->indexCount);
+	groups.assign(mesh->indexCount / 3, 1);
+	for (uint i = 0; i < mesh->singleFaces.size(); i++) {
+		FaceBuf* buf = mesh->singleFaces[i];
+		for (int j = buf->start / 3; j < (buf->start + buf->count) / 3; j++)
+			groups[j] = 0;
+	}
+
+	initAttribs();
+	compact();
+	initLocks();
+	initQuadrics();
+}
+
+Simplifier::~Simplifier() {
+	attribs.clear();
+	positionIds.clear();
+	locked.clear();
+	quadrics.clear();
+	triangles.clear();
+	groups.clear();
+	triStarts.clear();
+	triLists.clear();
+	indices.clear();
+	vertices.clear();
+}
+
+void Simplifier::initAttribs() {
+	int count = mesh->vertexCount;
+	vec3 low = mesh->vertices3[0], high = low;
+	for (int i = 1; i < count; i++) {
+		vec3 p = mesh->vertices3[i];
+		low = vec3(p.x < low.x ? p.x : low.x, p.y < low.y ? p.y : low.y, p.z < low.z ? p.z : low.z);
+		high = vec3(p.x > high.x ? p.x : high.x, p.y > high.y ? p.y : high.y, p.z > high.z ? p.z : high.z);
+	}
+	vec3 extent = high - low;
+	float size = max(extent.x, max(extent.y, extent.z));
+	float scale = size > 0.0 ? 1.0 / size : 1.0;
+
+	attribs.resize(count * SIMPLIFY_ATTRIBS);
+	for (int i = 0; i < count; i++) {
+		float* attrib = &attribs[i * SIMPLIFY_ATTRIBS];
+		vec3 p = (mesh->vertices3[i] - low) * scale;
+		attrib[0] = p.x; attrib[1] = p.y; attrib[2] = p.z;
+		attrib[3] = mesh->texcoords[i].x * SIMPLIFY_TEXCOORD_WEIGHT;
+		attrib[4] = mesh->texcoords[i].y * SIMPLIFY_TEXCOORD_WEIGHT;
+		attrib[5] = mesh->normals[i].x * SIMPLIFY_NORMAL_WEIGHT;
+		attrib[6] = mesh->normals[i].y * SIMPLIFY_NORMAL_WEIGHT;
+		attrib[7] = mesh->normals[i].z * SIMPLIFY_NORMAL_WEIGHT;
+	}
+
+	// Sort vertices by position so equal positions are neighbours
+	vector<int> order(count);
+	for (int i = 0; i < count; i++) order[i] = i;
+	const vec3* positions = mesh->vertices3;
+	sort(order.begin(), order.end(), [positions](int l, int r) {
+		if (positions[l].x != positions[r].x) return positions[l].x < positions[r].x;
+		if (positions[l].y != positions[r].y) return positions[l].y < positions[r].y;
+		return positions[l].z < positions[r].z;
+	});
+	positionIds.resize(count);
+	int id = -1;
+	for (int i = 0; i < count; i++) {
+		if (i == 0 || positions[order[i]] != positions[order[i - 1]]) id++;
+		positionIds[order[i]] = id;
+	}
+}
+
+// Lock positions which moving would open holes or mix materials & face groups
+void Simplifier::initLocks() {
+	int count = mesh->vertexCount;
+	int positionCount = 0;
+	for (int i = 0; i < count; i++)
+		positionCount = max(positionCount, positionIds[i] + 1);
+	vector<int> groupMasks(positionCount, 0);
+	vector<bool> lockedPositions(positionCount, false);
+
+	vector<u64> edges;
+	for (uint t = 0; t < triangles.size() / 3; t++) {
+		const int* tri = &triangles[t * 3];
+		bool mixed = mesh->materialids[tri[0]] != mesh->materialids[tri[1]] ||
+			mesh->materialids[tri[0]] != mesh->materialids[tri[2]];
+		for (int k = 0; k < 3; k++) {
+			u64 p0 = positionIds[tri[k]], p1 = positionIds[tri[(k + 1) % 3]];
+			edges.push_back(p0 < p1 ? (p0 << 32) | p1 : (p1 << 32) | p0);
+			groupMasks[p0] |= 1 << groups[t];
+			if (mixed) lockedPositions[p0] = true;
+		}
+	}
+
+	// Edges used by other than two triangles are borders or non manifold
+	sort(edges.begin(), edges.end());
+	for (uint i = 0; i < edges.size();) {
+		uint j = i + 1;
+		while (j < edges.size() && edges[j] == edges[i]) j++;
+		if (j - i != 2) {
+			lockedPositions[(int)(edges[i] >> 32)] = true;
+			lockedPositions[(int)(edges[i] & 0xffffffff)] = true;
+		}
+		i = j;
+	}
+
+	locked.resize(count);
+	for (int i = 0; i < count; i++) {
+		int p = positionIds[i];
+		locked[i] = lockedPositions[p] || groupMasks[p] == 3;
+	}
+}
+
+void Simplifier::initQuadrics() {
+	quadrics.assign(mesh->vertexCount, Quadric());
+	for (uint t = 0; t < triangles.size() / 3; t++) {
+		const int* tri = &triangles[t * 3];
+		const float* p1 = &attribs[tri[0] * SIMPLIFY_ATTRIBS];
+		const float* p2 = &attribs[tri[1] * SIMPLIFY_ATTRIBS];
+		const float* p3 = &attribs[tri[2] * SIMPLIFY_ATTRIBS];
+		vec3 e1(p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2]);
+		vec3 e2(p3[0] - p1[0], p3[1] - p1[1], p3[2] - p1[2]);
+		double area = e1.CrossProduct(e2).GetLength() * 0.5;
+
+		Quadric q;
+		q.addTriangle(p1, p2, p3, area);
+		for (int k = 0; k < 3; k++)
+			quadrics[tri[k]].add(q);
+	}
+}
+
+void Simplifier::buildAdjacency() {
+	int positionCount = 0;
+	for (uint i = 0; i < positionIds.size(); i++)
+		positionCount = max(positionCount, positionIds[i] + 1);
+	triStarts.assign(positionCount + 1, 0);
+	for (uint i = 0; i < triangles.size(); i++)
+		triStarts[positionIds[triangles[i]] + 1]++;
+	for (int i = 0; i < positionCount; i++)
+		triStarts[i + 1] += triStarts[i];
+	triLists.resize(triangles.size());
+	vector<int> fills(triStarts.begin(), triStarts.end() - 1);
+	for (uint i = 0; i < triangles.size(); i++)
+		triLists[fills[positionIds[triangles[i]]]++] = i / 3;
+}
+
+// Pair each vertex at from's position with the vertex at to's position it shares a triangle with,
+//   false if one has none or two of them, then collapse would tear or shift a seam
+bool Simplifier::mapWedges(int from, int to) {
+	int pf = positionIds[from], pt = positionIds[to];
+	wedgeFrom.clear();
+	wedgeTo.clear();
+	for (int i = triStarts[pf]; i < triStarts[pf + 1]; i++) {
+		const int* tri = &triangles[triLists[i] * 3];
+		if (tri[0] < 0) continue;
+		int v = -1, w = -1;
+		for (int k = 0; k < 3; k++) {
+			if (positionIds[tri[k]] == pf) v = tri[k];
+			else if (positionIds[tri[k]] == pt) w = tri[k];
+		}
+		if (w < 0) continue;
+		uint j = 0;
+		while (j < wedgeFrom.size() && wedgeFrom[j] != v) j++;
+		if (j == wedgeFrom.size()) {
+			if (mesh->materialids[v] != mesh->materialids[w]) return false;
+			wedgeFrom.push_back(v);
+			wedgeTo.push_back(w);
+		} else if (wedgeTo[j] != w) 
+			return false;
+	}
+	for (int i = triStarts[pf]; i < triStarts[pf + 1]; i++) {
+		const int* tri = &triangles[triLists[i] * 3];
+		if (tri[0] < 0) continue;
+		for (int k = 0; k < 3; k++) {
+			if (positionIds[tri[k]] != pf) continue;
+			if (find(wedgeFrom.begin(), wedgeFrom.end(), tri[k]) == wedgeFrom.end()) return false;
+		}
+	}
+	return wedgeFrom.size() > 0;
+}
+
+// Of pairs mapWedges made
+double Simplifier::collapseCost() {
+	double cost = 0.0;
+	for (uint i = 0; i < wedgeFrom.size(); i++)
+		cost += quadrics[wedgeFrom[i]].error(&attribs[wedgeTo[i] * SIMPLIFY_ATTRIBS]);
+	return cost;
+}
+
+// Edge from-to must have just its two triangles' third vertices as common neighbours,
+//   and no triangle moving with from may turn past SIMPLIFY_MIN_NORMAL_DOT
+bool Simplifier::canCollapse(int from, int to) {
+	int pf = positionIds[from], pt = positionIds[to];
+	if (!mapWedges(from, to)) return false;
+	fromRing.clear();
+	toRing.clear();
+	for (int i = triStarts[pf]; i < triStarts[pf + 1]; i++) {
+		const int* tri = &triangles[triLists[i] * 3];
+		if (tri[0] < 0) continue;
+		for (int k = 0; k < 3; k++)
+			if (positionIds[tri[k]] != pf) fromRing.push_back(positionIds[tri[k]]);
+	}
+	for (int i = triStarts[pt]; i < triStarts[pt + 1]; i++) {
+		const int* tri = &triangles[triLists[i] * 3];
+		if (tri[0] < 0) continue;
+		for (int k = 0; k < 3; k++)
+			if (positionIds[tri[k]] != pt) toRing.push_back(positionIds[tri[k]]);
+	}
+	sort(fromRing.begin(), fromRing.end());
+	fromRing.erase(unique(fromRing.begin(), fromRing.end()), fromRing.end());
+	sort(toRing.begin(), toRing.end());
+	toRing.erase(unique(toRing.begin(), toRing.end()), toRing.end());
+	int common = 0;
+	for (uint i = 0, j = 0; i < fromRing.size() && j < toRing.size();) {
+		if (fromRing[i] < toRing[j]) i++;
+		else if (fromRing[i] > toRing[j]) j++;
+		else { common++; i++; j++; }
+	}
+	if (common != 2) return false;
+
+	const vec3* positions = mesh->vertices3;
+	for (int i = triStarts[pf]; i < triStarts[pf + 1]; i++) {
+		const int* tri = &triangles[triLists[i] * 3];
+		if (tri[0] < 0) continue;
+		if (positionIds[tri[0]] == pt || positionIds[tri[1]] == pt || positionIds[tri[2]] == pt) continue;
+		vec3 p[3], q[3];
+		for (int k = 0; k < 3; k++) {
+			p[k] = positions[tri[k]];
+			q[k] = positionIds[tri[k]] == pf ? positions[to] : p[k];
+		}
+		vec3 before = (p[1] - p[0]).CrossProduct(p[2] - p[0]);
+		vec3 after = (q[1] - q[0]).CrossProduct(q[2] - q[0]);
+		if (before.DotProduct(after) <= SIMPLIFY_MIN_NORMAL_DOT * before.GetLength() * after.GetLength()) return false;
+	}
+	return true;
+}
+
+// Moves the pairs canCollapse just mapped
+void Simplifier::collapse(int from, int to, vector<bool>& touched) {
+	int pf = positionIds[from], pt = positionIds[to];
+	for (int i = triStarts[pf]; i < triStarts[pf + 1]; i++) {
+		int* tri = &triangles[triLists[i] * 3];
+		if (tri[0] < 0) continue;
+		bool degenerate = false;
+		for (int k = 0; k < 3; k++) {
+			if (positionIds[tri[k]] == pf) 
+				tri[k] = wedgeTo[find(wedgeFrom.begin(), wedgeFrom.end(), tri[k]) - wedgeFrom.begin()];
+			else if (positionIds[tri[k]] == pt) 
+				degenerate = true;
+			touched[positionIds[tri[k]]] = true;
+		}
+		if (degenerate) tri[0] = tri[1] = tri[2] = -1;
+	}
+	touched[pt] = true;
+	for (uint i = 0; i < wedgeFrom.size(); i++)
+		quadrics[wedgeTo[i]].add(quadrics[wedgeFrom[i]]);
+}
+
+// Drop removed and zero area triangles
+void Simplifier::compact() {
+	uint count = 0;
+	for (uint t = 0; t < triangles.size() / 3; t++) {
+		const int* tri = &triangles[t * 3];
+		if (tri[0] < 0) continue;
+		int p0 = positionIds[tri[0]], p1 = positionIds[tri[1]], p2 = positionIds[tri[2]];
+		if (p0 == p1 || p0 == p2 || p1 == p2) continue;
+		if (count != t) {
+			memcpy(&triangles[count * 3], tri, 3 * sizeof(int));
+			groups[count] = groups[t];
+		}
+		count++;
+	}
+	triangles.resize(count * 3);
+	groups.resize(count);
+}
+
+// Passes of cheapest collapses, each pass moves a position at most once and
+//   leaves its neighbours alone, so costs & checks stay valid within the pass
+void Simplifier::simplify(float ratio) {
+	uint target = (uint)(mesh->indexCount / 3 * ratio);
+	if (target < 1) target = 1;
+
+	vector<Collapse> candidates;
+	for (int pass = 0; pass < SIMPLIFY_MAX_PASSES && triangles.size() / 3 > target; pass++) {
+		buildAdjacency();
+		candidates.clear();
+		for (uint t = 0; t < triangles.size() / 3; t++) {
+			const int* tri = &triangles[t * 3];
+			for (int k = 0; k < 3; k++) {
+				int from = tri[k];
+				if (locked[from]) continue;
+				for (int l = 1; l < 3; l++) {
+					int to = tri[(k + l) % 3];
+					if (!mapWedges(from, to)) continue;
+					Collapse candidate;
+					candidate.cost = collapseCost();
+					candidate.from = from;
+					candidate.to = to;
+					candidates.push_back(candidate);
+				}
+			}
+		}
+		if (candidates.size() == 0) break;
+		sort(candidates.begin(), candidates.end(), [](const Collapse& l, const Collapse& r) {
+			return l.cost < r.cost;
+		});
+
+		// Each collapse removes about two triangles, keep pass to cheapest ones it needs
+		uint needed = (triangles.size() / 3 - target + 1) / 2;
+		uint last = min((uint)candidates.size(), max(needed * 4, (uint)candidates.size() / 16 + 1)) - 1;
+		double limit = candidates[last].cost;
+
+		vector<bool> touched(triStarts.size(), false);
+		uint remains = triangles.size() / 3;
+		int collapses = 0;
+		for (uint i = 0; i < candidates.size() && remains > target; i++) {
+			const Collapse& candidate = candidates[i];
+			if (candidate.cost > limit && collapses > 0) break;
+			if (touched[positionIds[candidate.from]] || touched[positionIds[candidate.to]]) continue;
+			if (!canCollapse(candidate.from, candidate.to)) continue;
+			collapse(candidate.from, candidate.to, touched);
+			collapses++;
+			remains -= 2;
+		}
+		compact();
+		if (collapses == 0) break;
+	}
+
+	// Output with unused vertices dropped, in order of first use
+	vector<int> newIndices(mesh->vertexCount, -1);
+	vertices.clear();
+	indices.clear();
+	singleCount = 0;
+	for (int group = 0; group < 2; group++) {
+		for (uint t = 0; t < triangles.size() / 3; t++) {
+			if (groups[t] != group) continue;
+			for (int k = 0; k < 3; k++) {
+				int vertex = triangles[t * 3 + k];
+				if (newIndices[vertex] < 0) {
+					newIndices[vertex] = vertices.size();
+					vertices.push_back(vertex);
+				}
+				indices.push_back(newIndices[vertex]);
+			}
+		}
+		if (group == 0) singleCount = indices.size();
+	}
+}
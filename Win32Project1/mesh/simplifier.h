@@ -0,0 +1,63 @@
+#ifndef SIMPLIFIER_H_
+#define SIMPLIFIER_H_
+
+#include "mesh.h"
+#include <vector>
+
+// Per vertex attributes quadrics measure: position 3, texcoord 2, normal 3
+#define SIMPLIFY_ATTRIBS 8
+#define SIMPLIFY_QUADRIC_SIZE (SIMPLIFY_ATTRIBS * (SIMPLIFY_ATTRIBS + 1) / 2)
+#define SIMPLIFY_TEXCOORD_WEIGHT 1.0
+#define SIMPLIFY_NORMAL_WEIGHT 0.5
+#define SIMPLIFY_MAX_PASSES 64
+#define SIMPLIFY_MIN_NORMAL_DOT 0.5 // Cosine a moved triangle's normal may turn by at most
+
+// Squared distance to triangle planes in attribute space, Garland & Heckbert 98,
+//   a is upper triangle of the symmetric matrix row by row
+struct Quadric {
+	double a[SIMPLIFY_QUADRIC_SIZE];
+	double b[SIMPLIFY_ATTRIBS];
+	double c;
+	Quadric();
+	void add(const Quadric& q);
+	void addTriangle(const float* p1, const float* p2, const float* p3, double weight);
+	double error(const float* p) const;
+};
+
+// Collapses positions onto neighbours by least quadric error till triangles drop to a ratio,
+//   vertices on borders or non manifold edges are locked, every vertex (wedge) at a seam
+//   position collapses with the wedge it shares an edge with, so seams move along themselves,
+//   a collapse keeps the target vertices so no new attributes are made
+class Simplifier {
+private:
+	const Mesh* mesh;
+	std::vector<float> attribs; // SIMPLIFY_ATTRIBS per vertex, position scaled to unit size
+	std::vector<int> positionIds; // Vertices at one position share id
+	std::vector<bool> locked;
+	std::vector<Quadric> quadrics;
+	std::vector<int> triangles; // Current triangles, 3 vertices each
+	std::vector<int> groups; // Per triangle, 0 single face 1 normal face
+	std::vector<int> triStarts, triLists; // Triangles around each position
+	std::vector<int> fromRing, toRing; // Neighbour positions of collapse being checked
+	std::vector<int> wedgeFrom, wedgeTo; // Vertex pairs moving in collapse being checked
+private:
+	void initAttribs();
+	void initLocks();
+	void initQuadrics();
+	void buildAdjacency();
+	bool mapWedges(int from, int to);
+	double collapseCost();
+	bool canCollapse(int from, int to);
+	void collapse(int from, int to, std::vector<bool>& touched);
+	void compact();
+public:
+	std::vector<int> indices; // Output triangles, single faces first
+	std::vector<int> vertices; // Output vertex to input vertex
+	int singleCount; // Indices of single faces at front of indices
+public:
+	Simplifier(const Mesh* src);
+	~Simplifier();
+	void simplify(float ratio);
+};
+
+#endif
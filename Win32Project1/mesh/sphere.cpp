@@ -17,6 +17,7 @@ Sphere::Sphere(int m, int n) :Mesh() {
 	materialids = NULL;
 	initFaces();
 	caculateExData();
+	optimize(false);
 }
 
 Sphere::Sphere(const Sphere& rhs) {
@@ -16,6 +16,7 @@ Water::Water(int size, float height) :Mesh() {
 	materialids = NULL;
 	initFaces();
 	caculateExData();
+	optimize(false);
 }
 
 Water::~Water() {
@@ -1,8 +1,6 @@
 #include "mtlloader.h"
-#include <stdio.h>
-#include <iostream>
-#include <fstream>
-#include <sstream>
+#include "textParser.h"
+#include "../util/mappedFile.h"
 #include "../assets/assetManager.h"
 #include "../material/materialManager.h"
 using namespace std;
@@ -10,7 +8,6 @@ using namespace std;
 MtlLoader::MtlLoader(const char* mtlPath) {
 	mtlFilePath=mtlPath;
 	mtlCount=0;
-	readMtlInfo();
 	readMtlFile();
 }
 
@@ -18,93 +15,55 @@ MtlLoader::~MtlLoader() {
 	objMtls.clear();
 }
 
-void MtlLoader::readMtlInfo() {
-	ifstream infile(mtlFilePath);
-	string sline;
-	while(getline(infile,sline)) {
-		if(sline[0]=='n'&&sline[1]=='e')//newmtl
-			mtlCount++;
-	}
-	infile.close();
+static const char* ParseColor(const char* p, const char* end, vec3& color) {
+	float* values = color;
+	for (int k = 0; k < 3; k++)
+		p = ParseFloat(SkipSpaces(p, end), end, values[k]);
+	return p;
 }
 
 void MtlLoader::readMtlFile() {
-	ifstream infile(mtlFilePath);
-	string sline;
-	int n = 0, t = 0, d = 0, a = 0, s = 0, c = 0;
+	MappedFile file(mtlFilePath);
+	if (!file.data) return;
 
-	string value,name,texture;
-	float red = 0, green = 0, blue = 0, single = 0;
-	Material* mtl=NULL;
-	while(getline(infile,sline)) {
-		if(sline!="") {
-			istringstream ins(sline);
-			ins>>value;
-			if(value=="newmtl") {
-				ins>>name;
-				mtl = new Material(name.c_str());
-				objMtls[name] = MaterialManager::materials->add(mtl);
-				n++;
-			} else if (value == "map_Kd") {
-				ins >> texture;
-				if (mtl) {
-					mtl->tex1 = texture;
-					mtl->srgb1 = true;
-				}
-				t++;
-			} else if (value == "map_Kn") {
-				ins >> texture;
-				if (mtl) {
-					mtl->tex2 = texture;
-					mtl->srgb2 = false;
-				}
-				t++;
-			} else if (value == "map_Km") {
-				ins >> texture;
-				if (mtl) {
-					mtl->tex3 = texture;
-					mtl->srgb3 = false;
-				}
-				t++;
-			} else if (value == "map_Kr") {
-				ins >> texture;
-				if (mtl) {
-					mtl->tex4 = texture;
-					mtl->srgb4 = false;
-				}
-				t++;
-			} else if (value == "Kd") {
-				ins>>red>>green>>blue;
-				if(mtl) {
-					mtl->diffuse.x=red;
-					mtl->diffuse.y=green;
-					mtl->diffuse.z=blue;
-				}
-				d++;
-			} else if (value == "Ka") {
-				ins >> red >> green >> blue;
-				if (mtl) {
-					mtl->ambient.x = red;
-					mtl->ambient.y = green;
-					mtl->ambient.z = blue;
-				}
-				a++;
-			} else if (value == "Ks") {
-				ins >> red >> green >> blue;
-				if (mtl) {
-					mtl->specular.x = red;
-					mtl->specular.y = green;
-					mtl->specular.z = blue;
-				}
-				s++;
-			} else if (value == "single") {
-				ins >> single;
-				if (mtl) 
-					mtl->singleFace = true;
-				c++;
-			}
+	string value, name, texture;
+	Material* mtl = NULL;
+	const char* end = file.data + file.size;
+	for (const char* p = file.data; p < end; p = SkipLine(p, end)) {
+		p = SkipSpaces(p, end);
+		p = ParseToken(p, end, value);
+		p = SkipSpaces(p, end);
+		if (value == "newmtl") {
+			p = ParseToken(p, end, name);
+			mtl = new Material(name.c_str());
+			objMtls[name] = MaterialManager::materials->add(mtl);
+			mtlCount++;
+		} else if (!mtl) {
+			continue;
+		} else if (value == "map_Kd") {
+			p = ParseToken(p, end, texture);
+			mtl->tex1 = texture;
+			mtl->srgb1 = true;
+		} else if (value == "map_Kn") {
+			p = ParseToken(p, end, texture);
+			mtl->tex2 = texture;
+			mtl->srgb2 = false;
+		} else if (value == "map_Km") {
+			p = ParseToken(p, end, texture);
+			mtl->tex3 = texture;
+			mtl->srgb3 = false;
+		} else if (value == "map_Kr") {
+			p = ParseToken(p, end, texture);
+			mtl->tex4 = texture;
+			mtl->srgb4 = false;
+		} else if (value == "Kd") {
+			p = ParseColor(p, end, mtl->diffuse);
+		} else if (value == "Ka") {
+			p = ParseColor(p, end, mtl->ambient);
+		} else if (value == "Ks") {
+			p = ParseColor(p, end, mtl->specular);
+		} else if (value == "single") {
+			mtl->singleFace = true;
 		}
 	}
-	infile.close();
 }
-
@@ -1,10 +1,25 @@
 #include "objloader.h"
-#include <stdio.h>
-#include <iostream>
-#include <fstream>
-#include <sstream>
+#include "textParser.h"
+#include "../util/mappedFile.h"
+#include "../util/jobSystem.h"
+#include <algorithm>
 using namespace std;
 
+// Parse results of one chunk, face indices count from 0 of whole file except
+//   negative ones, which count from chunk start till chunk bases are known
+struct ObjChunk {
+	const char* begin;
+	const char* end;
+	vector<float> v, vt, vn;
+	vector<int> fv, ft, fn;
+	vector<int> mt; // Index of materials, -1 before first usemtl of chunk
+	vector<int> relatives; // Corner * 3 + attribute of negative indices
+	vector<string> materials;
+	vector<int> materialIds; // Index of loader's mtNames per materials
+	int lastMaterial; // Material in use at chunk end, -1 if no usemtl
+	int vBase, vtBase, vnBase, faceBase;
+};
+
 ObjLoader::ObjLoader(const char* objPath,const char* mtlPath,int vtNum) {
 	objFilePath=objPath;
 	mtlFilePath=mtlPath;
@@ -13,145 +28,207 @@ ObjLoader::ObjLoader(const char* objPath,const char* mtlPath,int vtNum) {
 	vnCount=0;
 	vtCount=0;
 	faceCount=0;
-	readObjInfo();
 	readObjFile();
 	mtlLoader=new MtlLoader(mtlFilePath);
 }
 
-void ObjLoader::readObjInfo() {
-	ifstream infile(objFilePath);
-	string sline;
-
-	while(getline(infile,sline)) {//ָļжȡ
-		if(sline[0]=='v') {
-			if(sline[1]=='n')
-				vnCount++;
-			else if(sline[1]=='t')
-				vtCount++;
-			else
-				vCount++;
-		}
-		if(sline[0]=='f')
-			faceCount++;
-	}
-	infile.close();
+ObjLoader::~ObjLoader() {
+	delete mtlLoader;
+	mtlLoader=NULL;
 }
 
 void ObjLoader::readObjFile() {
-	vArr=new float*[vCount];
-	for (int i=0;i<vCount;i++)
-		vArr[i]=new float[3];
-
-	vnArr=new float*[vnCount];
-	for (int i=0;i<vnCount;i++)
-		vnArr[i]=new float[3];
-
-	vtArr=new float*[vtCount];
-	for (int i=0;i<vtCount;i++)
-		vtArr[i]=new float[vtNumber];
-
-	fvArr=new int*[faceCount];
-	ftArr=new int*[faceCount];
-	fnArr=new int*[faceCount];
-	for (int i=0;i<faceCount;i++) {
-		fvArr[i]=new int[3];
-		ftArr[i]=new int[3];
-		fnArr[i]=new int[3];
+	MappedFile file(objFilePath);
+	if (!file.data) return;
+
+	vector<ObjChunk> chunks;
+	const char* fileEnd = file.data + file.size;
+	for (const char* p = file.data; p < fileEnd;) {
+		ObjChunk chunk;
+		chunk.begin = p;
+		chunk.end = fileEnd - p > OBJ_CHUNK_SIZE ? SkipLine(p + OBJ_CHUNK_SIZE, fileEnd) : fileEnd;
+		chunks.push_back(chunk);
+		p = chunk.end;
+	}
+
+	if (JobSystem::jobSystem && chunks.size() > 1) {
+		JobSystem::jobSystem->parallelFor(chunks.size(), 1, [this, &chunks](uint begin, uint end) {
+			for (uint i = begin; i < end; i++)
+				parseChunk(&chunks[i]);
+		});
+	} else {
+		for (uint i = 0; i < chunks.size(); i++)
+			parseChunk(&chunks[i]);
 	}
-	mtArr=new string[faceCount];
-
-	ifstream infile(objFilePath);
-	string sline;
-	int ii=0,tt=0,jj=0,kk=0;
-
-	string s1;
-	float f2,f3,f4;
-	string mtl("");
-
-	while(getline(infile,sline)) {
-		if(sline[0]=='v') {
-			if(sline[1]=='n') {//vn
-				istringstream ins(sline);
-				ins>>s1>>f2>>f3>>f4;
-				vnArr[ii][0]=f2;
-				vnArr[ii][1]=f3;
-				vnArr[ii][2]=f4;
-				ii++;
-			} else if(sline[1]=='t') {//vt
-				istringstream ins(sline);
-				if(vtNumber==3) {
-					ins>>s1>>f2>>f3>>f4;
-					vtArr[tt][0]=f2;
-					vtArr[tt][1]=f3;
-					vtArr[tt][2]=f4;
-				} else {
-					ins>>s1>>f2>>f3;
-					vtArr[tt][0]=f2;
-					vtArr[tt][1]=f3;
+
+	// Chunk bases & material table in file order, faces before any usemtl
+	//   of a chunk keep the last material of chunks before
+	map<string, int> materialMap;
+	mtNames.push_back("");
+	materialMap[""] = 0;
+	vector<int> firstMaterials(chunks.size());
+	int lastMaterial = 0;
+	for (uint i = 0; i < chunks.size(); i++) {
+		ObjChunk& chunk = chunks[i];
+		chunk.vBase = vCount;
+		chunk.vtBase = vtCount;
+		chunk.vnBase = vnCount;
+		chunk.faceBase = faceCount;
+		vCount += chunk.v.size() / 3;
+		vtCount += chunk.vt.size() / vtNumber;
+		vnCount += chunk.vn.size() / 3;
+		faceCount += chunk.fv.size() / 3;
+
+		for (uint m = 0; m < chunk.materials.size(); m++) {
+			map<string, int>::iterator it = materialMap.find(chunk.materials[m]);
+			if (it != materialMap.end())
+				chunk.materialIds.push_back(it->second);
+			else {
+				chunk.materialIds.push_back(mtNames.size());
+				materialMap[chunk.materials[m]] = mtNames.size();
+				mtNames.push_back(chunk.materials[m]);
+			}
+		}
+		firstMaterials[i] = lastMaterial;
+		if (chunk.lastMaterial >= 0) lastMaterial = chunk.materialIds[chunk.lastMaterial];
+	}
+
+	vArr.resize(vCount * 3);
+	vtArr.resize(vtCount * vtNumber);
+	vnArr.resize(vnCount * 3);
+	fvArr.resize(faceCount * 3);
+	ftArr.resize(faceCount * 3);
+	fnArr.resize(faceCount * 3);
+	mtArr.resize(faceCount);
+	if (JobSystem::jobSystem && chunks.size() > 1) {
+		JobSystem::jobSystem->parallelFor(chunks.size(), 1, [this, &chunks, &firstMaterials](uint begin, uint end) {
+			for (uint i = begin; i < end; i++)
+				mergeChunk(&chunks[i], firstMaterials[i]);
+		});
+	} else {
+		for (uint i = 0; i < chunks.size(); i++)
+			mergeChunk(&chunks[i], firstMaterials[i]);
+	}
+}
+
+// Index from 0, negative ones are relative to count so far
+static inline int ResolveIndex(int index, int count, bool& relative) {
+	relative = index < 0;
+	if (index > 0) return index - 1;
+	if (index < 0) return count + index;
+	return -1;
+}
+
+void ObjLoader::parseChunk(ObjChunk* chunk) {
+	const char* p = chunk->begin;
+	const char* end = chunk->end;
+	size_t bytes = end - p;
+	chunk->v.reserve(bytes / 16);
+	chunk->fv.reserve(bytes / 8);
+	chunk->ft.reserve(bytes / 8);
+	chunk->fn.reserve(bytes / 8);
+	chunk->mt.reserve(bytes / 24);
+
+	vector<int> polygon, relatives; // 3 per corner
+	int material = -1;
+	string name;
+	while (p < end) {
+		p = SkipSpaces(p, end);
+		if (end - p > 1 && p[0] == 'v' && IsBlank(p[1])) {
+			float position[3] = { 0.0, 0.0, 0.0 };
+			p += 1;
+			for (int k = 0; k < 3; k++)
+				p = ParseFloat(SkipSpaces(p, end), end, position[k]);
+			chunk->v.insert(chunk->v.end(), position, position + 3);
+		} else if (end - p > 2 && p[0] == 'v' && p[1] == 't' && IsBlank(p[2])) {
+			p += 2;
+			for (int k = 0; k < vtNumber; k++) {
+				float texcoord = 0.0;
+				p = ParseFloat(SkipSpaces(p, end), end, texcoord);
+				chunk->vt.push_back(texcoord);
+			}
+		} else if (end - p > 2 && p[0] == 'v' && p[1] == 'n' && IsBlank(p[2])) {
+			float normal[3] = { 0.0, 0.0, 0.0 };
+			p += 2;
+			for (int k = 0; k < 3; k++)
+				p = ParseFloat(SkipSpaces(p, end), end, normal[k]);
+			chunk->vn.insert(chunk->vn.end(), normal, normal + 3);
+		} else if (end - p > 1 && p[0] == 'f' && IsBlank(p[1])) {
+			// Corners as v, v/t, v//n or v/t/n
+			int counts[3] = { (int)chunk->v.size() / 3, (int)chunk->vt.size() / vtNumber, (int)chunk->vn.size() / 3 };
+			polygon.clear();
+			relatives.clear();
+			p += 1;
+			while (true) {
+				int index[3] = { 0, 0, 0 };
+				p = SkipSpaces(p, end);
+				const char* next = ParseInt(p, end, index[0]);
+				if (next == p) break;
+				p = next;
+				if (p < end && *p == '/') {
+					p = ParseInt(p + 1, end, index[1]);
+					if (p < end && *p == '/') p = ParseInt(p + 1, end, index[2]);
+				}
+				for (int k = 0; k < 3; k++) {
+					bool relative = false;
+					polygon.push_back(ResolveIndex(index[k], counts[k], relative));
+					relatives.push_back(relative);
 				}
-				tt++;
-			} else {//v
-				istringstream ins(sline);
-				ins>>s1>>f2>>f3>>f4;
-				vArr[jj][0]=f2;
-				vArr[jj][1]=f3;
-				vArr[jj][2]=f4;
-				jj++;
 			}
-		} else if(sline[0]=='f') { //f
-			istringstream ins(sline);
-			float a;
-			ins>>s1;//ȥf
-			int i,k;
-			for(i=0;i<3;i++) {
-				ins>>s1;
-				//ȡһͷ
-				a=0;
-				for(k=0;s1[k]!='/';k++)
-					a=a*10+(s1[k]-48);
-				fvArr[kk][i]=a;
-
-				a=0;
-				for(k=k+1;s1[k]!='/';k++)
-					a=a*10+(s1[k]-48);
-				ftArr[kk][i]=a;
-
-				a=0;
-				for(k=k+1;s1[k];k++)
-					a=a*10+(s1[k]-48);
-				fnArr[kk][i]=a;
+
+			// Fan from first corner
+			int corners = polygon.size() / 3;
+			for (int c = 1; c + 1 < corners; c++) {
+				int fan[3] = { 0, c, c + 1 };
+				for (int k = 0; k < 3; k++) {
+					int corner = chunk->fv.size();
+					const int* attribs = &polygon[fan[k] * 3];
+					const int* flags = &relatives[fan[k] * 3];
+					chunk->fv.push_back(attribs[0]);
+					chunk->ft.push_back(attribs[1]);
+					chunk->fn.push_back(attribs[2]);
+					for (int a = 0; a < 3; a++) {
+						if (flags[a]) chunk->relatives.push_back(corner * 3 + a);
+					}
+				}
+				chunk->mt.push_back(material);
 			}
-			mtArr[kk]=mtl;
-			kk++;
-		} else if(sline[0]=='u'&&sline[1]=='s') {//usemtl
-			istringstream ins(sline);
-			ins>>s1>>mtl;
+		} else if (MatchWord(p, end, "usemtl")) {
+			p = ParseToken(SkipSpaces(p + 6, end), end, name);
+			vector<string>::iterator it = find(chunk->materials.begin(), chunk->materials.end(), name);
+			material = it - chunk->materials.begin();
+			if (it == chunk->materials.end()) chunk->materials.push_back(name);
 		}
+		p = SkipLine(p, end);
 	}
-	infile.close();
+	chunk->lastMaterial = material;
 }
 
-ObjLoader::~ObjLoader() {
-	for(int i=0;i<vCount;i++)
-		delete[] vArr[i];
-	for(int i=0;i<vnCount;i++)
-		delete[] vnArr[i];
-	for(int i=0;i<vtCount;i++)
-		delete[] vtArr[i];
-	for(int i=0;i<faceCount;i++) {
-		delete[] fvArr[i];
-		delete[] ftArr[i];
-		delete[] fnArr[i];
+void ObjLoader::mergeChunk(ObjChunk* chunk, int firstMaterial) {
+	copy(chunk->v.begin(), chunk->v.end(), vArr.begin() + chunk->vBase * 3);
+	copy(chunk->vt.begin(), chunk->vt.end(), vtArr.begin() + chunk->vtBase * vtNumber);
+	copy(chunk->vn.begin(), chunk->vn.end(), vnArr.begin() + chunk->vnBase * 3);
+	if (chunk->mt.empty()) return;
+
+	int* faces[3] = { &fvArr[0] + chunk->faceBase * 3, &ftArr[0] + chunk->faceBase * 3, &fnArr[0] + chunk->faceBase * 3 };
+	copy(chunk->fv.begin(), chunk->fv.end(), faces[0]);
+	copy(chunk->ft.begin(), chunk->ft.end(), faces[1]);
+	copy(chunk->fn.begin(), chunk->fn.end(), faces[2]);
+	int bases[3] = { chunk->vBase, chunk->vtBase, chunk->vnBase };
+	for (uint i = 0; i < chunk->relatives.size(); i++) {
+		int slot = chunk->relatives[i];
+		faces[slot % 3][slot / 3] += bases[slot % 3];
 	}
-	delete[] vArr;
-	delete[] vnArr;
-	delete[] vtArr;
-	delete[] fvArr;
-	delete[] ftArr;
-	delete[] fnArr;
-	delete[] mtArr;
 
-	delete mtlLoader;
-	mtlLoader=NULL;
-}
+	int counts[3] = { vCount, vtCount, vnCount };
+	int cornerCount = chunk->fv.size();
+	for (int a = 0; a < 3; a++) {
+		for (int c = 0; c < cornerCount; c++) {
+			if (faces[a][c] < 0 || faces[a][c] >= counts[a]) faces[a][c] = -1;
+		}
+	}
 
+	int* materials = &mtArr[0] + chunk->faceBase;
+	for (uint f = 0; f < chunk->mt.size(); f++)
+		materials[f] = chunk->mt[f] >= 0 ? chunk->materialIds[chunk->mt[f]] : firstMaterial;
+}
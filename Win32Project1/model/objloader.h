@@ -9,27 +9,33 @@
 #define OBJLOADER_H_
 
 #include <string>
+#include <vector>
 #include "mtlloader.h"
 
+// Bytes of obj text one parse job reads, cut at line ends
+#define OBJ_CHUNK_SIZE 65536
+
+struct ObjChunk;
+
+// Parses a mapped obj file in chunks across job workers into flat arrays,
+//   polygons are fanned into triangles and negative indices resolved
 class ObjLoader {
 private:
 	const char* objFilePath;
 	const char* mtlFilePath;
-	int vtNumber;
-	int vtCount,vnCount;
 
-	void readObjInfo();
 	void readObjFile();
-
+	void parseChunk(ObjChunk* chunk);
+	void mergeChunk(ObjChunk* chunk, int firstMaterial);
 public:
-	int vCount,faceCount;
-	float** vArr;
-	float** vtArr;
-	float** vnArr;
-	int** fvArr;
-	int** fnArr;
-	int** ftArr;
-	std::string* mtArr;
+	int vtNumber;
+	int vCount,vtCount,vnCount,faceCount;
+	std::vector<float> vArr; // 3 per position
+	std::vector<float> vtArr; // vtNumber per texcoord
+	std::vector<float> vnArr; // 3 per normal
+	std::vector<int> fvArr, ftArr, fnArr; // 3 per triangle from 0, -1 if missing or out of range
+	std::vector<int> mtArr; // Per triangle index of mtNames
+	std::vector<std::string> mtNames; // Names after usemtl, empty name before any
 	MtlLoader* mtlLoader;
 
 	ObjLoader(const char* objPath,const char* mtlPath,int vtNum);
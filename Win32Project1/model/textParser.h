@@ -0,0 +1,99 @@
+#ifndef TEXT_PARSER_H_
+#define TEXT_PARSER_H_
+
+#include "../constants/constants.h"
+#include <string>
+
+// Number & token readers over a memory range for the obj & mtl loaders,
+//   each returns where reading stopped, which is p itself if nothing was read
+
+#define PARSE_MANTISSA_MAX 100000000000000ULL // Digits kept exact in a double mantissa
+
+inline bool IsBlank(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* SkipSpaces(const char* p, const char* end) {
+	while (p < end && IsBlank(*p)) p++;
+	return p;
+}
+
+// Start of next line
+inline const char* SkipLine(const char* p, const char* end) {
+	while (p < end && *p != '\n') p++;
+	return p < end ? p + 1 : end;
+}
+
+// Word at p followed by a blank
+inline bool MatchWord(const char* p, const char* end, const char* word) {
+	for (; *word; p++, word++) {
+		if (p >= end || *p != *word) return false;
+	}
+	return p < end && IsBlank(*p);
+}
+
+inline const char* ParseInt(const char* p, const char* end, int& value) {
+	const char* start = p;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+	const char* digits = p;
+	int result = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+		result = result * 10 + (*p - '0');
+	if (p == digits) return start;
+	value = negative ? -result : result;
+	return p;
+}
+
+// Decimal with optional fraction & exponent, digits past what a double holds exactly are dropped
+inline const char* ParseFloat(const char* p, const char* end, float& value) {
+	static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	const char* start = p;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+	u64 mantissa = 0;
+	int exponent = 0;
+	bool digits = false;
+	for (; p < end && *p >= '0' && *p <= '9'; p++, digits = true) {
+		if (mantissa < PARSE_MANTISSA_MAX) mantissa = mantissa * 10 + (*p - '0');
+		else exponent++;
+	}
+	if (p < end && *p == '.') {
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits = true) {
+			if (mantissa < PARSE_MANTISSA_MAX) {
+				mantissa = mantissa * 10 + (*p - '0');
+				exponent--;
+			}
+		}
+	}
+	if (!digits) return start;
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		int power = 0;
+		const char* next = ParseInt(p + 1, end, power);
+		if (next != p + 1) {
+			exponent += power;
+			p = next;
+		}
+	}
+
+	double result = (double)mantissa;
+	if (mantissa != 0) {
+		for (; exponent > 22; exponent -= 22) result *= powers[22];
+		for (; exponent < -22; exponent += 22) result /= powers[22];
+		result = exponent >= 0 ? result * powers[exponent] : result / powers[-exponent];
+	}
+	value = (float)(negative ? -result : result);
+	return p;
+}
+
+// Characters up to next blank or line end
+inline const char* ParseToken(const char* p, const char* end, std::string& token) {
+	const char* start = p;
+	while (p < end && !IsBlank(*p) && *p != '\n') p++;
+	token.assign(start, p - start);
+	return p;
+}
+
+#endif
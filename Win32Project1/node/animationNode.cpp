@@ -53,16 +53,12 @@ void AnimationNode::translateNodeCenterAtWorld(float x, float y, float z) {
 
 void AnimationNode::translateNode(float x, float y, float z) {
 	position.x = x, position.y = y, position.z = z;
+	transformDirty = true;
 
-	recursiveTransform(nodeTransform);
-	boundingBox->update(GetTranslate(nodeTransform));
+	boundingBox->update(GetTranslate(getWorldTransform()));
 	updateNodeObject(objects[0], true, false);
 
-	Node* superior = parent;
-	while (superior) {
-		superior->updateBounding();
-		superior = superior->parent;
-	}
+	updateUpwardNodesBounding();
 }
 
 void AnimationNode::rotateNodeObject(float ax, float ay, float az) {
@@ -0,0 +1,76 @@
+#include "flatTree.h"
+
+FlatTree::FlatTree(Node* root) {
+	this->root = root;
+	bounds = new BoundsArray(64);
+	layoutVersion = Node::layoutVersion - 1;
+	boundsVersion = root->boundsVersion - 1;
+}
+
+FlatTree::~FlatTree() {
+	delete bounds;
+	nodes.clear();
+	skips.clear();
+	parents.clear();
+	leaves.clear();
+	detailLevels.clear();
+	shadowLevels.clear();
+	visibleMasks.clear();
+	insideMasks.clear();
+	visibleLeaves.clear();
+	leafObjects.clear();
+}
+
+void FlatTree::addNode(Node* node, int parent) {
+	int index = (int)nodes.size();
+	nodes.push_back(node);
+	skips.push_back(0);
+	parents.push_back(parent);
+	leaves.push_back(node->objects.size() > 0);
+	detailLevels.push_back(node->detailLevel);
+	shadowLevels.push_back(node->shadowLevel);
+	bounds->add(node->boundingBox);
+	if (node->objects.size() <= 0) {
+		for (uint i = 0; i < node->children.size(); i++)
+			addNode(node->children[i], index);
+	}
+	skips[index] = (int)nodes.size();
+}
+
+void FlatTree::build() {
+	nodes.clear();
+	skips.clear();
+	parents.clear();
+	leaves.clear();
+	detailLevels.clear();
+	shadowLevels.clear();
+	bounds->clear();
+	addNode(root, -1);
+	visibleMasks.resize(nodes.size());
+	insideMasks.resize(nodes.size());
+	leafObjects.resize(nodes.size());
+	layoutVersion = Node::layoutVersion;
+	boundsVersion = root->boundsVersion;
+}
+
+// Copy bounds again, layout unchanged
+void FlatTree::refit() {
+	for (uint i = 0; i < nodes.size(); i++)
+		bounds->set(i, nodes[i]->boundingBox);
+	boundsVersion = root->boundsVersion;
+}
+
+// Called before traversal, rebuild if nodes were attached, detached or changed objects,
+//   refit only if a bounding under this root changed
+void FlatTree::update() {
+	if (layoutVersion != Node::layoutVersion)
+		build();
+	else if (boundsVersion != root->boundsVersion)
+		refit();
+}
+
+int FlatTree::intersectsFrustum(int i, const Frustum* frustum) {
+	vec3 center(bounds->centerX[i], bounds->centerY[i], bounds->centerZ[i]);
+	vec3 extent(bounds->extentX[i], bounds->extentY[i], bounds->extentZ[i]);
+	return BoxIntersectsFrustum(frustum, center, extent, detailLevels[i]);
+}
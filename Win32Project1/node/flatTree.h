@@ -0,0 +1,51 @@
+#ifndef FLAT_TREE_H_
+#define FLAT_TREE_H_
+
+#include "node.h"
+#include "../bounding/boundsArray.h"
+
+// Leaf a traversal found visible, its instances are culled by jobs before it is pushed
+struct VisibleLeaf {
+	int index; // In tree
+	uint mask, inside; // Cameras seeing & containing it
+	VisibleLeaf(int i, uint m, uint in) :index(i), mask(m), inside(in) {}
+};
+
+// Instance a cull job found visible, with cameras seeing it & its detail level
+struct VisibleObject {
+	Object* object;
+	uint mask;
+	int level;
+	VisibleObject(Object* o, uint m, int l) :object(o), mask(m), level(l) {}
+};
+
+// Read-only pre-order copy of a node tree used for culling, 
+//   nodes with objects are leaves as traversal never goes below them
+class FlatTree {
+private:
+	Node* root;
+	uint layoutVersion, boundsVersion;
+private:
+	void addNode(Node* node, int parent);
+public:
+	std::vector<Node*> nodes;
+	std::vector<int> skips; // Index following the subtree of each node
+	std::vector<int> parents;
+	std::vector<bool> leaves; // Node has objects
+	std::vector<int> detailLevels;
+	std::vector<int> shadowLevels;
+	BoundsArray* bounds;
+	std::vector<uint> visibleMasks, insideMasks; // Traversal state, one bit per camera
+	std::vector<VisibleLeaf> visibleLeaves; // Of last traversal in tree order
+	std::vector<std::vector<VisibleObject> > leafObjects; // Per node, visible instances of leaf
+public:
+	FlatTree(Node* root);
+	~FlatTree();
+	void build();
+	void refit();
+	void update();
+	int size() { return (int)nodes.size(); }
+	int intersectsFrustum(int i, const Frustum* frustum);
+};
+
+#endif
@@ -8,6 +8,11 @@ InstanceNode::InstanceNode(const vec3& position):Node(position, vec3(0, 0, 0)) {
 	instance = NULL;
 	isGroup = false;
 	groupBuffer = NULL;
+	objectBounds = NULL;
+	bvh = NULL;
+	needRebuildBvh = true;
+	cullVersion = 0;
+	visibleCaches.clear();
 
 	needCreateDrawcall = false;
 	needUpdateDrawcall = false;
@@ -16,52 +21,53 @@ InstanceNode::InstanceNode(const vec3& position):Node(position, vec3(0, 0, 0)) {
 InstanceNode::~InstanceNode() {
 	if (instance) delete instance; instance = NULL;
 	if (groupBuffer) delete groupBuffer; groupBuffer = NULL;
+	if (objectBounds) delete objectBounds; objectBounds = NULL;
+	if (bvh) delete bvh; bvh = NULL;
+	for (uint i = 0; i < visibleCaches.size(); i++) 
+		if (visibleCaches[i]) delete visibleCaches[i];
+	visibleCaches.clear();
 }
 
 void InstanceNode::addObject(Scene* scene, Object* object) {
 	Node::addObject(scene, object);
-	if (Instance::instanceTable.find(object->mesh) == Instance::instanceTable.end())
-		Instance::instanceTable[object->mesh] = 1;
-	else
-		Instance::instanceTable[object->mesh]++;
-
-	if (object->meshMid) {
-		if (Instance::instanceTable.find(object->meshMid) == Instance::instanceTable.end())
-			Instance::instanceTable[object->meshMid] = 1;
-		else
-			Instance::instanceTable[object->meshMid]++;
-	}
-
-	if (object->meshLow) {
-		if (Instance::instanceTable.find(object->meshLow) == Instance::instanceTable.end())
-			Instance::instanceTable[object->meshLow] = 1;
-		else
-			Instance::instanceTable[object->meshLow]++;
-	}
-
+	needRebuildBvh = true;
+	addToInstanceTable(object);
 	scene->addObject(object);
 }
 
+void InstanceNode::addToInstanceTable(Object* object) {
+	Instance::CountInstance(object->mesh, 1);
+	if (object->meshMid)
+		Instance::CountInstance(object->meshMid, 1);
+	if (object->meshLow)
+		Instance::CountInstance(object->meshLow, 1);
+}
+
 Object* InstanceNode::removeObject(Object* object) {
 	Object* object2Remove = Node::removeObject(object);
 	if (object2Remove) {
-		Instance::instanceTable[object2Remove->mesh]--;
+		needRebuildBvh = true;
+		Instance::CountInstance(object2Remove->mesh, -1);
 		if (object2Remove->meshMid)
-			Instance::instanceTable[object2Remove->meshMid]--;
+			Instance::CountInstance(object2Remove->meshMid, -1);
 		if (object2Remove->meshLow)
-			Instance::instanceTable[object2Remove->meshLow]--;
+			Instance::CountInstance(object2Remove->meshLow, -1);
 	}
 	return object2Remove;
 }
 
 void InstanceNode::addObjects(Scene* scene,Object** objectArray,int count) {
-	for(int i=0;i<count;i++)
-		this->addObject(scene,objectArray[i]);
+	Node::addObjects(scene, objectArray, count);
+	needRebuildBvh = true;
+	for (int i = 0; i < count; i++) {
+		addToInstanceTable(objectArray[i]);
+		scene->addObject(objectArray[i]);
+	}
 }
 
 void InstanceNode::prepareGroup() {
 	if (groupBuffer) return;
-	groupBuffer = new InstanceData(objects[0]->mesh, objects[0], objects.size());
+	groupBuffer = new InstanceData(objects[0]->mesh, objects[0]->handle, objects.size());
 	for (uint i = 0; i < objects.size(); ++i)
 		groupBuffer->addInstance(objects[i]);
 }
@@ -73,6 +79,38 @@ void InstanceNode::releaseGroup() {
 	}
 }
 
+// Bvh over objects' world boundings, rebuilt after objects added or removed 
+//   and refitted after any of them moved
+BVH* InstanceNode::getBvh() {
+	if (!bvh) {
+		bvh = new BVH();
+		objectBounds = new BoundsArray(objects.size());
+		needRebuildBvh = true;
+	}
+	if (needUpdateObjectsBounds || needRebuildBvh) {
+		objectBounds->clear();
+		objectBounds->reserve(objects.size());
+		for (uint i = 0; i < objects.size(); ++i)
+			objectBounds->add(objects[i]->bounding);
+		if (needRebuildBvh) 
+			bvh->build(objectBounds);
+		else 
+			bvh->refit(objectBounds);
+		needUpdateObjectsBounds = false;
+		needRebuildBvh = false;
+		cullVersion++;
+	}
+	return bvh;
+}
+
+VisibleCache* InstanceNode::getVisibleCache(int queueType) {
+	if (queueType >= (int)visibleCaches.size()) 
+		visibleCaches.resize(queueType + 1, NULL);
+	if (!visibleCaches[queueType]) 
+		visibleCaches[queueType] = new VisibleCache();
+	return visibleCaches[queueType];
+}
+
 void InstanceNode::prepareDrawcall() {
 	needCreateDrawcall = false;
 }
@@ -11,21 +11,42 @@
 #include "node.h"
 #include "../instance/instanceData.h"
 #include "../instance/instance.h"
+#include "../bounding/bvh.h"
+
+// Objects one camera saw through its frustum grown by a margin, 
+//   reused while the camera's frustum stays inside the grown one
+struct VisibleCache {
+	Frustum frustum;
+	std::vector<int> objects;
+	uint version; // Cull version of node when cached
+	bool valid;
+	VisibleCache() { version = 0; valid = false; }
+};
 
 class InstanceNode: public Node {
 private:
 	Instance* instance;
 	bool isGroup;
+	BoundsArray* objectBounds;
+	BVH* bvh;
+	bool needRebuildBvh;
+	uint cullVersion; // Changes when bvh is rebuilt or refitted
+	std::vector<VisibleCache*> visibleCaches; // By queue type
+private:
+	void addToInstanceTable(Object* object);
 public:
 	InstanceData* groupBuffer;
 public:
 	InstanceNode(const vec3& position);
 	virtual ~InstanceNode();
-	void addObjects(Scene* scene, Object** objectArray, int count);
+	virtual void addObjects(Scene* scene, Object** objectArray, int count);
 	void prepareGroup();
 	void releaseGroup();
 	void setGroup(bool group) { isGroup = group; };
 	bool getGroup() { return isGroup; };
+	BVH* getBvh();
+	uint getCullVersion() { return cullVersion; }
+	VisibleCache* getVisibleCache(int queueType);
 	virtual void addObject(Scene* scene, Object* object);
 	virtual Object* removeObject(Object* object);
 	virtual void prepareDrawcall();
@@ -2,11 +2,22 @@
 #include "../util/util.h"
 #include "../instance/instance.h"
 #include "../scene/scene.h"
+#include "../util/jobSystem.h"
+#include <algorithm>
 
 std::vector<Node*> Node::nodesToUpdate;
-std::vector<Node*> Node::nodesToRemove;
+std::vector<uint> Node::nodesToRemove;
+SlotMap<Node*> Node::store;
+uint Node::layoutVersion = 0;
+
+// NULL if node was deleted
+Node* Node::fromHandle(uint handle) {
+	Node* node = NULL;
+	return store.get(handle, node) ? node : NULL;
+}
 
 Node::Node(const vec3& position,const vec3& size) {
+	handle = store.add(this);
 	this->position = position;
 	this->size = size;
 	boundingBox=new AABB(position,size.x,size.y,size.z);
@@ -17,6 +28,14 @@ Node::Node(const vec3& position,const vec3& size) {
 	needCreateDrawcall = false;
 	needUpdateNormal = false;
 	needUpdateNode = false;
+	needUpdateObjectsBounds = false;
+	needUpdateBounds = false;
+	deferredFrames = 0;
+	nodeTransform.LoadIdentity();
+	transformDirty = true;
+	transformVersion = 0;
+	parentVersion = 0;
+	boundsVersion = 0;
 
 	parent=NULL;
 	children.clear();
@@ -43,6 +62,14 @@ Node::~Node() {
 
 	nodeBBs.clear();
 	clearChildren();
+	layoutVersion++;
+	store.remove(handle);
+
+	// Update may have been put off by budget
+	if (nodesToUpdate.size() > 0) {
+		std::vector<Node*>::iterator it = std::find(nodesToUpdate.begin(), nodesToUpdate.end(), this);
+		if (it != nodesToUpdate.end()) nodesToUpdate.erase(it);
+	}
 }
 
 void Node::clearChildren() {
@@ -64,12 +91,30 @@ bool Node::checkInFrustum(Frustum* frustum) {
 	return true;
 }
 
+// Return FRUSTUM_OUTSIDE, FRUSTUM_INTERSECT or FRUSTUM_INSIDE
+int Node::intersectsCamera(Camera* camera) {
+	if (boundingBox)
+		return boundingBox->intersectsFrustum(camera->frustum, detailLevel);
+	return FRUSTUM_INTERSECT;
+}
+
 // Update Object's bounding box from local to world
 void Node::updateObjectBoundingInNode(Object* object) {
+	if (object->bounding)
+		updateObjectBoundingInNode(object, getWorldTransform());
+}
+
+void Node::updateObjectBoundingInNode(Object* object, const mat4& nodeMat) {
+	if (object->bounding) {
+		refreshObjectBounding(object, nodeMat);
+		needUpdateObjectsBounds = true;
+	}
+}
+
+// Only writes object, safe for objects of one node on several threads
+void Node::refreshObjectBounding(Object* object, const mat4& nodeMat) {
 	BoundingBox* objectBB = object->bounding;
 	if (objectBB) {
-		mat4 nodeMat; nodeMat.LoadIdentity();
-		recursiveTransform(nodeMat);
 		vec4 localBB4(object->localBoundPosition.x, object->localBoundPosition.y, object->localBoundPosition.z, 1.0);
 		vec4 bb4 = nodeMat * localBB4;
 		float invw = 1.0 / bb4.w;
@@ -78,66 +123,100 @@ void Node::updateObjectBoundingInNode(Object* object) {
 }
 
 void Node::addObject(Scene* scene, Object* object) {
+	if (objects.size() == 0) layoutVersion++; // Node becomes a leaf in traversal
+	object->nodeIndex = objects.size();
 	objects.push_back(object);
+	needUpdateObjectsBounds = true;
 	object->caculateLocalAABB(false, false);
+	object->boundsDirty = false;
 	BoundingBox* objectBB = object->bounding;
+	objectsBBs.push_back(objectBB);
 	if (objectBB) {
 		updateObjectBoundingInNode(object);
-		objectsBBs.push_back(objectBB);
 		boundingBox->merge(objectsBBs);
 
-		Node* superior = parent;
-		while (superior) {
-			superior->updateBounding();
-			superior = superior->parent;
-		}
+		updateUpwardNodesBounding();
 	}
 	needCreateDrawcall = true;
 	pushToUpdate();
 }
 
+// Each object only writes its own bounding, so ranges of them run as jobs
+static void CaculateLocalAABBs(Object** objectArray, int count) {
+	std::function<void(uint, uint)> caculateRange = [objectArray](uint begin, uint end) {
+		for (uint i = begin; i < end; i++)
+			objectArray[i]->caculateLocalAABB(false, false);
+	};
+	if (JobSystem::jobSystem && count >= 256) 
+		JobSystem::jobSystem->parallelFor(count, 64, caculateRange);
+	else 
+		caculateRange(0, count);
+}
+
+// Add objects in one go, bounding is merged and propagated upward once 
+//   instead of once per object
+void Node::addObjects(Scene* scene, Object** objectArray, int count) {
+	if (count <= 0) return;
+	if (objects.size() == 0) layoutVersion++;
+	objects.reserve(objects.size() + count);
+	objectsBBs.reserve(objectsBBs.size() + count);
+
+	CaculateLocalAABBs(objectArray, count);
+	const mat4& nodeMat = getWorldTransform();
+	for (int i = 0; i < count; i++) {
+		Object* object = objectArray[i];
+		object->nodeIndex = objects.size();
+		object->boundsDirty = false;
+		objects.push_back(object);
+		objectsBBs.push_back(object->bounding);
+		updateObjectBoundingInNode(object, nodeMat);
+	}
+	needUpdateObjectsBounds = true;
+	boundingBox->merge(objectsBBs);
+	updateUpwardNodesBounding();
+
+	needCreateDrawcall = true;
+	pushToUpdate();
+}
+
+// Swap with the last object, order of objects is not kept
 Object* Node::removeObject(Object* object) {
-	std::vector<Object*>::iterator it;
-	std::vector<BoundingBox*>::iterator itbb;
-	for (it = objects.begin(); it != objects.end(); ++it) {
-		if ((*it) == object) {
-			objects.erase(it);
-			for (itbb = objectsBBs.begin(); itbb != objectsBBs.end(); ++itbb) {
-				if ((*itbb) == object->bounding) {
-					objectsBBs.erase(itbb);
-					break;
-				}
-			}
-			boundingBox->merge(objectsBBs);
+	int index = object->nodeIndex;
+	if (index < 0 || index >= (int)objects.size() || objects[index] != object) 
+		return NULL;
+
+	int last = objects.size() - 1;
+	objects[index] = objects[last];
+	objectsBBs[index] = objectsBBs[last];
+	objects[index]->nodeIndex = index;
+	objects.pop_back();
+	objectsBBs.pop_back();
+	object->nodeIndex = -1;
+	if (objects.size() == 0) layoutVersion++;
+	needUpdateObjectsBounds = true;
+	boundingBox->merge(objectsBBs);
 
-			Node* superior = parent;
-			while (superior) {
-				superior->updateBounding();
-				superior = superior->parent;
-			}
+	updateUpwardNodesBounding();
 
-			needCreateDrawcall = true;
-			pushToUpdate();
+	needCreateDrawcall = true;
+	pushToUpdate();
 
-			return object;
-		}
-	}
-	return NULL;
+	return object;
 }
 
 // Update the Node's bounding with objects maybe its children's
 void Node::updateBaseNodeBounding() {
-	for(unsigned int i=0;i<objects.size();i++)
-		updateObjectBoundingInNode(objects[i]);
 	if (objects.size()>0) {
-		if (objectsBBs.size() > 0) 
-			boundingBox->merge(objectsBBs);
-		else if (objectsBBs.size() <= 0) { // Base Node and without object boundings
-			mat4 nodeTransform; nodeTransform.LoadIdentity();
-			recursiveTransform(nodeTransform);
-			boundingBox->update(GetTranslate(nodeTransform));
-			//boundingBox->update(nodeTransform * vec4(0, 0, 0, 1));
+		const mat4& nodeMat = getWorldTransform();
+		bool hasBounds = false;
+		for (unsigned int i = 0; i < objects.size(); i++) {
+			updateObjectBoundingInNode(objects[i], nodeMat);
+			if (objectsBBs[i]) hasBounds = true;
 		}
+		if (hasBounds) 
+			boundingBox->merge(objectsBBs);
+		else // Base Node and without object boundings
+			boundingBox->update(GetTranslate(nodeMat));
 	}
 
 	for(unsigned int n=0;n<children.size();n++)
@@ -154,7 +233,7 @@ void Node::updateSelfAndDownwardNodesBounding() {
 		if(childAABB&&(childAABB->sizex>0||childAABB->sizey>0||childAABB->sizez>0))
 			nodeBBs.push_back(child->boundingBox);
 	}
-	if (nodeBBs.size()>0)
+	if (nodeBBs.size()>0 && type != TYPE_CELL)
 		boundingBox->merge(nodeBBs);
 }
 
@@ -165,6 +244,7 @@ void Node::moveBaseObjectsBounding(float dx, float dy, float dz) {
 		BoundingBox* objectBB = objects[i]->bounding;
 		if (objectBB) objectBB->update(objectBB->position + offset);
 	}
+	if (objects.size() > 0) needUpdateObjectsBounds = true;
 	for (uint n = 0; n < children.size(); n++)
 		children[n]->moveBaseObjectsBounding(dx, dy, dz);
 }
@@ -179,8 +259,9 @@ void Node::moveSelfAndDownwardNodesBounding(float dx, float dy, float dz) {
 		children[n]->moveSelfAndDownwardNodesBounding(dx, dy, dz);
 }
 
-// Update current Node's bounding
+// Update current Node's bounding, partition cells keep their loose bounding
 void Node::updateBounding() {
+	if (type == TYPE_CELL) return;
 	nodeBBs.clear();
 	for (unsigned int n = 0; n<children.size(); n++) {
 		Node* child = children[n];
@@ -192,6 +273,23 @@ void Node::updateBounding() {
 		boundingBox->merge(nodeBBs);
 }
 
+// Update bounding of superior nodes up to the root, 
+//   or up to a partition cell which relocates the moved content instead
+void Node::updateUpwardNodesBounding() {
+	getAncestor()->boundsVersion++;
+	Node* current = this;
+	Node* superior = parent;
+	while (superior) {
+		if (superior->type == TYPE_CELL) {
+			((QuadCell*)superior)->tree->pushToRelocate(current);
+			return;
+		}
+		superior->updateBounding();
+		current = superior;
+		superior = superior->parent;
+	}
+}
+
 // Update Node's drawcall & its children's & children's children...
 void Node::updateSelfAndDownwardNodesDrawcall(bool updateNormal) {
 	if (objects.size() > 0) {
@@ -218,17 +316,19 @@ Node* Node::getAncestor() {
 void Node::attachChild(Node* child) {
 	children.push_back(child);
 	child->parent=this;
+	child->transformDirty = true;
+	layoutVersion++;
+	getAncestor()->boundsVersion++;
 
 	child->updateBaseNodeBounding();
 	child->updateSelfAndDownwardNodesBounding();
 
-	Node* superior = this;
-	while (superior) {
-		superior->updateBounding();
-		superior = superior->parent;
+	if (type != TYPE_CELL) {
+		updateBounding();
+		updateUpwardNodesBounding();
 	}
 
-	updateSelfAndDownwardNodesDrawcall(false);
+	child->updateSelfAndDownwardNodesDrawcall(false);
 }
 
 Node* Node::detachChild(Node* child) {
@@ -236,22 +336,24 @@ Node* Node::detachChild(Node* child) {
 	for(it=children.begin();it!=children.end();++it) {
 		if((*it)==child) {
 			child->parent=NULL;
+			child->transformDirty = true;
 			children.erase(it);
+			layoutVersion++;
+			getAncestor()->boundsVersion++;
 
-			Node* superior = this;
-			while (superior) {
-				superior->updateBounding();
-				superior = superior->parent;
+			if (type != TYPE_CELL) {
+				updateBounding();
+				updateUpwardNodesBounding();
 			}
 
 			if (child->type == TYPE_INSTANCE) {
 				for (uint i = 0; i < child->objects.size(); i++) {
 					Object* object = child->objects[i];
-					Instance::instanceTable[object->mesh]--;
+					Instance::CountInstance(object->mesh, -1);
 					if (object->meshMid)
-						Instance::instanceTable[object->meshMid]--;
+						Instance::CountInstance(object->meshMid, -1);
 					if (object->meshLow)
-						Instance::instanceTable[object->meshLow]--;
+						Instance::CountInstance(object->meshLow, -1);
 				}
 			}
 
@@ -269,6 +371,7 @@ void Node::translateNode(float x, float y, float z) {
 	position.x = x;
 	position.y = y;
 	position.z = z;
+	transformDirty = true;
 
 	// Inefficient
 	//updateBaseNodeBounding();
@@ -276,34 +379,34 @@ void Node::translateNode(float x, float y, float z) {
 	moveBaseObjectsBounding(dx, dy, dz);
 	moveSelfAndDownwardNodesBounding(dx, dy, dz);
 
-	Node* superior = parent;
-	while (superior) {
-		superior->updateBounding();
-		superior = superior->parent;
-	}
+	updateUpwardNodesBounding();
 
 	updateSelfAndDownwardNodesDrawcall(false);
 }
 
+// Object bounding, node bounding & superior ones are updated with the node,
+//   so moving many objects of a node merges its bounding once
 void Node::translateNodeObject(int i, float x, float y, float z) {
 	Object* object = objects[i];
 	object->setPosition(x, y, z);
-	object->caculateLocalAABB(false, false);
-
-	updateObjectBoundingInNode(object);
-	boundingBox->merge(objectsBBs);
-	Node* superior = parent;
-	while (superior) {
-		superior->updateBounding();
-		superior = superior->parent;
-	}
+	object->boundsDirty = true;
+	needUpdateBounds = true;
 	needUpdateNormal = false;
 	needUpdateDrawcall = true;
 	pushToUpdate();
 }
 
+// Bounding of an object moved earlier this frame is needed now
+void Node::updateObjectBounds(Object* object) {
+	if (!object->boundsDirty) return;
+	object->caculateLocalAABB(false, false);
+	refreshObjectBounding(object, getWorldTransform());
+	object->boundsDirty = false;
+}
+
 void Node::translateNodeObjectCenterAtWorld(int i, float x, float y, float z) {
 	Object* object = objects[i];
+	updateObjectBounds(object);
 	vec3 worldCenter = object->bounding->position;
 	vec3 offset = vec3(x, y, z) - worldCenter;
 	vec3 localPosition = object->position;
@@ -313,15 +416,8 @@ void Node::translateNodeObjectCenterAtWorld(int i, float x, float y, float z) {
 void Node::rotateNodeObject(int i, float ax, float ay, float az) {
 	Object* object = objects[i];
 	object->setRotation(ax,ay,az);
-	object->caculateLocalAABB(false, false);
-
-	updateObjectBoundingInNode(object);
-	boundingBox->merge(objectsBBs);
-	Node* superior = parent;
-	while (superior) {
-		superior->updateBounding();
-		superior = superior->parent;
-	}
+	object->boundsDirty = true;
+	needUpdateBounds = true;
 	needUpdateNormal = true;
 	needUpdateDrawcall = true;
 	pushToUpdate();
@@ -330,15 +426,8 @@ void Node::rotateNodeObject(int i, float ax, float ay, float az) {
 void Node::scaleNodeObject(int i, float sx, float sy, float sz) {
 	Object* object = objects[i];
 	object->setSize(sx, sy, sz);
-	object->caculateLocalAABB(false, false);
-
-	updateObjectBoundingInNode(object);
-	boundingBox->merge(objectsBBs);
-	Node* superior = parent;
-	while (superior) {
-		superior->updateBounding();
-		superior = superior->parent;
-	}
+	object->boundsDirty = true;
+	needUpdateBounds = true;
 	if (sx == sy && sy == sz) needUpdateNormal = false;
 	else needUpdateNormal = true;
 	needUpdateDrawcall = true;
@@ -369,48 +458,61 @@ void Node::updateNodeObject(Object* object, bool translate, bool rotate) {
 		object->transforms[2] = object->transformMatrix.entries[14];
 		object->transforms[3] = object->size.x;
 	}
-	if (object->transformsFull) {
-		if (translate) {
-			object->transformsFull[0] = (object->transforms[0]);
-			object->transformsFull[1] = (object->transforms[1]);
-			object->transformsFull[2] = (object->transforms[2]);
-			object->transformsFull[3] = (object->transforms[3]);
-		}
-		if (rotate) {
-			object->transformsFull[4] = (object->rotateQuat.x);
-			object->transformsFull[5] = (object->rotateQuat.y);
-			object->transformsFull[6] = (object->rotateQuat.z);
-			object->transformsFull[7] = (object->rotateQuat.w);
-		}
-		if (translate || rotate) {
-			object->transformsFull[8] = (object->boundInfo.x);
-			object->transformsFull[9] = (object->boundInfo.y);
-			object->transformsFull[10] = (object->boundInfo.z);
-			object->transformsFull[11] = (object->boundInfo.w);
-		}
-	}
+	if (translate || rotate) object->updateRecord();
 }
 
 void Node::updateNode() {
-	if (type != TYPE_ANIMATE) {
-		recursiveTransform(nodeTransform);
-		for (unsigned int i = 0; i < objects.size(); i++) {
-			Object* object = objects[i];
-			updateNodeObject(object, true, true);
+	if (type != TYPE_ANIMATE) getWorldTransform();
+	updateNodeObjects(0, objects.size());
+	finishUpdate();
+}
+
+// Bounds & transforms of objects [begin, end), ranges of one node may run on several threads
+//   once getWorldTransform is done, so only the cached nodeTransform is read here
+void Node::updateNodeObjects(int begin, int end) {
+	if (type == TYPE_ANIMATE) return;
+	for (int i = begin; i < end; i++) {
+		Object* object = objects[i];
+		if (object->boundsDirty) {
+			object->caculateLocalAABB(false, false);
+			refreshObjectBounding(object, nodeTransform);
+			object->boundsDirty = false;
 		}
+		updateNodeObject(object, true, true);
+	}
+}
+
+// After all objects updated, merges moved bounds and passes them upward
+void Node::finishUpdate() {
+	if (needUpdateBounds) {
+		needUpdateObjectsBounds = true;
+		boundingBox->merge(objectsBBs);
+		updateUpwardNodesBounding();
+		needUpdateBounds = false;
 	}
 	needUpdateNode = false;
+	deferredFrames = 0;
 }
 
 void Node::pushToRemove() {
-	Node::nodesToRemove.push_back(this);
+	Node::nodesToRemove.push_back(handle);
 }
 
-void Node::recursiveTransform(mat4& finalNodeMatrix) {
-	if(parent) {
-		mat4 parentTransform;
-		parent->recursiveTransform(parentTransform);
-		finalNodeMatrix=parentTransform*translate(position.x,position.y,position.z);
-	} else
-		finalNodeMatrix=translate(position.x,position.y,position.z);
+// Recompute cached world transform only if this node or any superior changed,
+//   a clean chain costs a version compare per level and no matrix multiply
+const mat4& Node::getWorldTransform() {
+	if (parent) {
+		const mat4& parentTransform = parent->getWorldTransform();
+		if (transformDirty || parentVersion != parent->transformVersion) {
+			nodeTransform = parentTransform * translate(position.x, position.y, position.z);
+			parentVersion = parent->transformVersion;
+			transformVersion++;
+			transformDirty = false;
+		}
+	} else if (transformDirty) {
+		nodeTransform = translate(position.x, position.y, position.z);
+		transformVersion++;
+		transformDirty = false;
+	}
+	return nodeTransform;
 }
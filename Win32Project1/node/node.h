@@ -14,6 +14,7 @@
 #define TYPE_WATER 3
 #define TYPE_INSTANCE 4
 #define TYPE_ANIMATE 5
+#define TYPE_CELL 6
 
 #include "../bounding/AABB.h"
 #include "../object/object.h"
@@ -24,24 +25,34 @@ class Scene;
 class Node {
 public:
 	static std::vector<Node*> nodesToUpdate;
-	static std::vector<Node*> nodesToRemove;
+	static std::vector<uint> nodesToRemove; // Handles, a node deleted with its parent is skipped
+	static SlotMap<Node*> store; // Every living node by handle
+	static Node* fromHandle(uint handle);
+	static uint layoutVersion; // Changed when any tree structure changes
 private:
 	void updateObjectBoundingInNode(Object* object);
+	void updateObjectBoundingInNode(Object* object, const mat4& nodeMat);
+	void refreshObjectBounding(Object* object, const mat4& nodeMat);
 	void updateBaseNodeBounding();
 	void updateSelfAndDownwardNodesBounding();
 	void moveBaseObjectsBounding(float dx,float dy,float dz);
 	void moveSelfAndDownwardNodesBounding(float dx,float dy,float dz);
 	void updateSelfAndDownwardNodesDrawcall(bool updateNormal);
 public:
+	uint handle;
 	vec3 position;
 	vec3 size;
 	int type;
-	int shadowLevel, detailLevel;
+	int shadowLevel, detailLevel; // detailLevel 0: no culling, 1: corners, 2+: exact
 	BoundingBox* boundingBox;
-	mat4 nodeTransform;
+	mat4 nodeTransform; // Cached world transform, resolved by getWorldTransform, jobs only read it
+	bool transformDirty; // Local position changed or attached to another parent
+	uint transformVersion; // Increased each time nodeTransform is recomputed
+	uint parentVersion; // Parent's transformVersion when nodeTransform was computed
+	uint boundsVersion; // Kept by roots, changed when any bounding below the root changes
 
 	std::vector<Object*> objects;
-	std::vector<BoundingBox*> objectsBBs;
+	std::vector<BoundingBox*> objectsBBs; // Same order as objects, NULL if object has no bounding
 
 	Node* parent;
 	std::vector<Node*> children;
@@ -52,20 +63,31 @@ public:
 	bool needUpdateDrawcall;
 	bool needCreateDrawcall;
 	bool needUpdateNode;
+	bool needUpdateObjectsBounds;
+	bool needUpdateBounds; // Some objects have boundsDirty
+	uint deferredFrames; // Frames its update was put off by budget
 
 	Node(const vec3& position,const vec3& size);
 	virtual ~Node();
+	static void* operator new(size_t size) { return PoolAlloc(size); }
+	static void operator delete(void* p, size_t size) { PoolFree(p, size); }
 	bool checkInCamera(Camera* camera);
 	bool checkInFrustum(Frustum* frustum);
+	int intersectsCamera(Camera* camera);
 	virtual void prepareDrawcall() = 0;
 	virtual void updateRenderData() = 0;
 	virtual void updateDrawcall() = 0;
 	void updateNode();
+	void updateNodeObjects(int begin, int end);
+	void finishUpdate();
 	void updateNodeObject(Object* object, bool translate, bool rotate);
+	void updateObjectBounds(Object* object);
 	void pushToUpdate();
 
 	void updateBounding();
+	void updateUpwardNodesBounding();
 	virtual void addObject(Scene* scene, Object* object);
+	virtual void addObjects(Scene* scene, Object** objectArray, int count);
 	virtual Object* removeObject(Object* object);
 	void attachChild(Node* child);
 	Node* detachChild(Node* child);
@@ -77,7 +99,7 @@ public:
 	Node* getAncestor();
 	void clearChildren();
 	void pushToRemove();
-	void recursiveTransform(mat4& finalNodeMatrix);
+	const mat4& getWorldTransform(); // Writes caches of this node & superiors, serial code only
 };
 
 #endif /* NODE_H_ */
@@ -16,11 +16,6 @@ StaticNode::~StaticNode() {
 	batch=NULL;
 }
 
-void StaticNode::addObjects(Scene* scene,Object** objectArray,int count) {
-	for(int i=0;i<count;i++)
-		addObject(scene,objectArray[i]);
-}
-
 void StaticNode::createBatch() {
 	if (batch) delete batch;
 	batch = new Batch();
@@ -22,7 +22,6 @@ public:
 
 	StaticNode(const vec3& position);
 	virtual ~StaticNode();
-	void addObjects(Scene* scene,Object** objectArray,int count);
 	virtual void prepareDrawcall();
 	virtual void updateRenderData();
 	virtual void updateDrawcall();
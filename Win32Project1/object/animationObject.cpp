@@ -11,8 +11,7 @@ AnimationObject::AnimationObject(Animation* anim):Object() {
 	setEnd(true);
 	setDefaultAnim(0);
 	time = 0.0, curFrame = 0.0;
-	transforms = (float*)malloc(4 * sizeof(float));
-	transformsFull = (buff*)malloc(16 * sizeof(buff));
+	createTransforms();
 }
 
 AnimationObject::AnimationObject(const AnimationObject& rhs) {
@@ -49,20 +48,14 @@ AnimationObject::AnimationObject(const AnimationObject& rhs) {
 	if (rhs.billboard)
 		setBillboard(rhs.billboard->data[0], rhs.billboard->data[1], rhs.billboard->material);
 	if (rhs.transforms) {
-		transforms = (float*)malloc(4 * sizeof(float));
+		createTransforms();
 		memcpy(transforms, rhs.transforms, 4 * sizeof(float));
-	}
-	if (rhs.transformsFull) {
-		transformsFull = (buff*)malloc(16 * sizeof(buff));
-		memcpy(transformsFull, rhs.transformsFull, 16 * sizeof(buff));
+		updateRecord();
 	}
 }
 
 AnimationObject::~AnimationObject() {
-	if (transforms) free(transforms);
-	transforms = NULL;
-	if (transformsFull) free(transformsFull);
-	transformsFull = NULL;
+	releaseTransforms();
 }
 
 AnimationObject* AnimationObject::clone() {
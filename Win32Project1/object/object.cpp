@@ -1,8 +1,18 @@
 #include "object.h"
 #include <stdlib.h>
 #include "../constants/constants.h"
+#include "../instance/instanceBuffer.h"
+
+SlotMap<Object*> Object::store;
+
+// NULL if object was deleted
+Object* Object::fromHandle(uint handle) {
+	Object* object = NULL;
+	return store.get(handle, object) ? object : NULL;
+}
 
 Object::Object() {
+	handle = store.add(this);
 	position = vec3(0, 0, 0);
 	size = vec3(1.0, 1.0, 1.0);
 	localTransformMatrix.LoadIdentity();
@@ -24,24 +34,69 @@ Object::Object() {
 	billboard = NULL;
 	genShadow = true;
 	detailLevel = 2;
+	nodeIndex = -1;
+	boundsDirty = false;
+	lodLevel = 0;
 
 	transforms = NULL;
-	transformsFull = NULL;
+	record = NULL;
+	instanceSlot = -1;
 	rotateQuat = vec4(0.0, 0.0, 0.0, 1.0);
 	boundInfo = vec4(0.0, 0.0, 0.0, 0.0);
 }
 
 Object::Object(const Object& rhs) {
-
+	handle = store.add(this);
+	nodeIndex = -1;
+	boundsDirty = false;
+	lodLevel = 0;
+	instanceSlot = -1;
 }
 
 Object::~Object() {
+	store.remove(handle);
 	if (bounding) delete bounding;
 	bounding = NULL;
 	if (billboard) delete billboard;
 	billboard = NULL;
 }
 
+void Object::createTransforms() {
+	if (transforms) return;
+	if (InstanceBuffer::instanceBuffer) 
+		instanceSlot = InstanceBuffer::instanceBuffer->add();
+	if (instanceSlot >= 0) {
+		transforms = (float*)PoolAlloc(TRANSFORM_SIZE);
+		record = InstanceBuffer::instanceBuffer->get(instanceSlot);
+	} else {
+		transforms = (float*)PoolAlloc(TRANSFORM_RECORD_SIZE);
+		record = (InstanceRecord*)(transforms + 4);
+	}
+	memset(transforms, 0, TRANSFORM_SIZE);
+	memset(record, 0, sizeof(InstanceRecord));
+}
+
+void Object::releaseTransforms() {
+	if (instanceSlot >= 0) {
+		if (transforms) PoolFree(transforms, TRANSFORM_SIZE);
+		if (InstanceBuffer::instanceBuffer) 
+			InstanceBuffer::instanceBuffer->remove(instanceSlot);
+	} else if (transforms) 
+		PoolFree(transforms, TRANSFORM_RECORD_SIZE);
+	instanceSlot = -1;
+	transforms = NULL;
+	record = NULL;
+}
+
+// Pack transforms into record, its block is uploaded again
+void Object::updateRecord() {
+	if (!record) return;
+	PackInstance(record, transforms, rotateQuat, boundInfo);
+	if (billboard) PackBillboard(record, billboard->data);
+	if (instanceSlot >= 0 && InstanceBuffer::instanceBuffer) 
+		InstanceBuffer::instanceBuffer->markDirty(instanceSlot);
+}
+
 void Object::caculateLocalAABB(bool looseWidth, bool looseAll) {
 	if (!mesh) return; // caculate AABB by yourself
 	int vertexCount = mesh->vertexCount;
@@ -106,4 +161,5 @@ bool Object::checkInCamera(Camera* camera) {
 void Object::setBillboard(float sx, float sy, int mid) {
 	if (billboard) delete billboard;
 	billboard = new Billboard(sx, sy, mid);
+	updateRecord();
 }
\ No newline at end of file
@@ -12,9 +12,21 @@
 #include "../material/materialManager.h"
 #include "../billboard/billboard.h"
 #include "../bounding/aabb.h"
+#include "../util/slotMap.h"
+#include "../util/pool.h"
+#include "../instance/instanceRecord.h"
+
+// transforms is pooled, record is the object's slot in instance buffer,
+//   without instance buffer both share one pooled block
+#define TRANSFORM_SIZE (4 * sizeof(float))
+#define TRANSFORM_RECORD_SIZE (4 * sizeof(float) + sizeof(InstanceRecord))
 
 class Object {
 public:
+	static SlotMap<Object*> store; // Every living object by handle
+	static Object* fromHandle(uint handle);
+public:
+	uint handle;
 	vec3 position;
 	vec3 size;
 	mat4 translateMat, rotateMat, scaleMat;
@@ -28,15 +40,24 @@ public:
 	vec4 rotateQuat;
 	vec4 boundInfo;
 	float* transforms;
-	buff* transformsFull;
+	InstanceRecord* record; // Packed transforms, rotateQuat & boundInfo
+	int instanceSlot; // Slot of record in instance buffer, -1 if pooled
 	BoundingBox* bounding;
 	vec3 localBoundPosition;
 	bool genShadow;
 	int detailLevel;
+	int nodeIndex; // Index in its node's objects, -1 if not in a node
+	bool boundsDirty; // Moved in its node, bounding is recomputed when node updates
+	int lodLevel; // Detail level it was last drawn with, 0: mesh, 1: meshMid, 2: meshLow
 
 	Object();
 	Object(const Object& rhs);
 	virtual ~Object();
+	static void* operator new(size_t size) { return PoolAlloc(size); }
+	static void operator delete(void* p, size_t size) { PoolFree(p, size); }
+	void createTransforms();
+	void releaseTransforms();
+	void updateRecord();
 	virtual Object* clone()=0;
 	virtual void caculateLocalAABB(bool looseWidth,bool looseAll);
 	void updateLocalMatrices();
@@ -7,8 +7,7 @@ StaticObject::StaticObject(Mesh* mesh) :Object() {
 	this->meshLow = mesh;
 	anglex = 0; angley = 0; anglez = 0;
 
-	transforms = (float*)malloc(4 * sizeof(float));
-	transformsFull = (buff*)malloc(16 * sizeof(buff));
+	createTransforms();
 }
 
 StaticObject::StaticObject(Mesh* mesh, Mesh* meshMid, Mesh* meshLow) :Object() {
@@ -17,8 +16,7 @@ StaticObject::StaticObject(Mesh* mesh, Mesh* meshMid, Mesh* meshLow) :Object() {
 	this->meshLow = meshLow;
 	anglex = 0; angley = 0; anglez = 0;
 
-	transforms = (float*)malloc(4 * sizeof(float));
-	transformsFull = (buff*)malloc(16 * sizeof(buff));
+	createTransforms();
 }
 
 StaticObject::StaticObject(const StaticObject& rhs) {
@@ -50,20 +48,14 @@ StaticObject::StaticObject(const StaticObject& rhs) {
 	if (rhs.billboard)
 		setBillboard(rhs.billboard->data[0], rhs.billboard->data[1], rhs.billboard->material);
 	if (rhs.transforms) {
-		transforms = (float*)malloc(4 * sizeof(float));
+		createTransforms();
 		memcpy(transforms, rhs.transforms, 4 * sizeof(float));
-	}
-	if (rhs.transformsFull) {
-		transformsFull = (buff*)malloc(16 * sizeof(buff));
-		memcpy(transformsFull, rhs.transformsFull, 16 * sizeof(buff));
+		updateRecord();
 	}
 }
 
 StaticObject::~StaticObject() {
-	if (transforms) free(transforms);
-	transforms = NULL;
-	if (transformsFull) free(transformsFull);
-	transformsFull = NULL;
+	releaseTransforms();
 }
 
 StaticObject* StaticObject::clone() {
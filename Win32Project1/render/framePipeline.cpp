@@ -0,0 +1,41 @@
+#include "framePipeline.h"
+
+FramePipeline::FramePipeline(uint frameDepth) {
+	depth = frameDepth;
+	if (depth < MIN_FRAME_DEPTH) depth = MIN_FRAME_DEPTH;
+	else if (depth > MAX_FRAME_DEPTH) depth = MAX_FRAME_DEPTH;
+	prepared = 1;
+	drawing = 0;
+}
+
+// Prepare side, false if every slot is drawn or waiting to be drawn
+bool FramePipeline::canPrepare() {
+	uint next = prepared.load(std::memory_order_relaxed);
+	return next - drawing.load(std::memory_order_acquire) < depth;
+}
+
+// Prepare side, slot to fill or -1 if none is free
+int FramePipeline::beginPrepare() {
+	if (!canPrepare()) return -1;
+	return prepared.load(std::memory_order_relaxed) % depth;
+}
+
+// Prepare side, slot filled by beginPrepare is visible to draw after this
+void FramePipeline::endPrepare() {
+	uint next = prepared.load(std::memory_order_relaxed);
+	prepared.store(next + 1, std::memory_order_release);
+}
+
+// Draw side, moves to the next prepared packet and returns its slot,
+//   -1 if none is ready so the current one stays. The slot left becomes free
+int FramePipeline::acquire() {
+	uint current = drawing.load(std::memory_order_relaxed);
+	if (prepared.load(std::memory_order_acquire) <= current + 1) return -1;
+	drawing.store(current + 1, std::memory_order_release);
+	return (current + 1) % depth;
+}
+
+// Prepared packets waiting to be drawn
+uint FramePipeline::getAhead() {
+	return prepared.load(std::memory_order_acquire) - drawing.load(std::memory_order_acquire) - 1;
+}
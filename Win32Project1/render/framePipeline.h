@@ -0,0 +1,29 @@
+#ifndef FRAME_PIPELINE_H_
+#define FRAME_PIPELINE_H_
+
+#include <atomic>
+#include "../constants/constants.h"
+
+#define MIN_FRAME_DEPTH 2
+#define MAX_FRAME_DEPTH 3
+
+// Hands frame packets from one preparing thread to one drawing thread without locks,
+//   packet n lives in slot n % depth: one slot is drawn, the others are prepared ahead.
+//   Packet 0 is an empty one drawn until the first prepared packet arrives
+class FramePipeline {
+private:
+	uint depth;
+	std::atomic<uint> prepared; // Packets published by prepare
+	std::atomic<uint> drawing; // Packet being drawn, slots of earlier ones are free
+public:
+	FramePipeline(uint frameDepth);
+	uint getDepth() { return depth; }
+	bool canPrepare();
+	int beginPrepare();
+	void endPrepare();
+	int acquire();
+	int current() { return drawing.load(std::memory_order_relaxed) % depth; }
+	uint getAhead();
+};
+
+#endif
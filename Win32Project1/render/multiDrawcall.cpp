@@ -1,6 +1,7 @@
 #include "multiDrawcall.h"
 #include "../instance/multiInstance.h"
 #include "../render/render.h"
+#include "../instance/instanceBuffer.h"
 
 // Attribute slots
 const uint VertexSlot = 0;
@@ -25,6 +26,7 @@ const uint WeightIndex = 7;
 const uint Index = 8;
 const uint PositionIndex = 9;
 const uint PositionOutIndex = 10;
+const uint GroupIndex = 11;
 
 // Indirect vbo index
 const uint IndirectNormalIndex = 0;
@@ -67,7 +69,7 @@ MultiDrawcall::~MultiDrawcall() {
 }
 
 RenderBuffer* MultiDrawcall::createBuffers(MultiInstance* multi, int vertexCount, int indexCount, int maxObjects, RenderBuffer* ref) {
-	RenderBuffer* buffer = new RenderBuffer(11);
+	RenderBuffer* buffer = new RenderBuffer(12);
 	if (!ref) {
 		buffer->setAttribData(GL_ARRAY_BUFFER, VertexIndex, VertexSlot, GL_FLOAT, vertexCount, 3, 1, false, GL_STATIC_DRAW, 0, multi->vertexBuffer);
 		buffer->setAttribData(GL_ARRAY_BUFFER, NormalIndex, NormalSlot, GL_HALF_FLOAT, vertexCount, 3, 1, false, GL_STATIC_DRAW, 0, multi->normalBuffer);
@@ -75,7 +77,7 @@ RenderBuffer* MultiDrawcall::createBuffers(MultiInstance* multi, int vertexCount
 		buffer->setAttribData(GL_ARRAY_BUFFER, TexidIndex, TexidSlot, GL_FLOAT, vertexCount, 2, 1, false, GL_STATIC_DRAW, 0, multi->texidBuffer);
 		buffer->setAttribData(GL_ARRAY_BUFFER, ColorIndex, ColorSlot, GL_UNSIGNED_BYTE, vertexCount, 3, 1, false, GL_STATIC_DRAW, 0, multi->colorBuffer);
 		buffer->setAttribData(GL_ARRAY_BUFFER, TangentIndex, TangentSlot, GL_HALF_FLOAT, vertexCount, 3, 1, false, GL_STATIC_DRAW, 0, multi->tangentBuffer);
-		buffer->setBufferData(GL_ELEMENT_ARRAY_BUFFER, Index, GL_UNSIGNED_SHORT, indexCount, GL_STATIC_DRAW, multi->indexBuffer);
+		buffer->setBufferData(GL_ELEMENT_ARRAY_BUFFER, Index, multi->indexType, indexCount, GL_STATIC_DRAW, multi->indexBuffer);
 		if (multi->hasAnim) {
 			buffer->setAttribData(GL_ARRAY_BUFFER, BoneidIndex, BoneidSlot, GL_UNSIGNED_BYTE, vertexCount, 4, 1, false, GL_STATIC_DRAW, 0, multi->boneidBuffer);
 			buffer->setAttribData(GL_ARRAY_BUFFER, WeightIndex, WeightSlot, GL_HALF_FLOAT, vertexCount, 4, 1, false, GL_STATIC_DRAW, 0, multi->weightBuffer);
@@ -94,7 +96,16 @@ RenderBuffer* MultiDrawcall::createBuffers(MultiInstance* multi, int vertexCount
 		}
 	}
 
-	buffer->setBufferData(GL_SHADER_STORAGE_BUFFER, PositionIndex, GL_FLOAT, maxObjects, 16, GL_DYNAMIC_DRAW, NULL);
+	// Animations upload their records, instances only entries into instance buffer
+	if (multi->hasAnim)
+		buffer->setBufferData(GL_SHADER_STORAGE_BUFFER, PositionIndex, GL_UNSIGNED_INT, maxObjects, sizeof(InstanceRecord) / sizeof(uint), GL_DYNAMIC_DRAW, NULL);
+	else {
+		buffer->setBufferData(GL_SHADER_STORAGE_BUFFER, PositionIndex, GL_UNSIGNED_INT, maxObjects, 1, GL_DYNAMIC_DRAW, NULL);
+		if (!ref)
+			buffer->setBufferData(GL_SHADER_STORAGE_BUFFER, GroupIndex, GL_INT, multi->indirectCount, 4, GL_STATIC_DRAW, multi->groups);
+		else
+			buffer->setBufferData(GL_SHADER_STORAGE_BUFFER, GroupIndex, ref->streamDatas[GroupIndex]);
+	}
 	buffer->setAttribData(GL_SHADER_STORAGE_BUFFER, PositionOutIndex, PositionSlot, GL_FLOAT, maxObjects, 4, 4, false, GL_STREAM_DRAW, 1, NULL);
 	buffer->useAs(PositionOutIndex, GL_ARRAY_BUFFER);
 	buffer->setAttrib(PositionOutIndex);
@@ -124,7 +135,7 @@ void MultiDrawcall::draw(Render* render, RenderState* state, Shader* shader) {
 			// Draw normal faces
 			if (multiRef->normalCount > 0) {
 				indirectBufferDraw->useAs(IndirectNormalIndex, GL_DRAW_INDIRECT_BUFFER);
-				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, 0, multiRef->normalCount, 0);
+				glMultiDrawElementsIndirect(GL_TRIANGLES, multiRef->indexType, 0, multiRef->normalCount, 0);
 			}
 
 			// Draw single faces
@@ -132,7 +143,7 @@ void MultiDrawcall::draw(Render* render, RenderState* state, Shader* shader) {
 				if (state->pass < COLOR_PASS) render->setCullMode(CULL_BACK);
 				else render->setCullState(false);
 				indirectBufferDraw->useAs(IndirectSingleIndex, GL_DRAW_INDIRECT_BUFFER);
-				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, 0, multiRef->singleCount, 0);
+				glMultiDrawElementsIndirect(GL_TRIANGLES, multiRef->indexType, 0, multiRef->singleCount, 0);
 			}
 
 			// Draw billboard faces
@@ -140,11 +151,11 @@ void MultiDrawcall::draw(Render* render, RenderState* state, Shader* shader) {
 				render->useShader(state->shaderBill);
 				if (state->pass < COLOR_PASS) render->setCullState(false);
 				indirectBufferDraw->useAs(IndirectBillIndex, GL_DRAW_INDIRECT_BUFFER);
-				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, 0, multiRef->billCount, 0);
+				glMultiDrawElementsIndirect(GL_TRIANGLES, multiRef->indexType, 0, multiRef->billCount, 0);
 			}
 		} else {
 			indirectBufferDraw->useAs(IndirectAnimIndex, GL_DRAW_INDIRECT_BUFFER);
-			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, 0, multiRef->animCount, 0);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, multiRef->indexType, 0, multiRef->animCount, 0);
 		}
 	}
 
@@ -160,7 +171,10 @@ void MultiDrawcall::swapBuffers() {
 
 void MultiDrawcall::update(Render* render, RenderState* state) {
 	objectCount = multiRef->updateTransform();
-	dataBufferPrepare->updateBufferData(PositionIndex, objectCount, (void*)(multiRef->transforms));
+	if (multiRef->hasAnim)
+		dataBufferPrepare->updateBufferData(PositionIndex, objectCount, (void*)(multiRef->records));
+	else 
+		dataBufferPrepare->updateBufferData(PositionIndex, objectCount, (void*)(multiRef->indices));
 	updateIndirect(render, state);
 	prepareRenderData(render, state);
 }
@@ -183,11 +197,14 @@ void MultiDrawcall::updateIndirect(Render* render, RenderState* state) {
 
 void MultiDrawcall::prepareRenderData(Render* render, RenderState* state) {
 	dataBufferPrepare->use();
-	dataBufferPrepare->setShaderBase(PositionIndex, 1);
 	dataBufferPrepare->setShaderBase(PositionOutIndex, 2);
-	if (multiRef->hasAnim)
+	if (multiRef->hasAnim) {
+		dataBufferPrepare->setShaderBase(PositionIndex, 1);
 		indirectBufferPrepare->setShaderBase(IndirectAnimIndex, 6);
-	else {
+	} else {
+		InstanceBuffer::instanceBuffer->use(1);
+		dataBufferPrepare->setShaderBase(PositionIndex, 7);
+		dataBufferPrepare->setShaderBase(GroupIndex, 8);
 		indirectBufferPrepare->setShaderBase(IndirectNormalIndex, 3);
 		indirectBufferPrepare->setShaderBase(IndirectSingleIndex, 4);
 		indirectBufferPrepare->setShaderBase(IndirectBillIndex, 5);
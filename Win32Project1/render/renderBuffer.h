@@ -92,6 +92,10 @@ struct RenderData {
 		streamData = data;
 		glNamedBufferSubData(bufferid, 0, dataSize * bitSize, streamData);
 	}
+	void updateBufferRange(uint offset, uint count, void* data) {
+		uint itemSize = channelCount * rowCount * bitSize;
+		glNamedBufferSubData(bufferid, offset * itemSize, count * itemSize, data);
+	}
 	void updateBufferMap(GLenum target, uint count, void* data) {
 		int mapSize = count * channelCount * rowCount;
 		glBindBuffer(target, bufferid);
@@ -195,6 +199,9 @@ struct RenderBuffer {
 	void updateBufferData(uint loc, uint count, void* data) {
 		streamDatas[loc]->updateBuffer(count, data);
 	}
+	void updateBufferData(uint loc, uint offset, uint count, void* data) {
+		streamDatas[loc]->updateBufferRange(offset, count, data);
+	}
 	void updateBufferMap(GLenum target, uint loc, uint count, void* data) {
 		streamDatas[loc]->updateBufferMap(target, count, data);
 	}
@@ -2,11 +2,14 @@
 #include "../assets/assetManager.h"
 #include "../mesh/board.h"
 #include "../object/staticObject.h"
+#include "../util/jobSystem.h"
 
-RenderManager::RenderManager(ConfigArg* cfg, Camera* view, float distance1, float distance2, const vec3& light) {
+RenderManager::RenderManager(ConfigArg* cfg, Camera* view, float midPixels, float lowPixels, const vec3& light) {
 	int precision = LOW_PRE;
 	cfgs = cfg;
-	shadow = new Shadow(view);
+	cullCamera = new Camera(0);
+	cullCamera->copy(view);
+	shadow = new Shadow(cullCamera);
 	float nearSize = 1024;
 	float midSize = 1024;
 	float farSize = 512;
@@ -29,10 +32,16 @@ RenderManager::RenderManager(ConfigArg* cfg, Camera* view, float distance1, floa
 	farBuffer = new FrameBuffer(farSize, farSize, LOW_PRE);
 	lightDir = light.GetNormalized();
 
-	queue1 = new Renderable(distance1, distance2, cfgs);
-	queue2 = new Renderable(distance1, distance2, cfgs);
-	currentQueue = queue1;
-	nextQueue = queue2;
+	lodMidPixels = midPixels;
+	lodLowPixels = lowPixels;
+	lodScale = 1.0;
+	screenHeight = cfgs->height;
+
+	pipeline = new FramePipeline(cfgs->frameDepth);
+	for (uint i = 0; i < pipeline->getDepth(); i++)
+		frames.push_back(new Renderable(midPixels, lowPixels, cfgs));
+	currentQueue = frames[pipeline->current()];
+	renderData = currentQueue;
 
 	state = new RenderState();
 
@@ -40,18 +49,27 @@ RenderManager::RenderManager(ConfigArg* cfg, Camera* view, float distance1, floa
 	occluderDepth = NULL;
 	needResize = true;
 	updateSky();
+	for (uint i = 0; i < frames.size(); i++) {
+		frames[i]->camera->copy(cullCamera);
+		frames[i]->reflectCamera->copy(cullCamera);
+		frames[i]->lightDir = lightDir;
+		frames[i]->udotl = udotl;
+	}
 
 	grassDrawcall = NULL;
 }
 
 RenderManager::~RenderManager() {
 	delete shadow; shadow = NULL;
+	delete cullCamera; cullCamera = NULL;
 	delete nearBuffer; nearBuffer = NULL;
 	delete midBuffer; midBuffer = NULL;
 	delete farBuffer; farBuffer = NULL;
 
-	delete queue1; queue1 = NULL;
-	delete queue2; queue2 = NULL;
+	for (uint i = 0; i < frames.size(); i++)
+		delete frames[i];
+	frames.clear();
+	delete pipeline; pipeline = NULL;
 
 	delete state; state = NULL;
 	if (reflectBuffer) delete reflectBuffer; reflectBuffer = NULL;
@@ -70,11 +88,13 @@ void RenderManager::resize(float width, float height) {
 
 	if (occluderDepth) delete occluderDepth;
 	occluderDepth = new Texture2D(width, height, TEXTURE_TYPE_DEPTH, LOW_PRE, 1);
+	screenHeight = height;
 	needResize = true;
 	updateSky();
 }
 
 void RenderManager::updateShadowCamera(Camera* mainCamera) {
+	cullCamera->copy(mainCamera);
 	shadow->prepareViewCamera(mainCamera->zFar * 0.25, mainCamera->zFar * 0.75);
 }
 
@@ -96,18 +116,38 @@ void RenderManager::updateRenderQueues(Scene* scene) {
 	Camera* cameraNear = shadow->lightCameraNear;
 	Camera* cameraMid = shadow->lightCameraMid;
 	Camera* cameraFar = shadow->lightCameraFar;
-	Camera* cameraMain = scene->mainCamera;
-
-	PushNodeToQueue(renderData->queues[QUEUE_STATIC_SN], scene, scene->staticRoot, cameraNear, cameraMain);
-	PushNodeToQueue(renderData->queues[QUEUE_STATIC_SM], scene, scene->staticRoot, cameraMid, cameraMain);
-	//PushNodeToQueue(renderData->queues[QUEUE_STATIC_SF], scene, scene->staticRoot, cameraFar, cameraMain);
-	PushNodeToQueue(renderData->queues[QUEUE_STATIC], scene, scene->staticRoot, cameraMain, cameraMain);
-	PushNodeToQueue(renderData->queues[QUEUE_ANIMATE_SN], scene, scene->animationRoot, cameraNear, cameraMain);
-	PushNodeToQueue(renderData->queues[QUEUE_ANIMATE_SM], scene, scene->animationRoot, cameraMid, cameraMain);
-	//PushNodeToQueue(renderData->queues[QUEUE_ANIMATE_SF], scene, scene->animationRoot, cameraFar, cameraMain);
-	PushNodeToQueue(renderData->queues[QUEUE_ANIMATE], scene, scene->animationRoot, cameraMain, cameraMain);
+	Camera* cameraMain = cullCamera;
+
+	//Camera* cameras[] = { cameraNear, cameraMid, cameraFar, cameraMain };
+	Camera* cameras[] = { cameraNear, cameraMid, cameraMain };
+	RenderQueue* staticQueues[] = { 
+		renderData->queues[QUEUE_STATIC_SN], 
+		renderData->queues[QUEUE_STATIC_SM], 
+		//renderData->queues[QUEUE_STATIC_SF], 
+		renderData->queues[QUEUE_STATIC] 
+	};
+	RenderQueue* animateQueues[] = { 
+		renderData->queues[QUEUE_ANIMATE_SN], 
+		renderData->queues[QUEUE_ANIMATE_SM], 
+		//renderData->queues[QUEUE_ANIMATE_SF], 
+		renderData->queues[QUEUE_ANIMATE] 
+	};
+
+	// Static and animation trees fill different queues, so cull them as separate jobs,
+	//   each splits instances of its visible leaves into further jobs
+	JobSystem* jobs = JobSystem::jobSystem;
+	Job* cullJob = jobs->create(JobFunc());
+	jobs->submit(jobs->create([&]() { 
+		PushNodeToQueues(staticQueues, cameras, 3, scene, scene->staticTree, cameraMain); 
+	}, cullJob));
+	jobs->submit(jobs->create([&]() { 
+		PushNodeToQueues(animateQueues, cameras, 3, scene, scene->animationTree, cameraMain); 
+	}, cullJob));
+	jobs->submit(cullJob);
+	jobs->wait(cullJob);
 }
 
+// Queues one by one since a node may be in several of them
 void RenderManager::animateQueues(float velocity) {
 	currentQueue->queues[QUEUE_ANIMATE_SN]->animate(velocity);
 	currentQueue->queues[QUEUE_ANIMATE_SM]->animate(velocity);
@@ -115,19 +155,54 @@ void RenderManager::animateQueues(float velocity) {
 	currentQueue->queues[QUEUE_ANIMATE]->animate(velocity);
 }
 
-void RenderManager::swapRenderQueues(Scene* scene, bool swapQueue) {
-	if (swapQueue) {
-		currentQueue = (currentQueue == queue1) ? queue2 : queue1;
-		nextQueue = (nextQueue == queue1) ? queue2 : queue1;
+// Draw side, main camera as the next prepared frames will see it
+void RenderManager::snapshotCamera(Camera* mainCamera) {
+	mainCamera->updateFrustum();
+	cullCamera->copy(mainCamera);
+}
 
-		renderData = nextQueue;
-	} else {
-		currentQueue = queue1;
-		renderData = currentQueue;
-	}
+// Prepare side, culls into a free packet and hands it to draw, false if none is free
+bool RenderManager::prepareFrame(Scene* scene) {
+	int slot = pipeline->beginPrepare();
+	if (slot < 0) return false;
+	renderData = frames[slot];
 
+	updateMainLight(); // Update shadow cameras' frustum for cull
 	flushRenderQueues();
+	float projScale = screenHeight * 0.5 / tanf(cullCamera->fovy * A2R * 0.5);
+	renderData->setLod(projScale, lodMidPixels * lodScale, lodLowPixels * lodScale);
 	updateRenderQueues(scene);
+	updateLod(renderData->queues[QUEUE_STATIC]->getTriangles());
+
+	renderData->camera->copy(cullCamera);
+	if (scene->reflectCamera) renderData->reflectCamera->copy(scene->reflectCamera);
+	renderData->shadow->copy(shadow);
+	renderData->lightDir = lightDir;
+	renderData->udotl = udotl;
+	if (InstanceBuffer::instanceBuffer) 
+		InstanceBuffer::instanceBuffer->snapshot(&renderData->instances);
+	pipeline->endPrepare();
+	return true;
+}
+
+// Coarser lods for next frames while main view's instances exceed triangle budget
+void RenderManager::updateLod(uint triangles) {
+	if (cfgs->triBudget <= 0) 
+		lodScale = 1.0;
+	else if (triangles > (uint)cfgs->triBudget) 
+		lodScale = lodScale * LOD_SCALE_STEP < LOD_SCALE_MAX ? lodScale * LOD_SCALE_STEP : LOD_SCALE_MAX;
+	else if (triangles < cfgs->triBudget * LOD_BUDGET_SLACK) 
+		lodScale = lodScale / LOD_SCALE_STEP > 1.0 ? lodScale / LOD_SCALE_STEP : 1.0;
+}
+
+// Draw side, switches to next prepared packet if there is one
+bool RenderManager::acquireFrame() {
+	int slot = pipeline->acquire();
+	if (slot < 0) return false;
+	currentQueue = frames[slot];
+	if (InstanceBuffer::instanceBuffer) 
+		InstanceBuffer::instanceBuffer->upload(&currentQueue->instances);
+	return true;
 }
 
 void RenderManager::renderShadow(Render* render, Scene* scene) {
@@ -146,16 +221,14 @@ void RenderManager::renderShadow(Render* render, Scene* scene) {
 	static Shader* animFlushShader = render->findShader("animFlush");
 
 	state->reset();
-	state->eyePos = &(scene->mainCamera->position);
+	state->eyePos = &(currentQueue->camera->position);
 	state->cullMode = CULL_FRONT;
-	state->light = lightDir;
-	state->udotl = udotl;
+	state->light = currentQueue->lightDir;
+	state->udotl = currentQueue->udotl;
 	state->time = scene->time;
 
-	Camera* mainCamera = scene->mainCamera;
-
 	render->setFrameBuffer(nearBuffer);
-	Camera* cameraNear=shadow->lightCameraNear;
+	Camera* cameraNear = currentQueue->shadow->lightCameraNear;
 	state->pass = NEAR_SHADOW_PASS;
 	state->shader = phongShadowShader;
 	state->shaderIns = phongShadowInsShader;
@@ -170,7 +243,7 @@ void RenderManager::renderShadow(Render* render, Scene* scene) {
 	currentQueue->queues[QUEUE_ANIMATE_SN]->draw(scene, cameraNear, render, state);
 
 	render->setFrameBuffer(midBuffer);
-	Camera* cameraMid=shadow->lightCameraMid;
+	Camera* cameraMid = currentQueue->shadow->lightCameraMid;
 	state->pass = MID_SHADOW_PASS;
 	state->shader = phongShadowShader;
 	state->shaderMulti = multiShader;
@@ -192,7 +265,7 @@ void RenderManager::renderShadow(Render* render, Scene* scene) {
 				render->setFrameBuffer(farBuffer);
 				if (true) flushed = true;
 				else {
-					Camera* cameraFar = shadow->lightCameraFar;
+					Camera* cameraFar = currentQueue->shadow->lightCameraFar;
 					state->pass = FAR_SHADOW_PASS;
 					state->shader = phongShadowLowShader;
 					state->shaderIns = phongShadowInsShader;
@@ -263,19 +336,19 @@ void RenderManager::renderScene(Render* render, Scene* scene) {
 	static Shader* animFlushShader = render->findShader("animFlush");
 
 	state->reset();
-	state->eyePos = &(scene->mainCamera->position);
-	state->light = lightDir;
-	state->udotl = udotl;
+	state->eyePos = &(currentQueue->camera->position);
+	state->light = currentQueue->lightDir;
+	state->udotl = currentQueue->udotl;
 	state->time = scene->time;
 	state->enableSsr = cfgs->ssr;
 	state->quality = cfgs->graphQuality;
 	state->dynSky = cfgs->dynsky;
 
-	Camera* camera = scene->mainCamera;
+	Camera* camera = currentQueue->camera;
 
 	// Draw terrain & grass
 	TerrainNode* terrainNode = scene->terrainNode;
-	if (terrainNode && terrainNode->checkInCamera(camera)) {
+	if (terrainNode && terrainNode->checkInCamera(currentQueue->camera)) {
 		static Shader* terrainShader = render->findShader("terrain");
 		state->shader = terrainShader;
 		((StaticDrawcall*)terrainNode->drawcall)->updateBuffers(state->pass);
@@ -341,7 +414,6 @@ void RenderManager::renderScene(Render* render, Scene* scene) {
 		frame++;
 	}
 
-	scene->flushNodes();
 	if (needResize) needResize = false;
 }
 
@@ -350,20 +422,20 @@ void RenderManager::renderSkyTex(Render* render, Scene* scene) {
 	if (needRefreshSky) {
 		static Shader* atmoShader = render->findShader("atmos");
 		scene->skyBox->state->time = scene->time;
-		scene->skyBox->state->udotl = udotl;
-		scene->skyBox->update(render, lightDir, atmoShader);
+		scene->skyBox->state->udotl = currentQueue->udotl;
+		scene->skyBox->update(render, currentQueue->lightDir, atmoShader);
 		needRefreshSky = false;
 	}
 }
 
 void RenderManager::renderWater(Render* render, Scene* scene) {
 	static Shader* waterShader = render->findShader("water");
-	Camera* camera = scene->mainCamera;
+	Camera* camera = currentQueue->camera;
 	if (scene->water && scene->water->checkInCamera(camera)) {
 		state->reset();
-		state->eyePos = &(scene->mainCamera->position);
-		state->light = lightDir;
-		state->udotl = udotl;
+		state->eyePos = &(currentQueue->camera->position);
+		state->light = currentQueue->lightDir;
+		state->udotl = currentQueue->udotl;
 		state->time = scene->time;
 		state->enableSsr = cfgs->ssr;
 		state->waterPass = true;
@@ -378,19 +450,19 @@ void RenderManager::renderReflect(Render* render, Scene* scene) {
 	if (!scene->water || !scene->reflectCamera || !reflectBuffer) return;
 	render->setFrameBuffer(reflectBuffer);
 	if (scene->terrainNode) {
-		if (scene->terrainNode->checkInCamera(scene->reflectCamera)) {
+		if (scene->terrainNode->checkInCamera(currentQueue->reflectCamera)) {
 			if (scene->terrainNode->drawcall) {
 				static Shader* terrainShader = render->findShader("terrain");
 				state->reset();
-				state->eyePos = &(scene->mainCamera->position);
+				state->eyePos = &(currentQueue->camera->position);
 				state->cullMode = CULL_FRONT;
-				state->light = lightDir;
-				state->udotl = udotl;
+				state->light = currentQueue->lightDir;
+				state->udotl = currentQueue->udotl;
 				state->shader = terrainShader;
 				
 				render->setShaderFloat(terrainShader, "isReflect", 1.0);
 				render->setShaderFloat(terrainShader, "waterHeight", scene->water->position.y);
-				render->draw(scene->reflectCamera, scene->terrainNode->drawcall, state);
+				render->draw(currentQueue->reflectCamera, scene->terrainNode->drawcall, state);
 				render->setShaderFloat(terrainShader, "isReflect", 0.0);
 			}
 		}
@@ -400,14 +472,14 @@ void RenderManager::renderReflect(Render* render, Scene* scene) {
 void RenderManager::drawDeferred(Render* render, Scene* scene, FrameBuffer* screenBuff, Filter* filter) {
 	static Shader* deferredShader = render->findShader("deferred");
 	state->reset();
-	state->eyePos = &(scene->mainCamera->position);
+	state->eyePos = &(currentQueue->camera->position);
 	//state->enableCull = false;
 	state->enableDepthTest = false;
 	state->pass = DEFERRED_PASS;
 	state->shader = deferredShader;
-	state->shadow = shadow;
-	state->light = lightDir;
-	state->udotl = udotl;
+	state->shadow = currentQueue->shadow;
+	state->light = currentQueue->lightDir;
+	state->udotl = currentQueue->udotl;
 	state->time = scene->time;
 	state->quality = cfgs->graphQuality;
 	state->dynSky = cfgs->dynsky;
@@ -419,49 +491,49 @@ void RenderManager::drawDeferred(Render* render, Scene* scene, FrameBuffer* scre
 		deferredShader->setHandle64("depthBufferMid", midBuffer->getDepthBuffer()->hnd);
 	if(!deferredShader->isTexBinded(farBuffer->getDepthBuffer()->hnd))
 		deferredShader->setHandle64("depthBufferFar", farBuffer->getDepthBuffer()->hnd);
-	filter->draw(scene->mainCamera, render, state, screenBuff->colorBuffers, screenBuff->depthBuffer);
+	filter->draw(currentQueue->camera, render, state, screenBuff->colorBuffers, screenBuff->depthBuffer);
 }
 
 void RenderManager::drawCombined(Render* render, Scene* scene, const std::vector<Texture2D*>& inputTextures, Filter* filter) {
 	static Shader* combinedShader = render->findShader("combined");
 	state->reset();
-	state->eyePos = &(scene->mainCamera->position);
+	state->eyePos = &(currentQueue->camera->position);
 	//state->enableCull = false;
 	state->enableDepthTest = false;
 	state->pass = DEFERRED_PASS;
 	state->shader = combinedShader;
 	state->quality = cfgs->graphQuality;
 	state->dynSky = cfgs->dynsky;
-	filter->draw(scene->mainCamera, render, state, inputTextures, NULL);
+	filter->draw(currentQueue->camera, render, state, inputTextures, NULL);
 }
 
 void RenderManager::drawScreenFilter(Render* render, Scene* scene, const char* shaderStr, FrameBuffer* inputBuff, Filter* filter) {
 	Shader* shader = render->findShader(shaderStr);
 	state->reset();
-	state->eyePos = &(scene->mainCamera->position);
+	state->eyePos = &(currentQueue->camera->position);
 	//state->enableCull = false;
 	state->enableDepthTest = false;
 	state->pass = POST_PASS;
 	state->shader = shader;
 
-	filter->draw(scene->mainCamera, render, state, inputBuff->colorBuffers, NULL);
+	filter->draw(currentQueue->camera, render, state, inputBuff->colorBuffers, NULL);
 }
 
 void RenderManager::drawScreenFilter(Render* render, Scene* scene, const char* shaderStr, const std::vector<Texture2D*>& inputTextures, Filter* filter) {
 	Shader* shader = render->findShader(shaderStr);
 	state->reset();
-	state->eyePos = &(scene->mainCamera->position);
+	state->eyePos = &(currentQueue->camera->position);
 	//state->enableCull = false;
 	state->enableDepthTest = false;
 	state->pass = POST_PASS;
 	state->shader = shader;
-	filter->draw(scene->mainCamera, render, state, inputTextures, NULL);
+	filter->draw(currentQueue->camera, render, state, inputTextures, NULL);
 }
 
 void RenderManager::drawDualFilter(Render* render, Scene* scene, const char* shaderStr, DualFilter* filter) {
 	Shader* shader = render->findShader(shaderStr);
 	state->reset();
-	state->eyePos = &(scene->mainCamera->position);
+	state->eyePos = &(currentQueue->camera->position);
 	//state->enableCull = false;
 	state->enableDepthTest = false;
 	state->pass = POST_PASS;
@@ -476,33 +548,33 @@ void RenderManager::drawDualFilter(Render* render, Scene* scene, const char* sha
 void RenderManager::drawSSRFilter(Render* render, Scene* scene, const char* shaderStr, const std::vector<Texture2D*>& inputTextures, Filter* filter) {
 	Shader* shader = render->findShader(shaderStr);
 	state->reset();
-	state->eyePos = &(scene->mainCamera->position);
+	state->eyePos = &(currentQueue->camera->position);
 	//state->enableCull = false;
 	state->enableDepthTest = false;
 	state->pass = POST_PASS;
 	state->shader = shader;
 	state->ssrPass = true;
 
-	filter->draw(scene->mainCamera, render, state, inputTextures, NULL);
+	filter->draw(currentQueue->camera, render, state, inputTextures, NULL);
 }
 
 void RenderManager::drawSSGFilter(Render* render, Scene* scene, const char* shaderStr, const std::vector<Texture2D*>& inputTextures, Filter* filter) {
 	Shader* shader = render->findShader(shaderStr);
 	state->reset();
-	state->eyePos = &(scene->mainCamera->position);
+	state->eyePos = &(currentQueue->camera->position);
 	//state->enableCull = false;
 	state->enableDepthTest = false;
 	state->pass = POST_PASS;
 	state->shader = shader;
 	state->ssgPass = true;
 
-	filter->draw(scene->mainCamera, render, state, inputTextures, NULL);
+	filter->draw(currentQueue->camera, render, state, inputTextures, NULL);
 }
 
 void RenderManager::drawTexture2Screen(Render* render, Scene* scene, u64 texhnd) {
 	static Shader* screenShader = render->findShader("screen");
 	state->reset();
-	state->eyePos = &(scene->mainCamera->position);
+	state->eyePos = &(currentQueue->camera->position);
 	//state->enableCull = false;
 	state->enableDepthTest = false;
 	state->pass = POST_PASS;
@@ -519,7 +591,7 @@ void RenderManager::drawTexture2Screen(Render* render, Scene* scene, u64 texhnd)
 	}
 
 	render->setFrameBuffer(NULL);
-	render->draw(scene->mainCamera, scene->textureNode->drawcall, state);
+	render->draw(currentQueue->camera, scene->textureNode->drawcall, state);
 }
 
 void RenderManager::drawBoundings(Render* render, RenderState* state, Scene* scene, Camera* camera) {
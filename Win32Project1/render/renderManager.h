@@ -12,13 +12,36 @@
 #include "../filter/filter.h"
 #include "../render/renderQueue.h"
 #include "../render/computeDrawcall.h"
+#include "../render/framePipeline.h"
+#include "../instance/instanceBuffer.h"
 
+#define FRAME_ARENA_SIZE (4 * 1024 * 1024)
+
+// Lod thresholds scale up by step per frame over triangle budget, 
+//   and back down per frame under slack part of it
+#define LOD_SCALE_STEP 1.1
+#define LOD_SCALE_MAX 16.0
+#define LOD_BUDGET_SLACK 0.85
+
+// Packet of one frame, filled by prepare and only read by draw once handed over
 struct Renderable {
 	std::vector<RenderQueue*> queues;
-	Renderable(float midDis, float lowDis, ConfigArg* cfg) {
+	FrameArena* arena; // Per frame data of all queues, reset with them
+	Camera* camera; // Main camera queues were culled with, draw views through it
+	Camera* reflectCamera; // Reflection of camera in water
+	Shadow* shadow; // Light cameras & matrices queues were culled with
+	vec3 lightDir;
+	float udotl;
+	InstanceSnapshot instances; // Instance records changed up to this frame
+	Renderable(float midPixels, float lowPixels, ConfigArg* cfg) {
+		arena = new FrameArena(FRAME_ARENA_SIZE);
+		camera = new Camera(0);
+		reflectCamera = new Camera(0);
+		shadow = new Shadow(camera);
+		udotl = 0.0;
 		queues.clear();
 		for (uint i = 0; i < 8; i++) {
-			queues.push_back(new RenderQueue(i, midDis, lowDis));
+			queues.push_back(new RenderQueue(i, midPixels, lowPixels, arena));
 			queues[i]->setCfg(cfg);
 		}
 		queues[QUEUE_STATIC_SN]->shadowLevel = 1;
@@ -31,10 +54,36 @@ struct Renderable {
 	~Renderable() {
 		for (uint i = 0; i < queues.size(); i++)
 			delete queues[i];
+		delete arena;
+		delete shadow;
+		delete camera;
+		delete reflectCamera;
 	}
 	void flush() {
 		for (uint i = 0; i < queues.size(); i++)
 			queues[i]->flush();
+		arena->reset();
+	}
+	// Call before flush, counts of the frame drawn from these queues
+	uint getStateChanges() {
+		uint changes = 0;
+		for (uint i = 0; i < queues.size(); i++)
+			changes += queues[i]->getStateChanges();
+		return changes;
+	}
+	uint getStateChangesAvoided() {
+		uint avoided = 0;
+		for (uint i = 0; i < queues.size(); i++)
+			avoided += queues[i]->getStateChangesAvoided();
+		return avoided;
+	}
+	void setLod(float projScale, float midPixels, float lowPixels) {
+		for (uint i = 0; i < queues.size(); i++)
+			queues[i]->setLod(projScale, midPixels, lowPixels);
+	}
+	// Call before flush, instances of main view drawn with mesh of level
+	uint getLodCount(int level) {
+		return queues[QUEUE_STATIC]->getLodCount(level);
 	}
 };
 
@@ -47,24 +96,28 @@ public:
 	Texture2D* occluderDepth;
 private:
 	Shadow* shadow;
+	Camera* cullCamera; // Snapshot of main camera taken on draw thread, read by prepare
 	bool needResize, needRefreshSky;
 	ComputeDrawcall* grassDrawcall;
+	FramePipeline* pipeline;
+	std::vector<Renderable*> frames; // Slot by slot of pipeline
+	float lodMidPixels, lodLowPixels; // Projected radius thresholds before budget scale
+	float lodScale; // Set by triangle budget, 1 if within it
+	float screenHeight;
 public:
-	Renderable* renderData;
-	Renderable* queue1;
-	Renderable* queue2;
-	Renderable* currentQueue;
-	Renderable* nextQueue;
+	Renderable* renderData; // Being prepared
+	Renderable* currentQueue; // Being drawn
 private:
 	void drawBoundings(Render* render, RenderState* state, Scene* scene, Camera* camera);
 	void drawGrass(Render* render, RenderState* state, Scene* scene, Camera* camera);
+	void updateLod(uint triangles);
 public:
 	FrameBuffer* nearBuffer;
 	FrameBuffer* midBuffer;
 	FrameBuffer* farBuffer;
 	FrameBuffer* reflectBuffer;
 
-	RenderManager(ConfigArg* cfg, Camera* view, float distance1, float distance2, const vec3& light);
+	RenderManager(ConfigArg* cfg, Camera* view, float midPixels, float lowPixels, const vec3& light);
 	~RenderManager();
 
 	void resize(float width, float height);
@@ -74,7 +127,13 @@ public:
 	void flushRenderQueues();
 	void updateRenderQueues(Scene* scene);
 	void animateQueues(float velocity);
-	void swapRenderQueues(Scene* scene, bool swapQueue);
+	void snapshotCamera(Camera* mainCamera);
+	Camera* getCullCamera() { return cullCamera; }
+	bool canPrepareFrame() { return pipeline->canPrepare(); }
+	bool prepareFrame(Scene* scene);
+	bool acquireFrame();
+	uint getFramesAhead() { return pipeline->getAhead(); }
+	float getLodScale() { return lodScale; }
 	void renderShadow(Render* render,Scene* scene);
 	void renderScene(Render* render,Scene* scene);
 	void renderWater(Render* render, Scene* scene);
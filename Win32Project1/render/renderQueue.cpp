@@ -4,25 +4,33 @@
 #include "../node/instanceNode.h"
 #include "../assets/assetManager.h"
 #include "../scene/scene.h"
+#include "../util/radixSort.h"
+#include "../util/jobSystem.h"
 #include <string.h>
 #include <stdlib.h>
 using namespace std;
 
-RenderQueue::RenderQueue(int type, float midDis, float lowDis) {
+RenderQueue::RenderQueue(int type, float midPixels, float lowPixels, FrameArena* frameArena) {
 	queueType = type;
-	queue = new Queue(1);
-	animQueue = new Queue(1);
+	arena = frameArena;
+	queue = new Queue(0, arena);
+	animQueue = new Queue(0, arena);
 	instanceQueue.clear();
 	animationQueue.clear();
 	multiInstance = NULL;
 	billboards = NULL;
 	animations = NULL;
 	batchData = NULL;
-	midDistSqr = powf(midDis, 2);
-	lowDistSqr = powf(lowDis, 2);
+	lodProjScale = 1.0;
+	lodMidPixels = midPixels;
+	lodLowPixels = lowPixels;
 	shadowLevel = 0;
 	firstFlush = true;
 	cfgArgs = NULL;
+	stateChanges = 0;
+	stateChangesAvoided = 0;
+	memset(lodCounts, 0, sizeof(lodCounts));
+	triangles = 0;
 }
 
 RenderQueue::~RenderQueue() {
@@ -34,14 +42,12 @@ RenderQueue::~RenderQueue() {
 	if (billboards) delete billboards;
 	if (animations) delete animations;
 
-	map<Mesh*, InstanceData*>::iterator itIns;
-	for (itIns = instanceQueue.begin(); itIns != instanceQueue.end(); ++itIns)
-		delete itIns->second;
+	for (uint i = 0; i < instanceQueue.size(); ++i) 
+		if (instanceQueue[i]) delete instanceQueue[i];
 	instanceQueue.clear();
 
-	map<Animation*, AnimationData*>::iterator itAnim;
-	for (itAnim = animationQueue.begin(); itAnim != animationQueue.end(); ++itAnim)
-		delete itAnim->second;
+	for (uint i = 0; i < animationQueue.size(); ++i) 
+		if (animationQueue[i]) delete animationQueue[i];
 	animationQueue.clear();
 }
 
@@ -57,19 +63,17 @@ void RenderQueue::flush() {
 	queue->flush();
 	animQueue->flush();
 	
-	map<Mesh*, InstanceData*>::iterator itData = instanceQueue.begin();
-	while (itData != instanceQueue.end()) {
-		itData->second->resetInstance();
-		++itData;
-	}
+	for (uint i = 0; i < instanceQueue.size(); ++i) 
+		if (instanceQueue[i]) instanceQueue[i]->resetInstance();
 
-	map<Animation*, AnimationData*>::iterator itAnim = animationQueue.begin();
-	while (itAnim != animationQueue.end()) {
-		itAnim->second->resetAnims();
-		++itAnim;
-	}
+	for (uint i = 0; i < animationQueue.size(); ++i) 
+		if (animationQueue[i]) animationQueue[i]->resetAnims();
 	
 	if (batchData) batchData->resetBatch();
+	stateChanges = 0;
+	stateChangesAvoided = 0;
+	memset(lodCounts, 0, sizeof(lodCounts));
+	triangles = 0;
 }
 
 void RenderQueue::deleteInstance(InstanceData* data) {
@@ -80,8 +84,10 @@ void RenderQueue::deleteInstance(InstanceData* data) {
 
 void RenderQueue::pushDatasToInstance(Scene* scene, InstanceData* data, bool copy) {
 	if (!data->instance) {
+		Object* object = Object::fromHandle(data->object);
+		if (!object) return;
 		data->instance = new Instance(data);
-		data->instance->initInstanceBuffers(data->object, data->insMesh->vertexCount, data->insMesh->indexCount, scene->queryMeshCount(data->insMesh), copy);
+		data->instance->initInstanceBuffers(object, data->insMesh->vertexCount, data->insMesh->indexCount, scene->queryMeshCount(data->insMesh), copy);
 	}
 	data->instance->setRenderData(data);
 }
@@ -96,7 +102,53 @@ void RenderQueue::pushDatasToBatch(BatchData* data, int pass) {
 	data->batch->setRenderData(pass, data);
 }
 
-void RenderQueue::draw(Scene* scene, Camera* camera, Render* render, RenderState* state) {
+u64 MakeSortKey(uint layer, uint shader, uint material, uint depth, uint mesh) {
+	u64 key = (u64)(layer & 0x1) << 63 | (mesh & 0xffff);
+	if (layer == SORT_LAYER_BLEND) 
+		return key | (u64)(0xffff - (depth & 0xffff)) << 47 | (u64)(shader & 0x7fff) << 32 | (u64)(material & 0xffff) << 16;
+	return key | (u64)(shader & 0x7fff) << 48 | (u64)(material & 0xffff) << 32 | (u64)(depth & 0xffff) << 16;
+}
+
+// Top bits of a positive float keep its order
+uint DepthBucket(float disSqr) {
+	if (disSqr <= 0.0) return 0;
+	uint bits;
+	memcpy(&bits, &disSqr, sizeof(uint));
+	return bits >> 16;
+}
+
+// State a static node draw binds, shader & material part of sort key
+inline uint SortState(u64 key) {
+	if ((key >> 63) == SORT_LAYER_BLEND) 
+		return (uint)(key >> 16) & 0x7fffffff;
+	return (uint)(key >> 32) & 0x7fffffff;
+}
+
+// Same material set gives same bits, different sets rarely collide
+inline uint FoldMaterialSet(u64 set) {
+	return (uint)((set ^ (set >> 16) ^ (set >> 32) ^ (set >> 48)) & 0xffff);
+}
+
+u64 MakeNodeKey(Node* node, Shader* shader, Camera* camera, RenderState* state) {
+	uint program = shader->id << 4 | (state->pass & 0xf);
+	uint material = FoldMaterialSet(((StaticDrawcall*)node->drawcall)->materialSet);
+	uint mesh = 0;
+	if (node->objects.size() > 0 && node->objects[0]->mesh && node->objects[0]->mesh->meshId >= 0) 
+		mesh = node->objects[0]->mesh->meshId;
+	float disSqr = 0.0;
+	if (node->boundingBox) 
+		disSqr = (node->boundingBox->position - camera->position).GetSquaredLength();
+	uint layer = state->blend ? SORT_LAYER_BLEND : SORT_LAYER_OPAQUE;
+	return MakeSortKey(layer, program, material, DepthBucket(disSqr), mesh);
+}
+
+// Static & terrain nodes drawn by sort key, front to back inside one state
+void RenderQueue::drawNodes(Camera* camera, Render* render, RenderState* state, Shader* terrainShader) {
+	if (queue->size <= 0) return;
+	u64* keys = arena->allocArray<u64>(queue->size * 2);
+	uint* indices = arena->allocArray<uint>(queue->size * 2);
+	uint count = 0, unsortedChanges = 0;
+	Shader* shader = state->shader;
 	for (int it = 0; it < queue->size; it++) {
 		Node* node = queue->get(it);
 		if (!node->needUpdateNode) {
@@ -108,23 +160,38 @@ void RenderQueue::draw(Scene* scene, Camera* camera, Render* render, RenderState
 			}
 		}
 
-		if (node->type == TYPE_STATIC) 
-			render->draw(camera, node->drawcall, state);
-		else if (node->type == TYPE_TERRAIN) {
-			if (state->pass == COLOR_PASS) {
-				static Shader* terrainShader = render->findShader("terrain");
-				Shader* shader = state->shader;
-				state->shader = terrainShader;
-				render->draw(camera, node->drawcall, state);
-				state->shader = shader;
-			}
+		if (!node->drawcall) continue;
+		if (node->type == TYPE_STATIC || (node->type == TYPE_TERRAIN && state->pass == COLOR_PASS)) {
+			keys[count] = MakeNodeKey(node, node->type == TYPE_TERRAIN ? terrainShader : shader, camera, state);
+			indices[count] = it;
+			if (count > 0 && SortState(keys[count]) != SortState(keys[count - 1])) unsortedChanges++;
+			count++;
 		}
 	}
+	RadixSort(keys, indices, count, keys + queue->size, indices + queue->size);
+
+	uint sortedChanges = 0;
+	for (uint i = 0; i < count; i++) {
+		Node* node = queue->get(indices[i]);
+		if (i > 0 && SortState(keys[i]) != SortState(keys[i - 1])) sortedChanges++;
+		state->shader = node->type == TYPE_TERRAIN ? terrainShader : shader;
+		render->draw(camera, node->drawcall, state);
+	}
+	state->shader = shader;
+
+	stateChanges += sortedChanges;
+	if (unsortedChanges > sortedChanges) 
+		stateChangesAvoided += unsortedChanges - sortedChanges;
+}
+
+void RenderQueue::draw(Scene* scene, Camera* camera, Render* render, RenderState* state) {
+	static Shader* terrainShader = render->findShader("terrain");
+	drawNodes(camera, render, state, terrainShader);
 
 	if (!multiInstance || !multiInstance->inited()) {
-		map<Mesh*, InstanceData*>::iterator itData = instanceQueue.begin();
-		while (itData != instanceQueue.end()) {
-			InstanceData* data = itData->second;
+		for (uint i = 0; i < instanceQueue.size(); ++i) {
+			InstanceData* data = instanceQueue[i];
+			if (!data) continue;
 			pushDatasToInstance(scene, data, false);
 			Instance* instance = data->instance;
 			if (instance) {
@@ -143,7 +210,6 @@ void RenderQueue::draw(Scene* scene, Camera* camera, Render* render, RenderState
 					}
 				}
 			}
-			++itData;
 		}
 	}
 
@@ -166,12 +232,11 @@ void RenderQueue::draw(Scene* scene, Camera* camera, Render* render, RenderState
 	}
 
 	if (!animations || !animations->inited()) {
-		map<Animation*, AnimationData*>::iterator itAnim = animationQueue.begin();
-		while (itAnim != animationQueue.end()) {
-			AnimationData* data = itAnim->second;
+		for (uint i = 0; i < animationQueue.size(); ++i) {
+			AnimationData* data = animationQueue[i];
+			if (!data) continue;
 			if (!animations) animations = new MultiInstance();
 			if (!animations->inited()) animations->add(data);
-			++itAnim;
 		}
 	}
 
@@ -199,82 +264,248 @@ void RenderQueue::draw(Scene* scene, Camera* camera, Render* render, RenderState
 }
 
 void RenderQueue::animate(float velocity) {
-	for (int it = 0; it < animQueue->size; it++) {
-		AnimationNode* animateNode = (AnimationNode*)animQueue->get(it);
-		animateNode->animate(velocity);
+	JobSystem::jobSystem->parallelFor(animQueue->size, ANIMATE_GRAIN, [&](uint begin, uint end) {
+		for (uint it = begin; it < end; it++) {
+			AnimationNode* animateNode = (AnimationNode*)animQueue->get(it);
+			animateNode->animate(velocity);
+		}
+	});
+}
+
+void RenderQueue::setLod(float projScale, float midPixels, float lowPixels) {
+	lodProjScale = projScale;
+	lodMidPixels = midPixels;
+	lodLowPixels = lowPixels;
+}
+
+// Level by projected radius of object's bounding sphere, a threshold is 
+//   moved away from the object's last level so it does not flip at the border
+int RenderQueue::queryLod(Object* object, float e2oDisSqr) {
+	const vec4& box = object->boundInfo;
+	float radius = 0.5 * sqrtf(box.x * box.x + box.y * box.y + box.z * box.z);
+	float distance = sqrtf(e2oDisSqr);
+	int level = 0;
+	if (distance > radius) {
+		float pixels = radius * lodProjScale / distance;
+		int last = object->lodLevel;
+		float midBorder = lodMidPixels * (last > 0 ? 1.0 + LOD_HYSTERESIS : 1.0 - LOD_HYSTERESIS);
+		float lowBorder = lodLowPixels * (last > 1 ? 1.0 + LOD_HYSTERESIS : 1.0 - LOD_HYSTERESIS);
+		if (pixels < lowBorder) level = 2;
+		else if (pixels < midBorder) level = 1;
 	}
+	object->lodLevel = level;
+	return level;
 }
 
-Mesh* RenderQueue::queryLodMesh(Object* object, const vec3& eye) {
-	Mesh* mesh = object->mesh;
-	float e2oDis = (eye - object->bounding->position).GetSquaredLength();
-	if (e2oDis > lowDistSqr) 
-		mesh = object->meshLow;
-	else if (e2oDis > midDistSqr) 
-		mesh = object->meshMid;
-	
-	return mesh;
+Mesh* RenderQueue::queryLodMesh(Object* object, int level) {
+	if (level == 2) return object->meshLow;
+	if (level == 1) return object->meshMid;
+	return object->mesh;
+}
+
+void RenderQueue::countLod(int level, Mesh* mesh) {
+	lodCounts[level]++;
+	triangles += (mesh->indexCount > 0 ? mesh->indexCount : mesh->vertexCount) / 3;
+}
+
+void InitQueueData(RenderQueue* queue, Scene* scene) {
+	if (queue->queueType == QUEUE_STATIC_SN || queue->queueType == QUEUE_STATIC_SM || 
+		queue->queueType == QUEUE_STATIC_SF || queue->queueType == QUEUE_STATIC) {
+		for (uint i = 0; i < scene->meshes.size(); ++i) {
+			Mesh* mesh = scene->meshes[i]->mesh;
+			InstanceData* insData = new InstanceData(mesh, scene->meshes[i]->object, scene->queryMeshCount(mesh), queue->arena);
+			if ((uint)mesh->meshId >= queue->instanceQueue.size()) 
+				queue->instanceQueue.resize(mesh->meshId + 1, NULL);
+			queue->instanceQueue[mesh->meshId] = insData;
+		}
+	} else if (queue->queueType == QUEUE_ANIMATE_SN || queue->queueType == QUEUE_ANIMATE_SM || 
+			queue->queueType == QUEUE_ANIMATE_SF || queue->queueType == QUEUE_ANIMATE) {
+		for (uint i = 0; i < scene->anims.size(); ++i) {
+			Animation* anim = scene->anims[i];
+			AnimationData* animData = new AnimationData(anim, scene->queryAnimCount(anim), queue->arena);
+			if ((uint)anim->animationId >= queue->animationQueue.size()) 
+				queue->animationQueue.resize(anim->animationId + 1, NULL);
+			queue->animationQueue[anim->animationId] = animData;
+		}
+	}
+	queue->firstFlush = false;
 }
 
-void PushNodeToQueue(RenderQueue* queue, Scene* scene, Node* node, Camera* camera, Camera* mainCamera) {
-	if (queue->firstFlush) {
-		if (queue->queueType == QUEUE_STATIC_SN || queue->queueType == QUEUE_STATIC_SM || 
-			queue->queueType == QUEUE_STATIC_SF || queue->queueType == QUEUE_STATIC) {
-			for (uint i = 0; i < scene->meshes.size(); ++i) {
-				Mesh* mesh = scene->meshes[i]->mesh;
-				Object* object = scene->meshes[i]->object;
-				InstanceData* insData = new InstanceData(mesh, object, scene->queryMeshCount(mesh));
-				queue->instanceQueue.insert(pair<Mesh*, InstanceData*>(mesh, insData));
+// Return the bits of mask whose camera sees node index of tree, 
+//   insideMask: cameras known to contain the node on input, cameras containing it on output
+uint CheckNodeInCameras(FlatTree* tree, int index, Camera** cameras, uint count, uint mask, uint& insideMask) {
+	uint visible = 0, inside = 0;
+	for (uint i = 0; i < count; ++i) {
+		uint bit = 1 << i;
+		if (!(mask & bit)) continue;
+		if (insideMask & bit) {
+			visible |= bit;
+			inside |= bit;
+			continue;
+		}
+		int result = tree->intersectsFrustum(index, cameras[i]->frustum);
+		if (result != FRUSTUM_OUTSIDE) visible |= bit;
+		if (result == FRUSTUM_INSIDE) inside |= bit;
+	}
+	insideMask = inside;
+	return visible;
+}
+
+// Culling result of the node being pushed, one per thread as cull jobs may share a bvh
+static thread_local BvhCull visible;
+
+// Job side, only writes node's caches & its objects' levels, so leaves may be culled in parallel
+void CullInstances(RenderQueue** queues, Camera** cameras, uint count, InstanceNode* node, Camera* mainCamera, uint mask, uint insideMask, std::vector<VisibleObject>& objects) {
+	const BVH* bvh = node->getBvh();
+	visible.reserve(bvh->getBoxCount());
+	uint shadowMask = 0, cachingMask = 0;
+	for (uint i = 0; i < count; ++i) {
+		if (!(mask & (1 << i))) continue;
+		if (queues[i]->shadowLevel > 0) shadowMask |= 1 << i;
+		if (insideMask & (1 << i))
+			bvh->collectAll(1 << i, &visible);
+		else if (!queues[i]->cfgArgs->coherentcull)
+			bvh->cull(cameras[i]->frustum, 1 << i, &visible);
+		else {
+			// Reuse last culling while camera stays in its margin, otherwise cull with margin again
+			VisibleCache* cache = node->getVisibleCache(queues[i]->queueType);
+			if (cache->valid && cache->version == node->getCullVersion() && cache->frustum.contains(cameras[i]->frustum)) {
+				if (cache->objects.size() > 0)
+					bvh->collectList(&cache->objects[0], cache->objects.size(), 1 << i, &visible);
+			} else {
+				cache->frustum.expand(cameras[i]->frustum, VISIBLE_MARGIN);
+				bvh->cull(&cache->frustum, 1 << i, &visible);
+				cachingMask |= 1 << i;
 			}
-		} else if (queue->queueType == QUEUE_ANIMATE_SN || queue->queueType == QUEUE_ANIMATE_SM || 
-				queue->queueType == QUEUE_ANIMATE_SF || queue->queueType == QUEUE_ANIMATE) {
-			map<Animation*, uint>::iterator it = scene->animCount.begin();
-			while (it != scene->animCount.end()) {
-				Animation* anim = it->first;
-				AnimationData* animData = new AnimationData(anim, it->second);
-				queue->animationQueue.insert(pair<Animation*, AnimationData*>(anim, animData));
-				++it;
+		}
+	}
+
+	for (uint i = 0; cachingMask && i < count; ++i) {
+		if (!(cachingMask & (1 << i))) continue;
+		VisibleCache* cache = node->getVisibleCache(queues[i]->queueType);
+		cache->objects.clear();
+		for (int k = 0; k < visible.visibleCount; ++k) {
+			if (visible.masks[visible.visibleList[k]] & (1 << i))
+				cache->objects.push_back(visible.visibleList[k]);
+		}
+		cache->version = node->getCullVersion();
+		cache->valid = true;
+	}
+
+	for (int k = 0; k < visible.visibleCount; ++k) {
+		int j = visible.visibleList[k];
+		Object* object = node->objects[j];
+		uint objectMask = visible.masks[j];
+		if (!object->genShadow) objectMask &= ~shadowMask;
+		if (!objectMask) continue;
+
+		// Queues share lod settings, so one level from main camera for all of them
+		float e2oDis = (mainCamera->position - object->bounding->position).GetSquaredLength();
+		int level = queues[0]->queryLod(object, e2oDis);
+		objects.push_back(VisibleObject(object, objectMask, level));
+	}
+	visible.reset();
+}
+
+void PushInstancesToQueues(RenderQueue** queues, uint count, const std::vector<VisibleObject>& objects) {
+	for (uint k = 0; k < objects.size(); ++k) {
+		const VisibleObject& visibleObject = objects[k];
+		Object* object = visibleObject.object;
+		for (uint i = 0; i < count; ++i) {
+			if (!(visibleObject.mask & (1 << i))) continue;
+			RenderQueue* queue = queues[i];
+			Mesh* mesh = queue->queryLodMesh(object, visibleObject.level);
+			if (!mesh) continue;
+			if (queue->shadowLevel > 0 && !mesh->drawShadow) continue;
+			uint id = mesh->meshId;
+			if (id < queue->instanceQueue.size() && queue->instanceQueue[id]) {
+				queue->instanceQueue[id]->addInstance(object);
+				queue->countLod(visibleObject.level, mesh);
 			}
 		}
-		queue->firstFlush = false;
 	}
+}
+
+void PushLeafToQueues(RenderQueue** queues, uint count, Scene* scene, Node* child, uint childMask, const std::vector<VisibleObject>& objects) {
+	if (child->type != TYPE_INSTANCE && child->type != TYPE_STATIC && child->type != TYPE_ANIMATE) {
+		for (uint i = 0; i < count; ++i) {
+			if (childMask & (1 << i))
+				queues[i]->push(child);
+		}
+	} else if (child->type == TYPE_INSTANCE)
+		PushInstancesToQueues(queues, count, objects);
+	else if (child->type == TYPE_ANIMATE) {
+		AnimationNode* animNode = (AnimationNode*)child;
+		Animation* anim = animNode->getObject()->animation;
+		for (uint i = 0; i < count; ++i) {
+			if (!(childMask & (1 << i))) continue;
+			RenderQueue* queue = queues[i];
+			queue->pushAnim(child);
+			uint id = anim->animationId;
+			if (id < queue->animationQueue.size() && queue->animationQueue[id])
+				queue->animationQueue[id]->addAnimObject(animNode->getObject());
+			if (!queue->cfgArgs->dualthread)
+				animNode->animate(scene->velocity);
+		}
+	}
+}
 
-	if (node->checkInCamera(camera)) {
-		for (unsigned int i = 0; i<node->children.size(); ++i) {
-			Node* child = node->children[i];
-			if (child->objects.size() <= 0)
-				PushNodeToQueue(queue, scene, child, camera, mainCamera);
-			else {
-				if (child->shadowLevel < queue->shadowLevel) continue;
-
-				if (child->checkInCamera(camera)) {
-					if (child->type != TYPE_INSTANCE && child->type != TYPE_STATIC && child->type != TYPE_ANIMATE)
-						queue->push(child);
-					else if (child->type == TYPE_INSTANCE) {
-						for (uint j = 0; j < child->objects.size(); ++j) {
-							Object* object = child->objects[j];
-							if (queue->shadowLevel > 0 && !object->genShadow) continue;
-							if (object->checkInCamera(camera)) {
-								Mesh* mesh = queue->queryLodMesh(object, mainCamera->position);
-								if (!mesh) continue;
-								if (queue->shadowLevel > 0 && !mesh->drawShadow) continue;
-								InstanceData* insData = queue->instanceQueue[mesh];
-								insData->addInstance(object);
-							}
-						}
-					} else if (child->type == TYPE_ANIMATE) {
-						if (child->objects.size() > 0) {
-							queue->pushAnim(child);
-							AnimationNode* animNode = (AnimationNode*)child;
-							Animation* anim = animNode->getObject()->animation;
-							AnimationData* animData = queue->animationQueue[anim];
-							animData->addAnimObject(animNode->getObject());
-							if(!queue->cfgArgs->dualthread)
-								animNode->animate(scene->velocity);
-						}
-					} 
-				}
+void PushNodeToQueues(RenderQueue** queues, Camera** cameras, uint count, Scene* scene, FlatTree* tree, Camera* mainCamera) {
+	for (uint i = 0; i < count; ++i) {
+		if (queues[i]->firstFlush)
+			InitQueueData(queues[i], scene);
+	}
+
+	tree->update();
+	tree->visibleLeaves.clear();
+	uint insideMask = 0;
+	uint mask = CheckNodeInCameras(tree, 0, cameras, count, (1 << count) - 1, insideMask);
+	if (!mask) return;
+	tree->visibleMasks[0] = mask;
+	tree->insideMasks[0] = insideMask;
+
+	// Pre-order walk, a culled node jumps over its subtree
+	int size = tree->size();
+	for (int n = 1; n < size;) {
+		int parent = tree->parents[n];
+		uint parentMask = tree->visibleMasks[parent];
+		uint childInside = tree->insideMasks[parent];
+		if (!tree->leaves[n]) {
+			uint childMask = CheckNodeInCameras(tree, n, cameras, count, parentMask, childInside);
+			if (!childMask) {
+				n = tree->skips[n];
+				continue;
 			}
+			tree->visibleMasks[n] = childMask;
+			tree->insideMasks[n] = childInside;
+			n++;
+			continue;
+		}
+
+		uint shadowMask = 0;
+		for (uint i = 0; i < count; ++i) {
+			if ((parentMask & (1 << i)) && tree->shadowLevels[n] >= queues[i]->shadowLevel)
+				shadowMask |= 1 << i;
+		}
+		uint childMask = CheckNodeInCameras(tree, n, cameras, count, shadowMask, childInside);
+		if (childMask)
+			tree->visibleLeaves.push_back(VisibleLeaf(n, childMask, childInside));
+		n = tree->skips[n];
+	}
+
+	JobSystem::jobSystem->parallelFor(tree->visibleLeaves.size(), CULL_GRAIN, [&](uint begin, uint end) {
+		for (uint k = begin; k < end; k++) {
+			const VisibleLeaf& leaf = tree->visibleLeaves[k];
+			Node* node = tree->nodes[leaf.index];
+			if (node->type != TYPE_INSTANCE) continue;
+			std::vector<VisibleObject>& objects = tree->leafObjects[leaf.index];
+			objects.clear();
+			CullInstances(queues, cameras, count, (InstanceNode*)node, mainCamera, leaf.mask, leaf.inside, objects);
 		}
+	});
+
+	for (uint k = 0; k < tree->visibleLeaves.size(); k++) {
+		const VisibleLeaf& leaf = tree->visibleLeaves[k];
+		PushLeafToQueues(queues, count, scene, tree->nodes[leaf.index], leaf.mask, tree->leafObjects[leaf.index]);
 	}
-}
\ No newline at end of file
+}
@@ -3,12 +3,14 @@
 
 #include "render.h"
 #include "../node/node.h"
+#include "../node/flatTree.h"
 #include <stdlib.h>
 #include <string.h>
 #include "../instance/instance.h"
 #include "../instance/multiInstance.h"
 #include "../batch/batch.h"
 #include "../animation/animationData.h"
+#include "../util/arena.h"
 
 #ifndef QUEUE_STATIC
 #define QUEUE_STATIC_SN 0
@@ -21,31 +23,57 @@
 #define QUEUE_ANIMATE 7
 #endif
 
+// Sort key from high bits to low: layer 1 | shader 15 | material 16 | depth 16 | mesh 16,
+//   blended layer is layer | inverted depth | shader | material | mesh to draw back to front,
+//   shader is dense id of bound shader (SHADER_ID_BITS) with pass (4 bits), 
+//   material is folded material set of drawcall
+#define SORT_LAYER_OPAQUE 0
+#define SORT_LAYER_BLEND 1
+
+// World distance camera frustums are grown by for cached instance culling
+#define VISIBLE_MARGIN 16.0
+
+// Least animation nodes one job animates
+#define ANIMATE_GRAIN 16
+
+// Least visible leaves one job culls instances of
+#define CULL_GRAIN 4
+
+// Detail levels of mesh, meshMid & meshLow
+#define LOD_LEVELS 3
+// Part of a threshold an object's projected size must pass it by to change level
+#define LOD_HYSTERESIS 0.15
+
+// Nodes of one frame, storage comes from frame arena and is dropped on flush
 struct Queue {
 	Node** data;
 	int capacity, size;
-	Queue(int count) {
+	FrameArena* arena;
+	Queue(int count, FrameArena* frameArena) {
+		arena = frameArena;
 		capacity = count;
-		data = (Node**)malloc(capacity*sizeof(Node*));
+		data = arena->allocArray<Node*>(capacity);
 		size = 0;
 	}
 	~Queue() {
-		free(data); data = NULL;
+		data = NULL;
 	}
 	void push(Node* node) {
 		size++;
 		if (size > capacity) {
 			int capacityBefore = capacity;
-			capacity += 10;
-			Node** tmp = (Node**)malloc(capacity*sizeof(Node*));
-			memcpy(tmp, data, capacityBefore * sizeof(Node*));
-			free(data);
+			capacity = capacity > 0 ? capacity * 2 : 16;
+			Node** tmp = arena->allocArray<Node*>(capacity);
+			if (capacityBefore > 0) memcpy(tmp, data, capacityBefore * sizeof(Node*));
 			data = tmp;
 		}
 		*(data + size - 1) = node;
 	}
+	// Call before arena reset
 	void flush() {
 		size = 0;
+		capacity = 0;
+		data = NULL;
 	}
 	Node* get(int i) {
 		if (i < size)
@@ -58,15 +86,20 @@ class RenderQueue {
 private:
 	Queue* queue;
 	Queue* animQueue;
+	uint stateChanges, stateChangesAvoided; // Of static nodes since last flush
+	uint lodCounts[LOD_LEVELS], triangles; // Of instances pushed since last flush
 private:
 	void pushDatasToInstance(Scene* scene, InstanceData* data, bool copy);
+	void drawNodes(Camera* camera, Render* render, RenderState* state, Shader* terrainShader);
 	void pushDatasToBatch(BatchData* data, int pass);
 public:
 	ConfigArg* cfgArgs;
+	FrameArena* arena;
 	int queueType;
-	float midDistSqr, lowDistSqr;
-	std::map<Mesh*, InstanceData*> instanceQueue;
-	std::map<Animation*, AnimationData*> animationQueue;
+	float lodProjScale; // Pixels a world unit spans at distance 1 from main camera
+	float lodMidPixels, lodLowPixels; // Projected radius below which objects use mid & low mesh
+	std::vector<InstanceData*> instanceQueue; // Indexed by mesh id, NULL if unused
+	std::vector<AnimationData*> animationQueue; // Indexed by animation id, NULL if unused
 	MultiInstance* multiInstance;
 	MultiInstance* billboards;
 	MultiInstance* animations;
@@ -74,7 +107,7 @@ public:
 	int shadowLevel;
 	bool firstFlush;
 public:
-	RenderQueue(int type, float midDis, float lowDis);
+	RenderQueue(int type, float midPixels, float lowPixels, FrameArena* frameArena);
 	~RenderQueue();
 	void push(Node* node);
 	void pushAnim(Node* node);
@@ -82,10 +115,19 @@ public:
 	void deleteInstance(InstanceData* data);
 	void draw(Scene* scene, Camera* camera, Render* render, RenderState* state);
 	void animate(float velocity);
-	Mesh* queryLodMesh(Object* object, const vec3& eye);
+	void setLod(float projScale, float midPixels, float lowPixels);
+	int queryLod(Object* object, float e2oDisSqr);
+	Mesh* queryLodMesh(Object* object, int level);
+	void countLod(int level, Mesh* mesh);
 	void setCfg(ConfigArg* cfg) { cfgArgs = cfg; }
+	uint getStateChanges() { return stateChanges; }
+	uint getStateChangesAvoided() { return stateChangesAvoided; }
+	uint getLodCount(int level) { return lodCounts[level]; }
+	uint getTriangles() { return triangles; }
 };
 
-void PushNodeToQueue(RenderQueue* queue, Scene* scene, Node* node, Camera* camera, Camera* mainCamera);
+// Cull tree against all cameras in one traversal, cameras[i] feeds queues[i].
+//   Instances of visible leaves are culled by jobs, then pushed in tree order
+void PushNodeToQueues(RenderQueue** queues, Camera** cameras, uint count, Scene* scene, FlatTree* tree, Camera* mainCamera);
 
 #endif
@@ -1,5 +1,6 @@
 #include "shaderscontainer.h"
 #include "../shader/textfile.h"
+#include "../instance/instanceBuffer.h"
 using namespace std;
 
 #define SHADOW_TEX_FRAG "shader/shadow_tex.frag"
@@ -187,6 +188,7 @@ void SetupShaders(ShaderManager* shaders, const ConfigArg* cfgs) {
 	Shader* multi = shaders->addShader("multi", MULTI_COMP);
 	multi->attachDef("WORKGROUP_SIZE", to_string(WORKGROUPE_SIZE).data());
 	multi->attachDef("MAX_DISPATCH", to_string(MAX_DISPATCH).data());
+	multi->attachDef("INSTANCE_SLOT_BITS", to_string(INSTANCE_SLOT_BITS).data());
 
 	Shader* animMulti = shaders->addShader("animMulti", MULTI_COMP);
 	animMulti->attachDef("WORKGROUP_SIZE", to_string(WORKGROUPE_SIZE).data());
@@ -196,6 +198,7 @@ void SetupShaders(ShaderManager* shaders, const ConfigArg* cfgs) {
 	Shader* multiShadow = shaders->addShader("multi_s", MULTI_COMP);
 	multiShadow->attachDef("WORKGROUP_SIZE", to_string(WORKGROUPE_SIZE).data());
 	multiShadow->attachDef("MAX_DISPATCH", to_string(MAX_DISPATCH).data());
+	multiShadow->attachDef("INSTANCE_SLOT_BITS", to_string(INSTANCE_SLOT_BITS).data());
 	multiShadow->attachDef("ShadowPass", "1.0");
 
 	Shader* animMultiShadow = shaders->addShader("animMulti_s", MULTI_COMP);
@@ -30,6 +30,7 @@ StaticDrawcall::StaticDrawcall(Batch* batch) :Drawcall() {
 	indexCount = batchRef->indexCount;
 	objectCount = batchRef->objectCount;
 	setFullStatic(batchRef->fullStatic);
+	materialSet = batchRef->materialSet;
 
 	dynDC = batchRef->isDynamic();
 	vertCount = dynDC ? MAX_VERTEX_COUNT : vertexCount;
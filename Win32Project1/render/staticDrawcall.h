@@ -28,6 +28,7 @@ private:
 	GLenum drawType;
 public:
 	int vertexCntToPrepare, indexCntToPrepare, objectCntToPrepare;
+	u64 materialSet; // Of batch, materials this drawcall samples
 private:
 	RenderBuffer* createBuffers(Batch* batch, int bufCount, int vertCount, int indCount, GLenum drawType, RenderBuffer* dupBuf);
 	void flushMatricesToPrepare();
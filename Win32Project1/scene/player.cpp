@@ -3,29 +3,42 @@
 #include "../util/util.h"
 #include "../input/input.h"
 #include "../camera/camera.h"
+#include "scene.h"
 
 Player::Player() {
-	node = NULL;
+	nodeHandle = INVALID_HANDLE;
 	moveAnim = false;
 	doRotate = false, doTurn = false;
 	doMove = false;
 	fxAngle = 0.0, fyAngle = 0.0;
 	exAngle = 0.0;
 	position = vec3(0.0, 0.0, 0.0);
+	angleX = 0.0, angleZ = 0.0;
+	focus = vec3(0.0, 0.0, 0.0);
+	scene = NULL;
 	camera = NULL;
 	zoom = 10.0;
 	speed = 0.0;
 	atkPres = false, defPres = false;
 }
 
-void Player::setNode(AnimationNode* n, Camera* cam) { 
-	if (node != n) {
-		node = n;
+void Player::setNode(AnimationNode* n, Scene* s) { 
+	uint handle = n ? n->handle : INVALID_HANDLE;
+	if (nodeHandle != handle) {
+		nodeHandle = handle;
+		AnimationNode* node = n;
 		if (node) {
+			scene = s;
 			fxAngle = node->getObject()->angley;
 			fyAngle = 0.0;
+			angleX = node->getObject()->anglex;
+			angleZ = node->getObject()->anglez;
 			position = node->position;
-			camera = cam;
+			float* transforms = node->getObject()->transforms;
+			focus.x = transforms[0] - position.x;
+			focus.y = transforms[1] + ((AABB*)node->boundingBox)->sizey - groundY(position.x, position.z);
+			focus.z = transforms[2] - position.z;
+			camera = s->mainCamera;
 			zoom = 10.0;
 			speed = 0.0;
 			atkPres = false, defPres = false;
@@ -38,6 +51,7 @@ void Player::setNode(AnimationNode* n, Camera* cam) {
 }
 
 void Player::run(int dir) {
+	AnimationNode* node = getNode();
 	if (node) {
 		if ((node->getObject()->isEnd() && !node->getObject()->isPlayOnce()) || node->getObject()->isDefaultAnim()) {
 			node->getObject()->resetTime();
@@ -75,6 +89,7 @@ void Player::run(int dir) {
 }
 
 void Player::idel() {
+	AnimationNode* node = getNode();
 	if (node) {
 		node->getObject()->setMoving(false);
 		if (moveAnim) {
@@ -86,6 +101,7 @@ void Player::idel() {
 }
 
 void Player::switchAct(int target, bool once) {
+	AnimationNode* node = getNode();
 	if (node) {
 		int before = node->getObject()->aid;
 		node->getObject()->setMoving(false);
@@ -97,30 +113,32 @@ void Player::switchAct(int target, bool once) {
 }
 
 void Player::resetPlayOnce() {
+	AnimationNode* node = getNode();
 	if (node) node->getObject()->setPlayOnce(false);
 }
 
 void Player::attack() {
-	if (node) switchAct(2, false);
+	if (getNode()) switchAct(2, false);
 }
 
 void Player::defend() {
-	if (node) switchAct(4, true);
+	if (getNode()) switchAct(4, true);
 }
 
 void Player::crit() {
-	if (node) switchAct(17, false);
+	if (getNode()) switchAct(17, false);
 }
 
 void Player::kick() {
-	if (node) switchAct(16, false);
+	if (getNode()) switchAct(16, false);
 }
 
 void Player::jump() {
-	if (node) switchAct(3, false);
+	if (getNode()) switchAct(3, false);
 }
 
 void Player::turn(bool lr, float angle) {
+	AnimationNode* node = getNode();
 	if (node) {
 		if (lr) {
 			float dAngle = fxAngle + angle;
@@ -146,9 +164,10 @@ void Player::resetExAngle() {
 }
 
 bool Player::rotateAct() {
+	AnimationNode* node = getNode();
 	if (doRotate) {
 		if (node)
-			node->rotateNodeObject(node->getObject()->anglex, fxAngle + exAngle, node->getObject()->anglez);
+			scene->queueRotateObject(node, node->getObject(), angleX, fxAngle + exAngle, angleZ);
 		doRotate = false;
 		if(!doTurn) return false;
 		else {
@@ -159,12 +178,12 @@ bool Player::rotateAct() {
 	return false;
 }
 
-bool Player::moveAct(const Scene* scene) {
+bool Player::moveAct() {
+	AnimationNode* node = getNode();
 	if (doMove) {
 		if (node) {
-			node->translateNode(position.x, position.y, position.z);
-			scene->terrainNode->standObjectsOnGround(node);
-			position = node->position;
+			scene->queueTranslateNode(node, position.x, position.y, position.z);
+			scene->queueStandNode(node);
 		}
 		doMove = false;
 		return true;
@@ -172,18 +191,30 @@ bool Player::moveAct(const Scene* scene) {
 	return false;
 }
 
+// Terrain triangles are not changed after loading, so any thread can read them
+float Player::groundY(float x, float z) {
+	float y = 0.0;
+	if (scene && scene->terrainNode) {
+		int bx, bz;
+		scene->terrainNode->caculateBlock(x, z, bx, bz);
+		scene->terrainNode->cauculateY(bx, bz, x, z, y);
+	}
+	return y;
+}
+
 void Player::cameraAct() {
+	AnimationNode* node = getNode();
 	if (!camera || !node) return;
 	vec4 pDir = rotateY(fxAngle) * rotateX(fyAngle) * UNIT_NEG_Z;
 	vec3 dir = vec3(pDir.x, pDir.y, pDir.z).GetNormalized() * zoom;
-	float gx = node->getObject()->transformsFull[0];
-	float gy = node->getObject()->transformsFull[1] + ((AABB*)node->boundingBox)->sizey;
-	float gz = node->getObject()->transformsFull[2];
+	float gx = position.x + focus.x;
+	float gy = groundY(position.x, position.z) + focus.y;
+	float gz = position.z + focus.z;
 	vec3 pos = vec3(gx, gy, gz) - dir;
 	camera->setView(pos, dir);
 }
 
-void Player::keyDown(Input* input, const Scene* scene) { 
+void Player::keyDown(Input* input, Scene* scene) { 
 	int cid = -2;
 	if (input->getBoards()[KEY_1]) cid = 1;
 	if (input->getBoards()[KEY_2]) cid = 2;
@@ -192,18 +223,20 @@ void Player::keyDown(Input* input, const Scene* scene) {
 	if (cid > -2) {
 		input->setControl(cid);
 		if(cid < 0) setNode(NULL, NULL);
-		else setNode(scene->animPlayers[cid], scene->mainCamera);
+		else setNode(scene->animPlayers[cid], scene);
 	}
 }
 
 void Player::keyUp(Input* input) {
+	AnimationNode* node = getNode();
 	if (!node) return;
 	if (!input->getBoards()[KEY_W] && !input->getBoards()[KEY_S] && !input->getBoards()[KEY_A] && !input->getBoards()[KEY_D] &&
 		!input->getBoards()[KEY_R] && !input->getBoards()[KEY_F] && !input->getBoards()[KEY_SPACE] && !atkPres && !defPres)
 			idel();
 }
 
-void Player::controlAct(Input* input, const Scene* scene, const float velocity) {
+void Player::controlAct(Input* input, const float velocity) {
+	AnimationNode* node = getNode();
 	if (!node) return;
 
 	speed = velocity;
@@ -237,7 +270,7 @@ void Player::controlAct(Input* input, const Scene* scene, const float velocity)
 		resetExAngle();
 
 	bool isRotate = rotateAct();
-	bool isMove = moveAct(scene);
+	bool isMove = moveAct();
 	if(isMove || isRotate)
 		cameraAct();
 
@@ -252,6 +285,7 @@ void Player::controlAct(Input* input, const Scene* scene, const float velocity)
 }
 
 void Player::mousePress(bool press, bool isMain) {
+	AnimationNode* node = getNode();
 	if (!node) return;
 	if (press) {
 		if (isMain) atkPres = true;
@@ -264,6 +298,7 @@ void Player::mousePress(bool press, bool isMain) {
 }
 
 void Player::mouseAct(const float mouseX, const float mouseY, const float centerX, const float centerY) {
+	AnimationNode* node = getNode();
 	if (!node) return;
 	if (mouseX == centerX && mouseY == centerY) return;
 
@@ -281,6 +316,7 @@ void Player::mouseAct(const float mouseX, const float mouseY, const float center
 }
 
 void Player::wheelAct(float dz) {
+	AnimationNode* node = getNode();
 	if (!node) return;
 	zoom += dz;
 	if (zoom < 5.0) zoom = 5.0;
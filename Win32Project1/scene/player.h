@@ -8,10 +8,13 @@ class Camera;
 
 class Player {
 private:
-	AnimationNode* node;
+	uint nodeHandle; // Controlled node, may be deleted while held
 	bool moveAnim, doRotate, doTurn, doMove;
 	float fxAngle, fyAngle, exAngle;
-	vec3 position;
+	vec3 position; // Where node is sent to, node itself is changed by scene commands
+	float angleX, angleZ;
+	vec3 focus; // Camera target from node position & ground below it
+	Scene* scene;
 	Camera* camera;
 	float zoom, speed;
 	bool atkPres, defPres;
@@ -28,16 +31,17 @@ private:
 	void turn(bool lr, float angle);
 	void resetExAngle();
 	bool rotateAct();
-	bool moveAct(const Scene* scene);
+	bool moveAct();
+	float groundY(float x, float z);
 	void cameraAct();
 public:
 	Player();
 	~Player() {}
-	void setNode(AnimationNode* n, Camera* cam);
-	AnimationNode* getNode() { return node; }
-	void keyDown(Input* input, const Scene* scene);
+	void setNode(AnimationNode* n, Scene* s);
+	AnimationNode* getNode() { return (AnimationNode*)Node::fromHandle(nodeHandle); }
+	void keyDown(Input* input, Scene* scene);
 	void keyUp(Input* input);
-	void controlAct(Input* input, const Scene* scene, const float velocity);
+	void controlAct(Input* input, const float velocity);
 	void mouseAct(const float mouseX, const float mouseY, const float centerX, const float centerY);
 	void mousePress(bool press, bool isMain);
 	void wheelAct(float dz);
@@ -0,0 +1,255 @@
+#include "quadTree.h"
+#include "scene.h"
+#include <math.h>
+using namespace std;
+
+QuadCell::QuadCell(QuadTree* tree, QuadCell* superCell, float cx, float cz, float half, float minY, float maxY, int depth):
+		StaticNode(vec3(0, 0, 0)) {
+	type = TYPE_CELL;
+	this->tree = tree;
+	this->superCell = superCell;
+	for (int i = 0; i < 4; i++)
+		subCells[i] = NULL;
+	bucket = NULL;
+	centerX = cx;
+	centerZ = cz;
+	halfSize = half;
+	this->depth = depth;
+	float loose = half * 2.0;
+	((AABB*)boundingBox)->update(vec3(cx - loose, minY, cz - loose), vec3(cx + loose, maxY, cz + loose));
+}
+
+QuadCell::~QuadCell() {}
+
+bool QuadCell::fits(const BoundingBox* box) {
+	const AABB* aabb = (const AABB*)box;
+	if (fabsf(aabb->position.x - centerX) > halfSize || fabsf(aabb->position.z - centerZ) > halfSize)
+		return false;
+	return aabb->halfSize.x <= halfSize && aabb->halfSize.z <= halfSize;
+}
+
+int QuadCell::subCellIndex(const BoundingBox* box) {
+	int index = 0;
+	if (box->position.x >= centerX) index |= 1;
+	if (box->position.z >= centerZ) index |= 2;
+	return index;
+}
+
+// Content held by this cell only
+int QuadCell::getContentCount() {
+	int count = children.size();
+	if (!isLeaf()) count -= 4;
+	if (bucket) count += (int)bucket->objects.size() - 1;
+	return count;
+}
+
+// Content held by this cell and all its sub cells
+int QuadCell::getTotalCount() {
+	int count = getContentCount();
+	if (!isLeaf()) {
+		for (int i = 0; i < 4; i++)
+			count += subCells[i]->getTotalCount();
+	}
+	return count;
+}
+
+InstanceNode* QuadCell::getBucket() {
+	if (!bucket) {
+		bucket = new InstanceNode(vec3(0, 0, 0));
+		attachChild(bucket);
+	}
+	return bucket;
+}
+
+QuadTree::QuadTree(Scene* scene, const vec3& minBound, const vec3& maxBound) {
+	this->scene = scene;
+	minY = minBound.y;
+	maxY = maxBound.y;
+	float sizeX = maxBound.x - minBound.x, sizeZ = maxBound.z - minBound.z;
+	float half = (sizeX > sizeZ ? sizeX : sizeZ) * 0.5;
+	root = new QuadCell(this, NULL, minBound.x + sizeX * 0.5, minBound.z + sizeZ * 0.5, half, minY, maxY, 0);
+	nodesToRelocate.clear();
+}
+
+// Cells are children of scene's static root, and deleted with it
+QuadTree::~QuadTree() {
+	nodesToRelocate.clear();
+}
+
+bool QuadTree::insideHeight(const BoundingBox* box) {
+	const AABB* aabb = (const AABB*)box;
+	return aabb->minVertex.y >= minY && aabb->maxVertex.y <= maxY;
+}
+
+// Deepest cell from cell fitting box, split on the way if a leaf is full
+QuadCell* QuadTree::findCell(QuadCell* cell, const BoundingBox* box) {
+	while (true) {
+		if (cell->isLeaf()) {
+			if (cell->depth >= QUAD_MAX_DEPTH || cell->getContentCount() < QUAD_SPLIT_COUNT)
+				return cell;
+			split(cell);
+		}
+		QuadCell* sub = cell->subCells[cell->subCellIndex(box)];
+		if (!sub->fits(box)) return cell;
+		cell = sub;
+	}
+	return cell;
+}
+
+bool QuadTree::insertNode(Node* node) {
+	if (!node->boundingBox || !root->fits(node->boundingBox) || !insideHeight(node->boundingBox))
+		return false;
+	findCell(root, node->boundingBox)->attachChild(node);
+	return true;
+}
+
+bool QuadTree::insertObject(Object* object) {
+	object->caculateLocalAABB(false, false);
+	if (!object->bounding || !root->fits(object->bounding) || !insideHeight(object->bounding))
+		return false;
+	findCell(root, object->bounding)->getBucket()->addObject(scene, object);
+	return true;
+}
+
+// Reparent without touching node's bounding, all cells share the same transform
+void QuadTree::moveContent(Node* node, QuadCell* from, QuadCell* to) {
+	for (uint i = 0; i < from->children.size(); i++) {
+		if (from->children[i] == node) {
+			from->children.erase(from->children.begin() + i);
+			break;
+		}
+	}
+	to->children.push_back(node);
+	node->parent = to;
+	node->transformDirty = true;
+	Node::layoutVersion++;
+}
+
+void QuadTree::moveObject(Object* object, QuadCell* from, QuadCell* to) {
+	from->bucket->removeObject(object);
+	scene->removeObject(object);
+	to->getBucket()->addObject(scene, object);
+}
+
+void QuadTree::split(QuadCell* cell) {
+	float half = cell->halfSize * 0.5;
+	for (int i = 0; i < 4; i++) {
+		float cx = cell->centerX + ((i & 1) ? half : -half);
+		float cz = cell->centerZ + ((i & 2) ? half : -half);
+		cell->subCells[i] = new QuadCell(this, cell, cx, cz, half, minY, maxY, cell->depth + 1);
+		cell->attachChild(cell->subCells[i]);
+	}
+
+	vector<Node*> contents;
+	for (uint i = 0; i < cell->children.size(); i++) {
+		Node* child = cell->children[i];
+		if (child->type != TYPE_CELL && child != cell->bucket)
+			contents.push_back(child);
+	}
+	for (uint i = 0; i < contents.size(); i++) {
+		QuadCell* sub = cell->subCells[cell->subCellIndex(contents[i]->boundingBox)];
+		if (sub->fits(contents[i]->boundingBox))
+			moveContent(contents[i], cell, sub);
+	}
+
+	if (cell->bucket) {
+		vector<Object*> objects = cell->bucket->objects;
+		for (uint i = 0; i < objects.size(); i++) {
+			QuadCell* sub = cell->subCells[cell->subCellIndex(objects[i]->bounding)];
+			if (sub->fits(objects[i]->bounding))
+				moveObject(objects[i], cell, sub);
+		}
+	}
+}
+
+// Pull all content of sub cells up into cell and retire them
+void QuadTree::merge(QuadCell* cell) {
+	for (int i = 0; i < 4; i++) {
+		QuadCell* sub = cell->subCells[i];
+		if (!sub->isLeaf()) merge(sub);
+
+		vector<Node*> contents;
+		for (uint c = 0; c < sub->children.size(); c++) {
+			if (sub->children[c] != sub->bucket)
+				contents.push_back(sub->children[c]);
+		}
+		for (uint c = 0; c < contents.size(); c++)
+			moveContent(contents[c], sub, cell);
+		if (sub->bucket) {
+			vector<Object*> objects = sub->bucket->objects;
+			for (uint o = 0; o < objects.size(); o++)
+				moveObject(objects[o], sub, cell);
+		}
+
+		// Frames in flight or pending updates may still see the cell, 
+		//   so it is retired with removed nodes instead of deleted here
+		cell->detachChild(sub);
+		forget(sub->bucket);
+		sub->pushToRemove();
+		cell->subCells[i] = NULL;
+	}
+}
+
+void QuadTree::tryMerge(QuadCell* cell) {
+	while (cell) {
+		if (!cell->isLeaf() && cell->getTotalCount() < QUAD_MERGE_COUNT) 
+			merge(cell);
+		cell = cell->superCell;
+	}
+}
+
+void QuadTree::pushToRelocate(Node* node) {
+	nodesToRelocate.push_back(node);
+}
+
+void QuadTree::forget(Node* node) {
+	if (!node) return;
+	for (uint i = 0; i < nodesToRelocate.size(); i++) {
+		if (nodesToRelocate[i] == node)
+			nodesToRelocate[i] = NULL;
+	}
+}
+
+void QuadTree::relocateNode(Node* node) {
+	QuadCell* cell = (QuadCell*)node->parent;
+	if (cell->fits(node->boundingBox) && insideHeight(node->boundingBox)) return;
+
+	QuadCell* target = cell->superCell;
+	while (target && !target->fits(node->boundingBox))
+		target = target->superCell;
+	if (!target || !insideHeight(node->boundingBox)) { // Out of partition
+		cell->detachChild(node);
+		scene->staticRoot->attachChild(node);
+	} else
+		moveContent(node, cell, findCell(target, node->boundingBox));
+	tryMerge(cell);
+}
+
+void QuadTree::relocateBucket(QuadCell* cell) {
+	vector<Object*> objects = cell->bucket->objects;
+	for (uint i = 0; i < objects.size(); i++) {
+		Object* object = objects[i];
+		if (!object->bounding || (cell->fits(object->bounding) && insideHeight(object->bounding))) 
+			continue;
+		QuadCell* target = cell->superCell;
+		while (target && !target->fits(object->bounding))
+			target = target->superCell;
+		if (target && insideHeight(object->bounding))
+			moveObject(object, cell, findCell(target, object->bounding));
+	}
+	tryMerge(cell);
+}
+
+// Move content whose bounding changed to the cell it fits now, called once per frame
+void QuadTree::relocate() {
+	for (uint i = 0; i < nodesToRelocate.size(); i++) {
+		Node* node = nodesToRelocate[i];
+		if (!node || !node->parent || node->parent->type != TYPE_CELL) continue;
+		QuadCell* cell = (QuadCell*)node->parent;
+		if (node == cell->bucket) 
+			relocateBucket(cell);
+		else
+			relocateNode(node);
+	}
+	nodesToRelocate.clear();
+}
@@ -0,0 +1,62 @@
+#ifndef QUAD_TREE_H_
+#define QUAD_TREE_H_
+
+#include "../node/staticNode.h"
+#include "../node/instanceNode.h"
+
+#define QUAD_MAX_DEPTH 6
+#define QUAD_SPLIT_COUNT 16 // Leaf cell with more content splits
+#define QUAD_MERGE_COUNT 8 // Cell with less content in all its sub cells merges them
+
+class Scene;
+class QuadTree;
+
+// Loose cell, its bounding is twice the size of the area it covers, 
+//   content fits if its center is inside the area and it is not larger than the area
+class QuadCell: public StaticNode {
+public:
+	QuadTree* tree;
+	QuadCell* superCell;
+	QuadCell* subCells[4];
+	InstanceNode* bucket; // Objects inserted without a node of their own
+	float centerX, centerZ, halfSize;
+	int depth;
+public:
+	QuadCell(QuadTree* tree, QuadCell* superCell, float cx, float cz, float half, float minY, float maxY, int depth);
+	virtual ~QuadCell();
+	bool isLeaf() { return subCells[0] == NULL; }
+	bool fits(const BoundingBox* box);
+	int subCellIndex(const BoundingBox* box);
+	int getContentCount();
+	int getTotalCount();
+	InstanceNode* getBucket();
+};
+
+class QuadTree {
+private:
+	Scene* scene;
+	QuadCell* root;
+	float minY, maxY;
+	std::vector<Node*> nodesToRelocate;
+private:
+	bool insideHeight(const BoundingBox* box);
+	QuadCell* findCell(QuadCell* cell, const BoundingBox* box);
+	void moveContent(Node* node, QuadCell* from, QuadCell* to);
+	void moveObject(Object* object, QuadCell* from, QuadCell* to);
+	void split(QuadCell* cell);
+	void merge(QuadCell* cell);
+	void tryMerge(QuadCell* cell);
+	void relocateNode(Node* node);
+	void relocateBucket(QuadCell* cell);
+public:
+	QuadTree(Scene* scene, const vec3& minBound, const vec3& maxBound);
+	~QuadTree();
+	QuadCell* getRoot() { return root; }
+	bool insertNode(Node* node);
+	bool insertObject(Object* object);
+	void pushToRelocate(Node* node);
+	void relocate();
+	void forget(Node* node);
+};
+
+#endif
@@ -8,6 +8,8 @@
 #include "../mesh/model.h"
 #include "../mesh/terrain.h"
 #include "../object/staticObject.h"
+#include "../util/jobSystem.h"
+#include <chrono>
 using namespace std;
 
 Scene::Scene() {
@@ -21,10 +23,14 @@ Scene::Scene() {
 	terrainNode = NULL;
 	textureNode = NULL;
 	noise3d = NULL;
+	partition = NULL;
+	looseObjects = NULL;
 	
 	staticRoot = NULL;
 	billboardRoot = NULL;
 	animationRoot = NULL;
+	staticTree = NULL;
+	animationTree = NULL;
 	initNodes();
 	boundingNodes.clear();
 	meshCount.clear();
@@ -35,9 +41,31 @@ Scene::Scene() {
 	Node::nodesToUpdate.clear();
 	Node::nodesToRemove.clear();
 	Instance::instanceTable.clear();
+	commands = new SceneCommandQueue(SCENE_COMMAND_CAPACITY);
+	commandThread = std::this_thread::get_id();
+	retired.clear();
+	syncFrame = 0;
+	updateList.clear();
+	pendingList.clear();
+	chunkList.clear();
+	updateCost = 0.0;
+	updateBudget = 0.0;
 }
 
 Scene::~Scene() {
+	SceneCommand command;
+	while (commands->pop(command)) {
+		if (command.type == SCENE_CMD_ADD_OBJECT) delete Object::fromHandle(command.object);
+	}
+	delete commands;
+	for (uint i = 0; i < retired.size(); i++) {
+		if (retired[i].object) delete retired[i].object;
+		else delete Node::fromHandle(retired[i].node);
+	}
+	retired.clear();
+	Node::nodesToRemove.clear();
+	Node::nodesToUpdate.clear();
+
 	delete player;
 	if (mainCamera) delete mainCamera; mainCamera = NULL;
 	if (reflectCamera) delete reflectCamera; reflectCamera = NULL;
@@ -46,6 +74,9 @@ Scene::~Scene() {
 	if (terrainNode) delete terrainNode; terrainNode = NULL;
 	if (textureNode) delete textureNode; textureNode = NULL;
 	if (noise3d) delete noise3d; noise3d = NULL;
+	if (partition) delete partition; partition = NULL;
+	if (staticTree) delete staticTree; staticTree = NULL;
+	if (animationTree) delete animationTree; animationTree = NULL;
 	if (staticRoot) delete staticRoot; staticRoot = NULL;
 	if (billboardRoot) delete billboardRoot; billboardRoot = NULL;
 	if (animationRoot) delete animationRoot; animationRoot = NULL;
@@ -57,37 +88,261 @@ Scene::~Scene() {
 	anims.clear();
 	animPlayers.clear();
 	animCount.clear();
+	ReleasePools();
 }
 
 void Scene::initNodes() {
 	staticRoot = new StaticNode(vec3(0, 0, 0));
 	billboardRoot = new StaticNode(vec3(0, 0, 0));
 	animationRoot = new StaticNode(vec3(0, 0, 0));
+	staticTree = new FlatTree(staticRoot);
+	animationTree = new FlatTree(animationRoot);
 }
 
-void Scene::updateNodes() {
-	uint size = Node::nodesToUpdate.size();
-	if (size == 0) return;
-	for (uint i = 0; i < size; i++)
-		Node::nodesToUpdate[i]->updateNode();
-	Node::nodesToUpdate.clear();
+// Sync point of a frame: queued commands are applied, 
+//   then changed nodes are updated and removed ones retired,
+//   camera decides which updates may wait under budget
+void Scene::updateNodes(Camera* camera) {
+	applyCommands();
+	updateNodeList(camera, !partition);
+	if (partition) {
+		partition->relocate();
+		updateNodeList(camera, true); // Nodes moved to other cells
+	}
+	flushNodes();
+	syncFrame++;
+}
+
+// Node transforms & the upward bounds pass are serial since nodes share superiors,
+//   object bounds & transforms in between run as jobs in chunks of UPDATE_CHUNK objects,
+//   nodes put off in an earlier pass come back in the last one, which counts their deferred frames
+void Scene::updateNodeList(Camera* camera, bool lastPass) {
+	std::vector<Node*>& pending = pendingList;
+	pending.clear();
+	pending.swap(Node::nodesToUpdate);
+	if (pending.size() == 0) return;
+
+	// Resolve cached transforms of all changed nodes here, superiors first by recursion,
+	//   so that object jobs below and cull jobs later only read nodeTransform
+	for (uint i = 0; i < pending.size(); i++) {
+		if (pending[i]->type != TYPE_ANIMATE) 
+			pending[i]->getWorldTransform();
+	}
+
+	// Nodes in view or waiting too long go first, others only while budget lasts
+	updateList.clear();
+	uint objectCount = 0;
+	if (updateBudget <= 0.0 || !camera) {
+		updateList.swap(pending);
+		for (uint i = 0; i < updateList.size(); i++)
+			objectCount += updateList[i]->objects.size();
+	} else {
+		float budgetCount = updateCost > 0.0 ? updateBudget / updateCost : (float)UINT_MAX;
+		objectCount = SelectUpdates(pending, updateList, [camera](Node* node) { return node->checkInCamera(camera); }, budgetCount, lastPass);
+	}
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	std::vector<int>& chunks = chunkList;
+	chunks.clear();
+	for (uint i = 0; i < updateList.size(); i++) {
+		Node* node = updateList[i];
+		if (node->type == TYPE_ANIMATE) continue;
+		for (uint begin = 0; begin < node->objects.size(); begin += UPDATE_CHUNK) {
+			chunks.push_back(i);
+			chunks.push_back(begin);
+		}
+	}
+	uint chunkCount = chunks.size() / 2;
+	std::function<void(uint, uint)> updateChunks = [&](uint begin, uint end) {
+		for (uint c = begin; c < end; c++) {
+			Node* node = updateList[chunks[c * 2]];
+			int first = chunks[c * 2 + 1];
+			int last = first + UPDATE_CHUNK < (int)node->objects.size() ? first + UPDATE_CHUNK : node->objects.size();
+			node->updateNodeObjects(first, last);
+		}
+	};
+	if (JobSystem::jobSystem) 
+		JobSystem::jobSystem->parallelFor(chunkCount, 1, updateChunks);
+	else 
+		updateChunks(0, chunkCount);
+	for (uint i = 0; i < updateList.size(); i++)
+		updateList[i]->finishUpdate();
+
+	if (objectCount > 0) {
+		float cost = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / objectCount;
+		updateCost = updateCost > 0.0 ? updateCost * 0.9 + cost * 0.1 : cost;
+	}
+	updateList.clear();
+
+	// Deferred nodes keep needUpdateNode, so they are not pushed twice
+	Node::nodesToUpdate.insert(Node::nodesToUpdate.end(), pending.begin(), pending.end());
+	pending.clear();
 }
 
+// Delete removed nodes & objects once no frame prepared before their removal can be drawn
 void Scene::flushNodes() {
-	uint size = Node::nodesToRemove.size();
-	if (size == 0) return;
-	for (uint i = 0; i < size; i++)
-		delete Node::nodesToRemove[i];
+	for (uint i = 0; i < Node::nodesToRemove.size(); i++) {
+		Node* node = Node::fromHandle(Node::nodesToRemove[i]);
+		if (!node) continue;
+		if (partition) partition->forget(node);
+		retired.push_back(Retired(node->handle, NULL, syncFrame));
+	}
 	Node::nodesToRemove.clear();
+
+	uint kept = 0;
+	for (uint i = 0; i < retired.size(); i++) {
+		Retired& entry = retired[i];
+		if (syncFrame - entry.frame < SCENE_RETIRE_FRAMES) 
+			retired[kept++] = entry;
+		else if (entry.object) 
+			delete entry.object;
+		else 
+			delete Node::fromHandle(entry.node);
+	}
+	retired.resize(kept, Retired(0, NULL, 0));
+}
+
+// Any thread, applied at next sync point in push order of each thread
+void Scene::pushCommand(const SceneCommand& command) {
+	while (!commands->push(command)) {
+		// Full, the applying thread empties it itself, others wait for it
+		if (std::this_thread::get_id() == commandThread.load()) 
+			applyCommands();
+		else 
+			std::this_thread::yield();
+	}
+}
+
+// Only commands queued before this call, so steady producers can not hold it
+void Scene::applyCommands() {
+	commandThread = std::this_thread::get_id();
+	SceneCommand command;
+	for (uint i = 0; i < SCENE_COMMAND_CAPACITY && commands->pop(command); i++) 
+		applyCommand(command);
+}
+
+void Scene::applyCommand(const SceneCommand& command) {
+	Node* node = Node::fromHandle(command.node);
+	Object* object = Object::fromHandle(command.object);
+	if (!node) {
+		if (command.type == SCENE_CMD_ADD_OBJECT) delete object;
+		return;
+	}
+	switch (command.type) {
+		case SCENE_CMD_ADD_OBJECT:
+			if (object) node->addObject(this, object);
+			break;
+		case SCENE_CMD_REMOVE_OBJECT:
+			if (object && node->removeObject(object)) {
+				removeObject(object);
+				retired.push_back(Retired(0, object, syncFrame));
+			}
+			break;
+		case SCENE_CMD_TRANSLATE_OBJECT:
+		case SCENE_CMD_ROTATE_OBJECT:
+		case SCENE_CMD_SCALE_OBJECT: {
+				if (!object) break;
+				int i = object->nodeIndex;
+				if (i < 0 || i >= (int)node->objects.size() || node->objects[i] != object) break;
+				if (command.type == SCENE_CMD_TRANSLATE_OBJECT)
+					node->translateNodeObject(i, command.x, command.y, command.z);
+				else if (command.type == SCENE_CMD_ROTATE_OBJECT && node->type == TYPE_ANIMATE)
+					((AnimationNode*)node)->rotateNodeObject(command.x, command.y, command.z);
+				else if (command.type == SCENE_CMD_ROTATE_OBJECT)
+					node->rotateNodeObject(i, command.x, command.y, command.z);
+				else
+					node->scaleNodeObject(i, command.x, command.y, command.z);
+			}
+			break;
+		case SCENE_CMD_TRANSLATE_NODE:
+			node->translateNode(command.x, command.y, command.z);
+			break;
+		case SCENE_CMD_ATTACH_NODE: {
+				Node* child = Node::fromHandle(command.child);
+				if (child && !child->parent) node->attachChild(child);
+			}
+			break;
+		case SCENE_CMD_DETACH_NODE: {
+				Node* child = Node::fromHandle(command.child);
+				if (child) node->detachChild(child);
+			}
+			break;
+		case SCENE_CMD_REMOVE_NODE:
+			if (node->parent) node->parent->detachChild(node);
+			node->pushToRemove();
+			break;
+		case SCENE_CMD_STAND_NODE:
+			if (terrainNode) terrainNode->standObjectsOnGround(node);
+			break;
+	}
+}
+
+static SceneCommand MakeCommand(int type, Node* node, Object* object, float x, float y, float z) {
+	SceneCommand command;
+	command.type = type;
+	command.node = node->handle;
+	command.child = 0;
+	command.object = object ? object->handle : 0;
+	command.x = x, command.y = y, command.z = z;
+	return command;
+}
+
+// Scene takes object, it is deleted if node is gone before applied
+void Scene::queueAddObject(Node* node, Object* object) {
+	pushCommand(MakeCommand(SCENE_CMD_ADD_OBJECT, node, object, 0, 0, 0));
+}
+
+// Object is deleted a few frames after applied
+void Scene::queueRemoveObject(Node* node, Object* object) {
+	pushCommand(MakeCommand(SCENE_CMD_REMOVE_OBJECT, node, object, 0, 0, 0));
+}
+
+void Scene::queueTranslateObject(Node* node, Object* object, float x, float y, float z) {
+	pushCommand(MakeCommand(SCENE_CMD_TRANSLATE_OBJECT, node, object, x, y, z));
+}
+
+void Scene::queueRotateObject(Node* node, Object* object, float ax, float ay, float az) {
+	pushCommand(MakeCommand(SCENE_CMD_ROTATE_OBJECT, node, object, ax, ay, az));
+}
+
+void Scene::queueScaleObject(Node* node, Object* object, float sx, float sy, float sz) {
+	pushCommand(MakeCommand(SCENE_CMD_SCALE_OBJECT, node, object, sx, sy, sz));
+}
+
+void Scene::queueTranslateNode(Node* node, float x, float y, float z) {
+	pushCommand(MakeCommand(SCENE_CMD_TRANSLATE_NODE, node, NULL, x, y, z));
+}
+
+void Scene::queueAttachNode(Node* parent, Node* child) {
+	SceneCommand command = MakeCommand(SCENE_CMD_ATTACH_NODE, parent, NULL, 0, 0, 0);
+	command.child = child->handle;
+	pushCommand(command);
+}
+
+void Scene::queueDetachNode(Node* parent, Node* child) {
+	SceneCommand command = MakeCommand(SCENE_CMD_DETACH_NODE, parent, NULL, 0, 0, 0);
+	command.child = child->handle;
+	pushCommand(command);
 }
 
-void Scene::updateReflectCamera() {
+// Node is detached and deleted with its subtree a few frames after applied
+void Scene::queueRemoveNode(Node* node) {
+	pushCommand(MakeCommand(SCENE_CMD_REMOVE_NODE, node, NULL, 0, 0, 0));
+}
+
+// Puts node's objects on terrain after moves queued before it
+void Scene::queueStandNode(Node* node) {
+	pushCommand(MakeCommand(SCENE_CMD_STAND_NODE, node, NULL, 0, 0, 0));
+}
+
+// From snapshot of main camera the frame is culled with, copied into frame packet
+void Scene::updateReflectCamera(Camera* camera) {
 	if (water && reflectCamera) {
 		static mat4 transMat = scaleY(-1) * translate(0, water->position.y, 0);
-		reflectCamera->viewMatrix = mainCamera->viewMatrix * transMat;
-		reflectCamera->lookDir.x = mainCamera->lookDir.x;
-		reflectCamera->lookDir.y = -mainCamera->lookDir.y;
-		reflectCamera->lookDir.z = mainCamera->lookDir.z;
+		reflectCamera->viewMatrix = camera->viewMatrix * transMat;
+		reflectCamera->lookDir.x = camera->lookDir.x;
+		reflectCamera->lookDir.y = -camera->lookDir.y;
+		reflectCamera->lookDir.z = camera->lookDir.z;
 		reflectCamera->forceRefresh();
 		reflectCamera->updateFrustum();
 	}
@@ -178,52 +433,96 @@ void Scene::clearAllAABB() {
 	boundingNodes.clear();
 }
 
+// First use of a mesh registers it to meshes
+void Scene::countMesh(Mesh* mesh, Object* object, int delta) {
+	uint id = AssetManager::assetManager->assignMeshId(mesh);
+	if (id >= meshCount.size()) meshCount.resize(id + 1, -1);
+	if (meshCount[id] < 0) {
+		if (delta < 0) return;
+		meshCount[id] = 0;
+		meshes.push_back(new MeshObject(mesh, object));
+	}
+	meshCount[id] += delta;
+	if (meshCount[id] < 0) meshCount[id] = 0;
+}
+
+void Scene::countAnimation(Animation* anim, int delta) {
+	uint id = AssetManager::assetManager->assignAnimationId(anim);
+	if (id >= animCount.size()) animCount.resize(id + 1, -1);
+	if (animCount[id] < 0) {
+		if (delta < 0) return;
+		animCount[id] = 0;
+		anims.push_back(anim);
+	}
+	animCount[id] += delta;
+	if (animCount[id] < 0) animCount[id] = 0;
+}
+
 void Scene::addObject(Object* object) {
 	Mesh* cur = object->mesh;
-	if (cur) {
-		if (meshCount.find(cur) == meshCount.end()) {
-			meshCount[cur] = 0;
-			meshes.push_back(new MeshObject(cur, object));
-		}
-		meshCount[cur]++;
-	}
+	if (cur) 
+		countMesh(cur, object, 1);
 	cur = object->meshMid;
-	if (cur && cur != object->mesh) {
-		if (meshCount.find(cur) == meshCount.end()) {
-			meshCount[cur] = 0;
-			meshes.push_back(new MeshObject(cur, object));
-		}
-		meshCount[cur]++;
-	}
+	if (cur && cur != object->mesh) 
+		countMesh(cur, object, 1);
 	cur = object->meshLow;
-	if (cur && cur != object->meshMid && cur != object->mesh) {
-		if (meshCount.find(cur) == meshCount.end()) {
-			meshCount[cur] = 0;
-			meshes.push_back(new MeshObject(cur, object));
-		}
-		meshCount[cur]++;
-	}
+	if (cur && cur != object->meshMid && cur != object->mesh) 
+		countMesh(cur, object, 1);
 	// Animation object
 	if (!object->mesh) {
 		AnimationObject* animObj = (AnimationObject*)object;
-		if (animObj) {
-			Animation* curAnim = animObj->animation;
-			if (animCount.find(curAnim) == animCount.end()) {
-				animCount[curAnim] = 0;
-				anims.push_back(curAnim);
-			}
-			animCount[curAnim]++;
-		}
+		if (animObj) countAnimation(animObj->animation, 1);
 	}
 }
 
+void Scene::removeObject(Object* object) {
+	Mesh* cur = object->mesh;
+	if (cur) 
+		countMesh(cur, object, -1);
+	cur = object->meshMid;
+	if (cur && cur != object->mesh) 
+		countMesh(cur, object, -1);
+	cur = object->meshLow;
+	if (cur && cur != object->meshMid && cur != object->mesh) 
+		countMesh(cur, object, -1);
+	if (!object->mesh) 
+		countAnimation(((AnimationObject*)object)->animation, -1);
+}
+
+// Partition static content in a loose quadtree, content outside bounds stays in staticRoot
+void Scene::createPartition(const vec3& minBound, const vec3& maxBound) {
+	if (partition) return;
+	partition = new QuadTree(this, minBound, maxBound);
+	staticRoot->attachChild(partition->getRoot());
+}
+
+void Scene::insertNode(Node* node) {
+	if (partition && partition->insertNode(node)) return;
+	staticRoot->attachChild(node);
+}
+
+void Scene::insertObject(Object* object) {
+	if (partition && partition->insertObject(object)) return;
+	if (!looseObjects) {
+		looseObjects = new InstanceNode(vec3(0, 0, 0));
+		staticRoot->attachChild(looseObjects);
+	}
+	looseObjects->addObject(this, object);
+}
+
 void Scene::addPlay(AnimationNode* node) {
 	animPlayers.push_back(node);
 }
 
 uint Scene::queryMeshCount(Mesh* mesh) {
-	if (meshCount.find(mesh) == meshCount.end())
-		meshCount[mesh] = 0;
-	return meshCount[mesh];
+	if (mesh->meshId < 0 || mesh->meshId >= (int)meshCount.size() || meshCount[mesh->meshId] < 0) 
+		return 0;
+	return meshCount[mesh->meshId];
+}
+
+uint Scene::queryAnimCount(Animation* anim) {
+	if (anim->animationId < 0 || anim->animationId >= (int)animCount.size() || animCount[anim->animationId] < 0) 
+		return 0;
+	return animCount[anim->animationId];
 }
 
@@ -14,26 +14,59 @@
 #include "../node/instanceNode.h"
 #include "../sky/sky.h"
 #include "player.h"
+#include "quadTree.h"
+#include "../node/flatTree.h"
+#include "../render/framePipeline.h"
+#include "sceneCommand.h"
+#include "updateSelect.h"
+#include <thread>
+
+// Frames a removed node or object is kept after removal, prepared frames may still draw it
+#define SCENE_RETIRE_FRAMES MAX_FRAME_DEPTH
+// Objects of a node updated by one job
+#define UPDATE_CHUNK 256
 
 struct MeshObject {
 	Mesh* mesh;
+	uint object; // Handle of an object using mesh
+	MeshObject(Mesh* m, Object* o) :mesh(m), object(o->handle) {}
+};
+
+// Removed node or object waiting to be deleted
+struct Retired {
+	uint node; // Handle, 0 if object
 	Object* object;
-	MeshObject(Mesh* m, Object* o) :mesh(m), object(o) {}
+	uint frame; // Sync frame it was removed at
+	Retired(uint n, Object* o, uint f) :node(n), object(o), frame(f) {}
 };
 
 class Scene {
 public:
 	std::vector<MeshObject*> meshes;
 	std::vector<Animation*> anims;
-public:
-	std::map<Animation*, uint> animCount;
 private:
-	std::map<Mesh*, uint> meshCount;
+	std::vector<int> meshCount; // Indexed by mesh id, -1 if never used
+	std::vector<int> animCount; // Indexed by animation id, -1 if never used
 	bool inited;
+	SceneCommandQueue* commands;
+	std::atomic<std::thread::id> commandThread; // Thread applying commands
+	std::vector<Retired> retired;
+	uint syncFrame;
+	std::vector<Node*> updateList; // Nodes updating this frame
+	std::vector<Node*> pendingList; // Nodes taken from nodesToUpdate, kept to reuse its memory
+	std::vector<int> chunkList; // Pairs of node index in updateList & first object
+	float updateCost; // Measured ms per object update
 private:
 	void initNodes();
+	void pushCommand(const SceneCommand& command);
+	void applyCommand(const SceneCommand& command);
+	void applyCommands();
+	void updateNodeList(Camera* camera, bool lastPass);
+	void countMesh(Mesh* mesh, Object* object, int delta);
+	void countAnimation(Animation* anim, int delta);
 public:
 	float time, velocity;
+	float updateBudget; // Ms for off-screen node updates per frame, 0 for no limit
 	Camera* mainCamera;
 	Camera* reflectCamera;
 	Sky* skyBox;
@@ -43,6 +76,10 @@ public:
 	Node* billboardRoot;
 	Node* animationRoot;
 	Node* noise3d;
+	FlatTree* staticTree; // Culling layout of staticRoot
+	FlatTree* animationTree; // Culling layout of animationRoot
+	QuadTree* partition; // Optional loose quadtree under staticRoot
+	InstanceNode* looseObjects; // Objects inserted without a node and out of partition
 	Player* player;
 	StaticNode* textureNode; // Use it to draw texture for debugging
 	std::vector<Node*> boundingNodes; // Used for debugging
@@ -55,12 +92,27 @@ public:
 	void createWater(const vec3& position, const vec3& size);
 	void createTerrain(const vec3& position, const vec3& size);
 	void updateVisualTerrain(int bx, int bz, int sizex, int sizez);
-	void updateNodes();
+	void updateNodes(Camera* camera = NULL);
 	void flushNodes();
-	void updateReflectCamera();
+	void queueAddObject(Node* node, Object* object);
+	void queueRemoveObject(Node* node, Object* object);
+	void queueTranslateObject(Node* node, Object* object, float x, float y, float z);
+	void queueRotateObject(Node* node, Object* object, float ax, float ay, float az);
+	void queueScaleObject(Node* node, Object* object, float sx, float sy, float sz);
+	void queueTranslateNode(Node* node, float x, float y, float z);
+	void queueAttachNode(Node* parent, Node* child);
+	void queueDetachNode(Node* parent, Node* child);
+	void queueRemoveNode(Node* node);
+	void queueStandNode(Node* node);
+	void updateReflectCamera(Camera* camera);
 	void addObject(Object* object);
+	void removeObject(Object* object);
+	void createPartition(const vec3& minBound, const vec3& maxBound);
+	void insertNode(Node* node);
+	void insertObject(Object* object);
 	void addPlay(AnimationNode* node);
 	uint queryMeshCount(Mesh* mesh);
+	uint queryAnimCount(Animation* anim);
 	void finishInit() { inited = true; }
 	bool isInited() { return inited; }
 	void act(float dTime) { time = dTime * 0.025; }
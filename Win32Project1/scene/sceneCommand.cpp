@@ -0,0 +1,45 @@
+#include "sceneCommand.h"
+
+SceneCommandQueue::SceneCommandQueue(uint capacity) {
+	cells = new Cell[capacity];
+	mask = capacity - 1;
+	for (uint i = 0; i < capacity; i++)
+		cells[i].sequence.store(i, std::memory_order_relaxed);
+	tail.store(0, std::memory_order_relaxed);
+	head = 0;
+}
+
+SceneCommandQueue::~SceneCommandQueue() {
+	delete[] cells;
+}
+
+// Any thread, false if queue is full
+bool SceneCommandQueue::push(const SceneCommand& command) {
+	Cell* cell = NULL;
+	uint pos = tail.load(std::memory_order_relaxed);
+	for (;;) {
+		cell = &cells[pos & mask];
+		int diff = (int)(cell->sequence.load(std::memory_order_acquire) - pos);
+		if (diff == 0) {
+			if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		} else if (diff < 0)
+			return false;
+		else
+			pos = tail.load(std::memory_order_relaxed);
+	}
+	cell->command = command;
+	cell->sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+// Consumer thread only, false if no published command is left
+bool SceneCommandQueue::pop(SceneCommand& command) {
+	Cell* cell = &cells[head & mask];
+	if ((int)(cell->sequence.load(std::memory_order_acquire) - (head + 1)) < 0)
+		return false;
+	command = cell->command;
+	cell->sequence.store(head + mask + 1, std::memory_order_release);
+	head++;
+	return true;
+}
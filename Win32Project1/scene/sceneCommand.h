@@ -0,0 +1,51 @@
+#ifndef SCENE_COMMAND_H_
+#define SCENE_COMMAND_H_
+
+#include <atomic>
+#include "../constants/constants.h"
+
+#define SCENE_CMD_ADD_OBJECT 0
+#define SCENE_CMD_REMOVE_OBJECT 1
+#define SCENE_CMD_TRANSLATE_OBJECT 2
+#define SCENE_CMD_ROTATE_OBJECT 3
+#define SCENE_CMD_SCALE_OBJECT 4
+#define SCENE_CMD_TRANSLATE_NODE 5
+#define SCENE_CMD_ATTACH_NODE 6
+#define SCENE_CMD_DETACH_NODE 7
+#define SCENE_CMD_REMOVE_NODE 8
+#define SCENE_CMD_STAND_NODE 9
+
+#define SCENE_COMMAND_CAPACITY 65536 // Power of two
+#define SCENE_COMMAND_PAD 64 // Keeps producer & consumer counters off one cache line
+
+// One scene change, nodes & objects are kept by handle so a command to a deleted one is dropped
+struct SceneCommand {
+	int type;
+	uint node;
+	uint child; // Attach & detach only
+	uint object;
+	float x, y, z;
+};
+
+// Bounded queue for many producers & one consumer, a producer claims a cell with one CAS
+//   and publishes it by its sequence number, the consumer takes cells in order without CAS
+class SceneCommandQueue {
+private:
+	struct Cell {
+		std::atomic<uint> sequence;
+		SceneCommand command;
+	};
+	Cell* cells;
+	uint mask;
+	char padTail[SCENE_COMMAND_PAD];
+	std::atomic<uint> tail; // Next cell to claim by producers
+	char padHead[SCENE_COMMAND_PAD];
+	uint head; // Next cell to take by consumer
+public:
+	SceneCommandQueue(uint capacity);
+	~SceneCommandQueue();
+	bool push(const SceneCommand& command);
+	bool pop(SceneCommand& command);
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef UPDATE_SELECT_H_
+#define UPDATE_SELECT_H_
+
+#include <vector>
+#include "../constants/constants.h"
+
+// Frames an off-screen node update may be put off by budget
+#define UPDATE_MAX_DEFER 30
+
+// Moves nodes updating this pass from pending to updateList & returns their object count,
+//   put off ones stay in pending. Nodes waiting too long or with stale bounds always go,
+//   then nodes in view, others only while budgetCount objects last.
+//   Only the last pass of a frame counts a deferred frame.
+//   T needs deferredFrames, needUpdateBounds & objects
+template <typename T, typename InView>
+uint SelectUpdates(std::vector<T*>& pending, std::vector<T*>& updateList, const InView& inView, float budgetCount, bool lastPass) {
+	uint objectCount = 0, kept = 0;
+	for (uint i = 0; i < pending.size(); i++) {
+		T* node = pending[i];
+		// Bounds of moved objects are stale till this update, so they count as in view
+		if (node->deferredFrames >= UPDATE_MAX_DEFER || node->needUpdateBounds || inView(node)) {
+			updateList.push_back(node);
+			objectCount += node->objects.size();
+		} else
+			pending[kept++] = node;
+	}
+	uint deferred = 0;
+	for (uint i = 0; i < kept; i++) {
+		T* node = pending[i];
+		if (objectCount + node->objects.size() <= budgetCount) {
+			updateList.push_back(node);
+			objectCount += node->objects.size();
+		} else {
+			if (lastPass) node->deferredFrames++;
+			pending[deferred++] = node;
+		}
+	}
+	pending.resize(deferred);
+	return objectCount;
+}
+
+#endif
@@ -1,12 +1,28 @@
 #include "shader.h"
 #include "../constants/constants.h"
+#include <assert.h>
 using namespace std;
 
 //#define DEBUG_SHADER 1
 
+uint Shader::shaderCount = 0;
+std::vector<uint> Shader::freeIds;
+
+// Freed ids are reused, so ids stay within SHADER_ID_BITS while few shaders live
+static uint NewShaderId() {
+	if (Shader::freeIds.size() > 0) {
+		uint id = Shader::freeIds.back();
+		Shader::freeIds.pop_back();
+		return id;
+	}
+	assert(Shader::shaderCount < (1 << SHADER_ID_BITS));
+	return Shader::shaderCount++;
+}
+
 Shader::Shader(const char* vert, const char* frag, const char* tesc, const char* tese, const char* geom) {
 	vertName = vert, fragName = frag, compName = "";
 	program = new ShaderProgram(vert, frag, tesc, tese, geom);
+	id = NewShaderId();
 	bindedTexs.clear();
 	texSlots.clear();
 	slotHnds.clear();
@@ -15,12 +31,14 @@ Shader::Shader(const char* vert, const char* frag, const char* tesc, const char*
 Shader::Shader(const char* comp) {
 	vertName = "", fragName = "", compName = comp;
 	program = new ShaderProgram(comp);
+	id = NewShaderId();
 	bindedTexs.clear();
 	texSlots.clear();
 	slotHnds.clear();
 }
 
 Shader::~Shader() {
+	freeIds.push_back(id);
 	delete program;
 	program = NULL;
 	paramLocations.clear();
@@ -12,11 +12,14 @@
 #include "../constants/constants.h"
 #include <map>
 #include <string>
+#include <vector>
 
 #ifndef INVALID_LOCATION 
 #define INVALID_LOCATION -1
 #endif
 
+#define SHADER_ID_BITS 11 // Bits of shader id render sort keys keep
+
 class Shader {
 private:
 	ShaderProgram* program;
@@ -47,6 +50,9 @@ public:
 			return it->second; 
 	}
 public:
+	static uint shaderCount; // Ids handed out, freed ones are reused first
+	static std::vector<uint> freeIds;
+	uint id; // Dense over living shaders, tells shader variants apart in sort keys
 	std::string name;
 	Shader(const char* vert, const char* frag, const char* tesc = NULL, const char* tese = NULL, const char* geom = NULL);
 	Shader(const char* comp);
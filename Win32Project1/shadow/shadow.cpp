@@ -94,6 +94,20 @@ void Shadow::update(const vec3& light) {
 	lightFarMat = lightCameraFar->viewProjectMatrix;
 }
 
+// Light cameras & matrices for drawing, cascades setup is not copied
+void Shadow::copy(Shadow* src) {
+	distance1 = src->distance1, distance2 = src->distance2;
+	level1 = src->level1, level2 = src->level2;
+	shadowMapSize = src->shadowMapSize, shadowPixSize = src->shadowPixSize;
+	lightDir = src->lightDir;
+	lightCameraNear->copy(src->lightCameraNear);
+	lightCameraMid->copy(src->lightCameraMid);
+	lightCameraFar->copy(src->lightCameraFar);
+	lightNearMat = src->lightNearMat;
+	lightMidMat = src->lightMidMat;
+	lightFarMat = src->lightFarMat;
+}
+
 void Shadow::updateLightCamera(Camera* lightCamera, const vec4* center, float radius) {
 	lightCamera->updateLook((vec3)(viewCamera->invViewMatrix * (*center)), lightDir);
 }
@@ -37,6 +37,7 @@ public:
 
 	void prepareViewCamera(float dist1, float dist2);
 	void update(const vec3& light);
+	void copy(Shadow* src);
 };
 
 
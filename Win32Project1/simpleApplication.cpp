@@ -139,7 +139,7 @@ void SimpleApplication::keyUp(int key) {
 
 void SimpleApplication::keyAct(float velocity) {
 	Application::keyAct(velocity);
-	scene->player->controlAct(input, scene, velocity * 0.05);
+	scene->player->controlAct(input, velocity * 0.05);
 	updateMovement();
 }
 
@@ -234,7 +234,7 @@ void SimpleApplication::init() {
 
 void SimpleApplication::updateMovement() {
 	if (scene->water)
-		scene->water->moveWaterWithCamera(scene->mainCamera);
+		scene->water->moveWaterWithCamera(scene, scene->mainCamera);
 	if (scene->terrainNode) {
 		vec3 cp = scene->mainCamera->position;
 		int bx, bz;
@@ -267,9 +267,9 @@ void SimpleApplication::act(long startTime, long currentTime, float velocity) {
 		Node* node = scene->animationRoot->children[0];
 		AnimationNode* animNode = (AnimationNode*)node->children[0];
 		//animNode->rotateNodeObject(0, ((AnimationObject*)animNode->objects[0])->angley + 0.1, 0);
-		animNode->rotateNodeObject(0, 135 + 90 * dr, 0);
-		animNode->translateNode(animNode->position.x - 0.01 * dd, animNode->position.y, animNode->position.z - 0.01 * dd);
-		scene->terrainNode->standObjectsOnGround(animNode);
+		scene->queueRotateObject(animNode, animNode->getObject(), 0, 135 + 90 * dr, 0);
+		scene->queueTranslateNode(animNode, animNode->position.x - 0.01 * dd, animNode->position.y, animNode->position.z - 0.01 * dd);
+		scene->queueStandNode(animNode);
 
 		static float distance = 0.0;
 		distance++;
@@ -287,8 +287,8 @@ void SimpleApplication::act(long startTime, long currentTime, float velocity) {
 	}
 	//*/
 
-	scene->updateNodes();
-	if (!cfgs->ssr) scene->updateReflectCamera();
+	scene->updateNodes(renderMgr->getCullCamera());
+	if (!cfgs->ssr) scene->updateReflectCamera(renderMgr->getCullCamera());
 }
 
 void SimpleApplication::initScene() {
@@ -307,6 +307,11 @@ void SimpleApplication::initScene() {
 	assetMgr->addMesh("house", new Model("models/house.obj", "models/house.mtl", 2));
 	assetMgr->addMesh("oildrum", new Model("models/oildrum.obj", "models/oildrum.mtl", 3));
 	assetMgr->addMesh("rock", new Model("models/sharprockfree.obj", "models/sharprockfree.mtl", 2));
+	assetMgr->addMeshLods("tank", 0.5);
+	assetMgr->addMeshLods("m1a2", 0.5);
+	assetMgr->addMeshLods("house", 0.5);
+	assetMgr->addMeshLods("oildrum", 0.5);
+	assetMgr->addMeshLods("rock", 0.5);
 	assetMgr->addMesh("terrain", new Terrain("terrain/Terrain.raw"));
 	assetMgr->addMesh("water", new Water(1024, 16));
 
@@ -402,19 +407,23 @@ void SimpleApplication::initScene() {
 	StaticObject model1(meshes["tree"], meshes["treeMid"], meshes["billboard"]);
 	model1.detailLevel = 4;
 	model1.setBillboard(5, 10, mtlMgr->find("billboard_tree_mat"));
-	StaticObject model2(meshes["tank"]);
-	StaticObject model3(meshes["m1a2"]);
+	StaticObject model2(meshes["tank"], meshes["tankMid"], meshes["tankLow"]);
+	StaticObject model3(meshes["m1a2"], meshes["m1a2Mid"], meshes["m1a2Low"]);
 	StaticObject model4(meshes["treeA"], meshes["treeAMid"], meshes["billboard"]);
 	model4.detailLevel = 4;
 	model4.setBillboard(13, 14, mtlMgr->find("billboard_treeA_mat"));
-	StaticObject model5(meshes["house"]);
-	StaticObject model6(meshes["oildrum"]);
-	StaticObject model9(meshes["rock"], meshes["rock"], NULL);
+	StaticObject model5(meshes["house"], meshes["houseMid"], meshes["houseLow"]);
+	StaticObject model6(meshes["oildrum"], meshes["oildrumMid"], meshes["oildrumLow"]);
+	StaticObject model9(meshes["rock"], meshes["rockMid"], NULL);
 
 	//return;
 	scene->createSky(cfgs->dynsky);
 	scene->createWater(vec3(-2048, 0, -2048), vec3(6, 1, 6));
 	scene->createTerrain(vec3(-2048, -200, -2048), vec3(6, 2.0, 6));
+	if (cfgs->partition) {
+		AABB* terrainBox = (AABB*)scene->terrainNode->boundingBox;
+		scene->createPartition(terrainBox->minVertex - vec3(0, 1000, 0), terrainBox->maxVertex + vec3(0, 1000, 0));
+	}
 
 	InstanceNode* node1 = new InstanceNode(vec3(2, 2, 2));
 	StaticObject* object11 = model2.clone();
@@ -464,7 +473,7 @@ void SimpleApplication::initScene() {
 	modelNode->attachChild(node2);
 	node->attachChild(modelNode);
 	node->attachChild(node3);
-	scene->staticRoot->attachChild(node);
+	scene->insertNode(node);
 
 	StaticObject* objectRock = model9.clone();
 	objectRock->setPosition(-60, 0, 0);
@@ -474,6 +483,7 @@ void SimpleApplication::initScene() {
 	int treeScale = 13;
 	int treeSpace = 180;
 	int treePerc = 80;
+	std::vector<Object*> trees, stones;
 	
 	srand(100);
 	InstanceNode* instanceNode1 = new InstanceNode(vec3(900, 0, 600));
@@ -490,12 +500,14 @@ void SimpleApplication::initScene() {
 			tree->setSize(size, size, size);
 			tree->setRotation(0, 360 * (rand() % 100) * 0.01, 0);
 			tree->setPosition(j * treeSpace + treeSpace * (rand() % 100) * 0.01, 0, i * treeSpace + treeSpace * (rand() % 100) * 0.01);
-			instanceNode1->addObject(scene, tree);
+			trees.push_back(tree);
 		}
 	}
+	instanceNode1->addObjects(scene, trees.data(), trees.size());
 	treeSpace = 100;
 	InstanceNode* instanceNode2 = new InstanceNode(vec3(2746, 0, 2565));
 	instanceNode2->detailLevel = 4;
+	trees.clear();
 	for (int i = -treeScale; i < treeScale; i++) {
 		for (int j = -treeScale; j < treeScale; j++) {
 			//StaticObject* tree = model1->clone();
@@ -508,11 +520,13 @@ void SimpleApplication::initScene() {
 			tree->setSize(size, size, size);
 			tree->setRotation(0, 360 * (rand() % 100) * 0.01, 0);
 			tree->setPosition(j * treeSpace + treeSpace * (rand() % 100) * 0.01, 0, i * treeSpace + treeSpace * (rand() % 100) * 0.01);
-			instanceNode2->addObject(scene, tree);
+			trees.push_back(tree);
 		}
 	}
+	instanceNode2->addObjects(scene, trees.data(), trees.size());
 	InstanceNode* instanceNode3 = new InstanceNode(vec3(-700, 0, 1320));
 	instanceNode3->detailLevel = 4;
+	trees.clear();
 	for (int i = -treeScale; i < treeScale; i++) {
 		for (int j = -treeScale; j < treeScale; j++) {
 			//StaticObject* tree = model1->clone();
@@ -525,11 +539,13 @@ void SimpleApplication::initScene() {
 			tree->setSize(size, size, size);
 			tree->setRotation(0, 360 * (rand() % 100) * 0.01, 0);
 			tree->setPosition(j * treeSpace + treeSpace * (rand() % 100) * 0.01, 0, i * treeSpace + treeSpace * (rand() % 100) * 0.01);
-			instanceNode3->addObject(scene, tree);
+			trees.push_back(tree);
 		}
 	}
+	instanceNode3->addObjects(scene, trees.data(), trees.size());
 	InstanceNode* instanceNode4 = new InstanceNode(vec3(-750, 0, -500));
 	instanceNode4->detailLevel = 4;
+	trees.clear();
 	for (int i = -treeScale; i < treeScale; i++) {
 		for (int j = -treeScale; j < treeScale; j++) {
 			//StaticObject* tree = model1->clone();
@@ -542,11 +558,13 @@ void SimpleApplication::initScene() {
 			tree->setSize(size, size, size);
 			tree->setRotation(0, 360 * (rand() % 100) * 0.01, 0);
 			tree->setPosition(j * treeSpace + treeSpace * (rand() % 100) * 0.01, 0, i * treeSpace + treeSpace * (rand() % 100) * 0.01);
-			instanceNode4->addObject(scene, tree);
+			trees.push_back(tree);
 		}
 	}
+	instanceNode4->addObjects(scene, trees.data(), trees.size());
 	InstanceNode* instanceNode5 = new InstanceNode(vec3(2100, 0, -600));
 	instanceNode5->detailLevel = 4;
+	trees.clear();
 	for (int i = -treeScale; i < treeScale; i++) {
 		for (int j = -treeScale; j < treeScale; j++) {
 			//StaticObject* tree = model1->clone();
@@ -559,12 +577,14 @@ void SimpleApplication::initScene() {
 			tree->setSize(size, size, size);
 			tree->setRotation(0, 360 * (rand() % 100) * 0.01, 0);
 			tree->setPosition(j * treeSpace + treeSpace * (rand() % 100) * 0.01, 0, i * treeSpace + treeSpace * (rand() % 100) * 0.01);
-			instanceNode5->addObject(scene, tree);
+			trees.push_back(tree);
 		}
 	}
+	instanceNode5->addObjects(scene, trees.data(), trees.size());
 	treeSpace = 150;
 	InstanceNode* instanceNode6 = new InstanceNode(vec3(800, 0, 2000));
 	instanceNode6->detailLevel = 4;
+	trees.clear();
 	for (int i = -treeScale; i < treeScale; i++) {
 		for (int j = -treeScale; j < treeScale; j++) {
 			StaticObject* tree = model1.clone();
@@ -577,9 +597,10 @@ void SimpleApplication::initScene() {
 			tree->setSize(size, size, size);
 			tree->setRotation(0, 360 * (rand() % 100) * 0.01, 0);
 			tree->setPosition(j * treeSpace + treeSpace * (rand() % 100) * 0.01, 0, i * treeSpace + treeSpace * (rand() % 100) * 0.01);
-			instanceNode6->addObject(scene, tree);
+			trees.push_back(tree);
 		}
 	}
+	instanceNode6->addObjects(scene, trees.data(), trees.size());
 
 	InstanceNode* stoneNode = new InstanceNode(vec3(0, 0, 0));
 	stoneNode->detailLevel = 3;
@@ -593,9 +614,10 @@ void SimpleApplication::initScene() {
 			stone->setSize(size, size, size);
 			stone->setRotation(0, 360 * (rand() % 100) * 0.01, 0);
 			stone->setPosition(j * stoneSpace + stoneSpace * (rand() % 100) * 0.01, 0, i * stoneSpace + stoneSpace * (rand() % 100) * 0.01);
-			stoneNode->addObject(scene, stone);
+			stones.push_back(stone);
 		}
 	}
+	stoneNode->addObjects(scene, stones.data(), stones.size());
 
 	InstanceNode* instanceNode7 = new InstanceNode(vec3(903, 0, -608));
 	StaticObject* oil1 = model6.clone();
@@ -632,14 +654,14 @@ void SimpleApplication::initScene() {
 	instanceNode7->addObject(scene, box3);
 	instanceNode7->addObject(scene, box4);
 
-	scene->staticRoot->attachChild(instanceNode1);
-	scene->staticRoot->attachChild(instanceNode2);
-	scene->staticRoot->attachChild(instanceNode3);
-	scene->staticRoot->attachChild(instanceNode4);
-	scene->staticRoot->attachChild(instanceNode5);
-	scene->staticRoot->attachChild(instanceNode6);
-	scene->staticRoot->attachChild(instanceNode7);
-	scene->staticRoot->attachChild(stoneNode);
+	scene->insertNode(instanceNode1);
+	scene->insertNode(instanceNode2);
+	scene->insertNode(instanceNode3);
+	scene->insertNode(instanceNode4);
+	scene->insertNode(instanceNode5);
+	scene->insertNode(instanceNode6);
+	scene->insertNode(instanceNode7);
+	scene->insertNode(stoneNode);
 
 	AnimationNode* animNode1 = new AnimationNode(vec3(5, 10, 5));
 	animNode1->setAnimation(scene, animations["army"]);
@@ -1,5 +1,6 @@
 #include "texturebindless.h"
 #include "../render/render.h"
+#include "../util/jobSystem.h"
 using namespace std;
 
 TextureBindless::TextureBindless() {
@@ -61,9 +62,15 @@ void TextureBindless::initData(string dir) {
 	texhnds = (u64*)malloc(size * sizeof(u64));
 	memset(texhnds, 0, size * sizeof(u64));
 
+	// Decode files in jobs, gl calls stay on this thread
+	imgs.resize(size, NULL);
+	JobSystem::jobSystem->parallelFor(size, 1, [&](uint begin, uint end) {
+		for (uint i = begin; i < end; i++)
+			imgs[i] = new BmpImage((path + texnames[i]).data());
+	});
+
 	for (int i = 0; i < size; i++) {
-		BmpImage* img = new BmpImage((path + texnames[i]).data());
-		imgs.push_back(img);
+		BmpImage* img = imgs[i];
 		glBindTexture(GL_TEXTURE_2D, texids[i]);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -0,0 +1,48 @@
+#include "arena.h"
+#include <stdlib.h>
+
+FrameArena::FrameArena(uint size) {
+	capacity = size;
+	data = (char*)malloc(capacity);
+	offset = 0;
+	overflows.clear();
+	overflowSize = 0;
+	heapAllocations = 1;
+}
+
+FrameArena::~FrameArena() {
+	free(data);
+	for (uint i = 0; i < overflows.size(); i++)
+		free(overflows[i]);
+	overflows.clear();
+}
+
+void* FrameArena::alloc(uint size) {
+	size = ((size + ARENA_ALIGN - 1) / ARENA_ALIGN) * ARENA_ALIGN;
+	uint begin = offset.fetch_add(size);
+	if (begin + size <= capacity) 
+		return data + begin;
+
+	char* block = (char*)malloc(size);
+	overflowLock.lock();
+	overflows.push_back(block);
+	overflowSize += size;
+	heapAllocations++;
+	overflowLock.unlock();
+	return block;
+}
+
+// O(1) unless last frame overflowed, then the arena grows to hold it next time
+void FrameArena::reset() {
+	if (overflows.size() > 0) {
+		for (uint i = 0; i < overflows.size(); i++)
+			free(overflows[i]);
+		overflows.clear();
+		free(data);
+		capacity = getUsed() * 3 / 2;
+		data = (char*)malloc(capacity);
+		heapAllocations++;
+	}
+	offset = 0;
+	overflowSize = 0;
+}
@@ -0,0 +1,34 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include "../constants/constants.h"
+
+#define ARENA_ALIGN 16
+
+// Linear allocator for data living until next reset, nothing is freed one by one,
+//   blocks taken when full are merged into one at reset so a steady frame never hits heap,
+//   alloc may be called from several jobs at once, reset may not
+class FrameArena {
+private:
+	char* data;
+	uint capacity;
+	std::atomic<uint> offset;
+	std::vector<char*> overflows;
+	std::mutex overflowLock;
+	uint overflowSize;
+	uint heapAllocations; // Since creation, for checking steady frames
+public:
+	FrameArena(uint size);
+	~FrameArena();
+	void* alloc(uint size);
+	template<typename T> T* allocArray(uint count) { return (T*)alloc(count * sizeof(T)); }
+	void reset();
+	uint getUsed() { uint used = offset; return (used < capacity ? used : capacity) + overflowSize; }
+	uint getCapacity() { return capacity; }
+	uint getHeapAllocations() { return heapAllocations; }
+};
+
+#endif
@@ -0,0 +1,256 @@
+#include "jobSystem.h"
+#include <assert.h>
+
+JobSystem* JobSystem::jobSystem = NULL;
+
+static thread_local int workerIndex = -1;
+
+// Queue a thread pushes to & pops first, threads outside the system share worker 0's
+inline int QueueIndex() {
+	return workerIndex >= 0 ? workerIndex : 0;
+}
+
+static Job* NewRingChunk() {
+	Job* chunk = new Job[JOB_RING_SIZE];
+	for (uint i = 0; i < JOB_RING_SIZE; i++) {
+		chunk[i].unfinished = 0;
+		chunk[i].dependencies = 0;
+	}
+	return chunk;
+}
+
+void WorkQueue::pushBack(Job* job) {
+	if (count == jobs.size()) {
+		std::vector<Job*> grown(jobs.size() * 2, NULL);
+		for (uint i = 0; i < count; i++)
+			grown[i] = jobs[(head + i) % jobs.size()];
+		jobs.swap(grown);
+		head = 0;
+	}
+	jobs[(head + count) % jobs.size()] = job;
+	count++;
+}
+
+Job* WorkQueue::popBack() {
+	if (count == 0) return NULL;
+	count--;
+	return jobs[(head + count) % jobs.size()];
+}
+
+Job* WorkQueue::popFront() {
+	if (count == 0) return NULL;
+	Job* job = jobs[head];
+	head = (head + 1) % jobs.size();
+	count--;
+	return job;
+}
+
+void JobSystem::Init() {
+	if (!jobSystem) {
+		uint cores = std::thread::hardware_concurrency();
+		jobSystem = new JobSystem(cores > 2 ? cores : 2);
+	}
+}
+
+void JobSystem::Release() {
+	if (jobSystem) delete jobSystem;
+	jobSystem = NULL;
+}
+
+JobSystem::JobSystem(uint workerCount) {
+	queuedJobs = 0;
+	sleepers = 0;
+	quit = false;
+	for (uint i = 0; i < workerCount; i++) 
+		queues.push_back(new WorkQueue());
+	longQueue = new WorkQueue();
+	for (uint i = 0; i <= workerCount; i++) {
+		rings.push_back(std::vector<Job*>(1, NewRingChunk()));
+		ringNexts.push_back(0);
+	}
+
+	workerIndex = 0;
+	for (uint i = 1; i < workerCount; i++)
+		threads.push_back(std::thread(&JobSystem::workerRun, this, i));
+}
+
+JobSystem::~JobSystem() {
+	quit = true;
+	{ std::lock_guard<std::mutex> guard(sleepLock); }
+	wakeCond.notify_all();
+	for (uint i = 0; i < threads.size(); i++)
+		threads[i].join();
+	threads.clear();
+
+	for (uint i = 0; i < queues.size(); i++) 
+		delete queues[i];
+	delete longQueue;
+	for (uint i = 0; i < rings.size(); i++) {
+		for (uint j = 0; j < rings[i].size(); j++)
+			delete[] rings[i][j];
+	}
+	queues.clear();
+	rings.clear();
+	workerIndex = -1;
+}
+
+void JobSystem::workerRun(int index) {
+	workerIndex = index;
+	while (!quit) {
+		Job* job = pop(index, true);
+		if (job) {
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(sleepLock);
+		sleepers++;
+		wakeCond.wait(guard, [this]() { return queuedJobs.load() > 0 || quit.load(); });
+		sleepers--;
+	}
+}
+
+void JobSystem::push(Job* job) {
+	WorkQueue* queue = job->longRunning ? longQueue : queues[QueueIndex()];
+	queue->lock.lock();
+	queue->pushBack(job);
+	queue->lock.unlock();
+
+	queuedJobs++;
+	if (sleepers.load() > 0) {
+		{ std::lock_guard<std::mutex> guard(sleepLock); }
+		wakeCond.notify_one();
+	}
+}
+
+// Newest job of own queue, or oldest one of another queue, then a long job if allowed
+Job* JobSystem::pop(int index, bool takeLong) {
+	Job* job = NULL;
+	WorkQueue* queue = queues[index];
+	queue->lock.lock();
+	job = queue->popBack();
+	queue->lock.unlock();
+
+	for (uint i = 1; !job && i < queues.size(); i++) {
+		WorkQueue* victim = queues[(index + i) % queues.size()];
+		if (!victim->lock.try_lock()) continue;
+		job = victim->popFront();
+		victim->lock.unlock();
+	}
+
+	if (!job && takeLong) {
+		longQueue->lock.lock();
+		job = longQueue->popFront();
+		longQueue->lock.unlock();
+	}
+
+	if (job) queuedJobs--;
+	return job;
+}
+
+void JobSystem::execute(Job* job) {
+	if (job->func) job->func();
+	finish(job);
+}
+
+void JobSystem::finish(Job* job) {
+	// Job may be reused once finished, so keep what is needed first
+	Job* parent = job->parent;
+	Job* successors[JOB_MAX_SUCCESSORS];
+	int successorCount = job->successorCount;
+	for (int i = 0; i < successorCount; i++)
+		successors[i] = job->successors[i];
+
+	if (job->unfinished.fetch_sub(1) != 1) return;
+	for (int i = 0; i < successorCount; i++) {
+		if (successors[i]->dependencies.fetch_sub(1) == 1)
+			push(successors[i]);
+	}
+	if (parent) finish(parent);
+}
+
+// Next free job of a ring, a chunk is added when the next one is still alive,
+//   so a finished job is reused only after its ring went round once more
+Job* JobSystem::take(uint ring) {
+	std::vector<Job*>& chunks = rings[ring];
+	uint size = chunks.size() * JOB_RING_SIZE;
+	uint slot = ringNexts[ring] % size;
+	Job* job = chunks[slot / JOB_RING_SIZE] + slot % JOB_RING_SIZE;
+	if (job->unfinished.load() > 0) {
+		chunks.push_back(NewRingChunk());
+		slot = size;
+		job = chunks.back();
+	}
+	ringNexts[ring] = slot + 1;
+	return job;
+}
+
+// Any thread, a job must be waited for before its thread creates 
+//   as many jobs as its ring holds
+Job* JobSystem::create(const JobFunc& func, Job* parent) {
+	Job* job = NULL;
+	if (workerIndex >= 0) 
+		job = take(workerIndex);
+	else {
+		std::lock_guard<std::mutex> guard(foreignLock);
+		job = take(queues.size());
+	}
+	job->func = func;
+	job->parent = parent;
+	job->unfinished = 1;
+	job->dependencies = 1;
+	job->successorCount = 0;
+	job->longRunning = false;
+	if (parent) parent->unfinished++;
+	return job;
+}
+
+// Job runs only after before finished, call before submitting either of them
+void JobSystem::depend(Job* job, Job* before) {
+	assert(before->successorCount < JOB_MAX_SUCCESSORS);
+	before->successors[before->successorCount++] = job;
+	job->dependencies++;
+}
+
+void JobSystem::submit(Job* job) {
+	if (job->dependencies.fetch_sub(1) == 1)
+		push(job);
+}
+
+// For a job running a whole stage like frame prepare, only an idle worker thread takes it
+void JobSystem::submitLong(Job* job) {
+	job->longRunning = true;
+	submit(job);
+}
+
+// Run other short jobs until job is finished
+void JobSystem::wait(Job* job) {
+	while (job->unfinished.load() > 0) {
+		Job* next = pop(QueueIndex(), false);
+		if (next)
+			execute(next);
+		else
+			std::this_thread::yield();
+	}
+}
+
+// Calls func on sub ranges [begin, end) of count items across workers and returns when all done,
+//   grain is the least items of one range
+void JobSystem::parallelFor(uint count, uint grain, const std::function<void(uint, uint)>& func) {
+	if (count == 0) return;
+	uint maxJobs = queues.size() * 4;
+	if (grain == 0) grain = 1;
+	if (count / grain > maxJobs) grain = (count + maxJobs - 1) / maxJobs;
+	if (count <= grain) {
+		func(0, count);
+		return;
+	}
+
+	Job* group = create(JobFunc());
+	for (uint begin = 0; begin < count; begin += grain) {
+		uint end = begin + grain < count ? begin + grain : count;
+		submit(create([&func, begin, end]() { func(begin, end); }, group));
+	}
+	submit(group);
+	wait(group);
+}
@@ -0,0 +1,86 @@
+#ifndef JOB_SYSTEM_H_
+#define JOB_SYSTEM_H_
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include "../constants/constants.h"
+
+#define JOB_MAX_SUCCESSORS 8
+#define JOB_RING_SIZE 4096 // Jobs a ring chunk holds, a ring grows by a chunk when full
+#define JOB_QUEUE_SIZE 256 // Initial jobs a work queue holds, doubled when full
+
+typedef std::function<void()> JobFunc;
+
+// A job counts as finished when its function and all its children have run,
+//   successors are released then, so per frame graphs are built before submitting
+struct Job {
+	JobFunc func;
+	Job* parent;
+	std::atomic<int> unfinished; // Itself and unfinished children
+	std::atomic<int> dependencies; // Unfinished jobs it waits for, plus one until submitted
+	Job* successors[JOB_MAX_SUCCESSORS];
+	int successorCount;
+	bool longRunning; // Taken only by worker threads' idle loop, never by a waiting thread
+};
+
+// Jobs of one thread in a circular buffer that only grows, so a steady frame does not allocate,
+//   owner works from back and thieves take from front
+struct WorkQueue {
+	std::vector<Job*> jobs;
+	uint head, count;
+	std::mutex lock;
+	WorkQueue() :jobs(JOB_QUEUE_SIZE, NULL), head(0), count(0) {}
+	void pushBack(Job* job);
+	Job* popBack();
+	Job* popFront();
+};
+
+// Worker threads with own queues stealing from each other when empty,
+//   the thread calling Init is worker 0 and only runs jobs while waiting.
+//   Other threads share a locked ring & the queue of worker 0.
+//   Long jobs go to a queue of their own, so a thread waiting for short ones never runs them
+class JobSystem {
+public:
+	static JobSystem* jobSystem;
+	static void Init();
+	static void Release();
+private:
+	std::vector<std::thread> threads;
+	std::vector<WorkQueue*> queues;
+	WorkQueue* longQueue;
+	std::vector<std::vector<Job*> > rings; // Job chunks per worker & one for other threads, reused round robin
+	std::vector<uint> ringNexts;
+	std::mutex foreignLock; // Guards ring of other threads
+	std::atomic<int> queuedJobs, sleepers;
+	std::atomic<bool> quit;
+	std::mutex sleepLock;
+	std::condition_variable wakeCond;
+private:
+	JobSystem(uint workerCount);
+	~JobSystem();
+	void workerRun(int index);
+	Job* take(uint ring);
+	void push(Job* job);
+	Job* pop(int index, bool takeLong);
+	void execute(Job* job);
+	void finish(Job* job);
+public:
+	uint getWorkerCount() { return queues.size(); }
+	Job* create(const JobFunc& func, Job* parent = NULL);
+	void depend(Job* job, Job* before);
+	void submit(Job* job);
+	void submitLong(Job* job);
+	void wait(Job* job);
+	bool isFinished(Job* job) { return job->unfinished.load() == 0; }
+	void parallelFor(uint count, uint grain, const std::function<void(uint, uint)>& func);
+	// Lambda is wrapped by reference, so capturing many variables does not allocate each call
+	template<typename F> void parallelFor(uint count, uint grain, const F& func) {
+		parallelFor(count, grain, std::function<void(uint, uint)>(std::cref(func)));
+	}
+};
+
+#endif
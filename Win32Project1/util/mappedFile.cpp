@@ -0,0 +1,57 @@
+#include "mappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+MappedFile::MappedFile(const char* path) {
+	fileHandle = NULL;
+	mapHandle = NULL;
+	data = NULL;
+	size = 0;
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) return;
+	fileHandle = file;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) return;
+
+	mapHandle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapHandle) return;
+	data = (const char*)MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+	if (data) size = (size_t)fileSize.QuadPart;
+}
+
+MappedFile::~MappedFile() {
+	if (data) UnmapViewOfFile(data);
+	if (mapHandle) CloseHandle(mapHandle);
+	if (fileHandle) CloseHandle(fileHandle);
+}
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFile::MappedFile(const char* path) {
+	data = NULL;
+	size = 0;
+
+	fileId = open(path, O_RDONLY);
+	if (fileId < 0) return;
+	struct stat info;
+	if (fstat(fileId, &info) != 0 || info.st_size <= 0) return;
+
+	void* view = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fileId, 0);
+	if (view == MAP_FAILED) return;
+	madvise(view, info.st_size, MADV_SEQUENTIAL);
+	data = (const char*)view;
+	size = info.st_size;
+}
+
+MappedFile::~MappedFile() {
+	if (data) munmap((void*)data, size);
+	if (fileId >= 0) close(fileId);
+}
+#endif
@@ -0,0 +1,24 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <stddef.h>
+
+// Read only view of a whole file mapped into memory, data is NULL if file
+//   can not be opened or is empty, pages are loaded on first touch
+class MappedFile {
+private:
+#ifdef _WIN32
+	void* fileHandle;
+	void* mapHandle;
+#else
+	int fileId;
+#endif
+public:
+	const char* data;
+	size_t size;
+public:
+	MappedFile(const char* path);
+	~MappedFile();
+};
+
+#endif
@@ -0,0 +1,224 @@
+#include "pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <algorithm>
+
+MemoryPool::MemoryPool(uint size, uint count) {
+	if (size < sizeof(void*)) size = sizeof(void*);
+	elementSize = ((size + POOL_ALIGN - 1) / POOL_ALIGN) * POOL_ALIGN;
+	blockCount = count;
+	blocks.clear();
+	freeList = NULL;
+	used = blockCount;
+	liveCount = 0;
+}
+
+MemoryPool::~MemoryPool() {
+	for (uint i = 0; i < blocks.size(); i++)
+		free(blocks[i]);
+	blocks.clear();
+}
+
+// Caller holds mutex
+void* MemoryPool::take() {
+	liveCount++;
+	if (freeList) {
+		void* element = freeList;
+		freeList = *(void**)element;
+		return element;
+	}
+	if (used >= blockCount) {
+		blocks.push_back((char*)malloc(elementSize * blockCount));
+		used = 0;
+	}
+	return blocks.back() + elementSize * (used++);
+}
+
+void* MemoryPool::alloc() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return take();
+}
+
+void MemoryPool::release(void* element) {
+	if (!element) return;
+	std::lock_guard<std::mutex> lock(mutex);
+	*(void**)element = freeList;
+	freeList = element;
+	liveCount--;
+}
+
+// Chain of count elements linked through their first word, returned in head
+uint MemoryPool::allocBatch(uint count, void*& head) {
+	std::lock_guard<std::mutex> lock(mutex);
+	head = NULL;
+	for (uint i = 0; i < count; i++) {
+		void* element = take();
+		*(void**)element = head;
+		head = element;
+	}
+	return count;
+}
+
+// Chain from head to tail, linked through their first word
+void MemoryPool::releaseBatch(void* head, void* tail, uint count) {
+	if (!head) return;
+	std::lock_guard<std::mutex> lock(mutex);
+	*(void**)tail = freeList;
+	freeList = head;
+	liveCount -= count;
+}
+
+// Free blocks with all their elements in the free list, return number of blocks freed
+uint MemoryPool::trim() {
+	std::lock_guard<std::mutex> lock(mutex);
+	uint count = blocks.size();
+	if (count == 0) return 0;
+
+	std::vector<char*> sorted = blocks;
+	std::sort(sorted.begin(), sorted.end(), std::less<char*>());
+	std::vector<uint> freeCounts(count, 0);
+	for (void* element = freeList; element; element = *(void**)element) {
+		uint b = std::upper_bound(sorted.begin(), sorted.end(), (char*)element, std::less<char*>()) - sorted.begin() - 1;
+		freeCounts[b]++;
+	}
+
+	// Last block only has its carved part in use
+	char* last = blocks.back();
+	std::vector<bool> empty(count, false);
+	uint emptyCount = 0;
+	for (uint b = 0; b < count; b++) {
+		uint capacity = sorted[b] == last ? used : blockCount;
+		empty[b] = freeCounts[b] == capacity;
+		if (empty[b]) emptyCount++;
+	}
+	if (emptyCount == 0) return 0;
+
+	void* kept = NULL;
+	for (void* element = freeList; element; ) {
+		void* next = *(void**)element;
+		uint b = std::upper_bound(sorted.begin(), sorted.end(), (char*)element, std::less<char*>()) - sorted.begin() - 1;
+		if (!empty[b]) {
+			*(void**)element = kept;
+			kept = element;
+		}
+		element = next;
+	}
+	freeList = kept;
+
+	bool lastFreed = false;
+	blocks.clear();
+	for (uint b = 0; b < count; b++) {
+		if (empty[b]) {
+			if (sorted[b] == last) lastFreed = true;
+			free(sorted[b]);
+		} else if (sorted[b] != last)
+			blocks.push_back(sorted[b]);
+	}
+	// Keep the partly carved block last, otherwise start a new block on next take
+	if (!lastFreed) blocks.push_back(last);
+	else used = blockCount;
+	return emptyCount;
+}
+#define POOL_CLASS_COUNT (POOL_MAX_SIZE / POOL_ALIGN + 1)
+
+static std::atomic<MemoryPool*> sizedPools[POOL_CLASS_COUNT];
+static std::mutex sizedPoolsMutex;
+
+MemoryPool* GetSizedPool(size_t size) {
+	uint index = (size + POOL_ALIGN - 1) / POOL_ALIGN;
+	MemoryPool* pool = sizedPools[index].load(std::memory_order_acquire);
+	if (!pool) {
+		std::lock_guard<std::mutex> lock(sizedPoolsMutex);
+		pool = sizedPools[index].load(std::memory_order_relaxed);
+		if (!pool) {
+			pool = new MemoryPool(index * POOL_ALIGN, POOL_BLOCK_COUNT);
+			sizedPools[index].store(pool, std::memory_order_release);
+		}
+	}
+	return pool;
+}
+
+// Released elements of one thread per size class, linked through their first word
+struct PoolCache {
+	void* heads[POOL_CLASS_COUNT];
+	uint counts[POOL_CLASS_COUNT];
+	bool alive; // False once the thread's cache is destroyed, pools are used directly then
+
+	PoolCache() {
+		memset(heads, 0, sizeof(heads));
+		memset(counts, 0, sizeof(counts));
+		alive = true;
+	}
+	~PoolCache() {
+		flush();
+		alive = false;
+	}
+	void flush() {
+		for (uint i = 0; i < POOL_CLASS_COUNT; i++) {
+			if (!heads[i]) continue;
+			void* tail = heads[i];
+			while (*(void**)tail) tail = *(void**)tail;
+			sizedPools[i].load(std::memory_order_acquire)->releaseBatch(heads[i], tail, counts[i]);
+			heads[i] = NULL;
+			counts[i] = 0;
+		}
+	}
+};
+
+static thread_local PoolCache poolCache;
+
+void* PoolAlloc(size_t size) {
+	if (size > POOL_MAX_SIZE) return malloc(size);
+	PoolCache& cache = poolCache;
+	if (!cache.alive) return GetSizedPool(size)->alloc();
+
+	uint index = (size + POOL_ALIGN - 1) / POOL_ALIGN;
+	if (cache.counts[index] == 0) 
+		cache.counts[index] = GetSizedPool(size)->allocBatch(POOL_CACHE_BATCH, cache.heads[index]);
+	void* element = cache.heads[index];
+	cache.heads[index] = *(void**)element;
+	cache.counts[index]--;
+	return element;
+}
+
+// Cache keeps up to two batches, one batch goes back to the pool when it overflows
+void PoolFree(void* element, size_t size) {
+	if (!element) return;
+	if (size > POOL_MAX_SIZE) {
+		free(element);
+		return;
+	}
+	PoolCache& cache = poolCache;
+	if (!cache.alive) {
+		GetSizedPool(size)->release(element);
+		return;
+	}
+
+	uint index = (size + POOL_ALIGN - 1) / POOL_ALIGN;
+	*(void**)element = cache.heads[index];
+	cache.heads[index] = element;
+	if (++cache.counts[index] > POOL_CACHE_BATCH * 2) {
+		void* head = cache.heads[index];
+		void* tail = head;
+		for (uint i = 1; i < POOL_CACHE_BATCH; i++) 
+			tail = *(void**)tail;
+		cache.heads[index] = *(void**)tail;
+		cache.counts[index] -= POOL_CACHE_BATCH;
+		GetSizedPool(size)->releaseBatch(head, tail, POOL_CACHE_BATCH);
+	}
+}
+
+void FlushPoolCache() {
+	if (poolCache.alive) poolCache.flush();
+}
+
+uint ReleasePools() {
+	FlushPoolCache();
+	uint freed = 0;
+	for (uint i = 0; i < POOL_CLASS_COUNT; i++) {
+		MemoryPool* pool = sizedPools[i].load(std::memory_order_acquire);
+		if (pool) freed += pool->trim();
+	}
+	return freed;
+}
@@ -0,0 +1,50 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <vector>
+#include <mutex>
+#include <stddef.h>
+#include "../constants/constants.h"
+
+#define POOL_ALIGN 16
+#define POOL_BLOCK_COUNT 1024 // Elements in each block
+#define POOL_MAX_SIZE 1024 // Larger allocations go to heap
+#define POOL_CACHE_BATCH 32 // Elements moved at once between a thread's cache and its pool
+
+// Fixed size elements carved out of large contiguous blocks, 
+//   released elements are reused, blocks whose elements are all released are freed by trim
+class MemoryPool {
+private:
+	uint elementSize, blockCount;
+	std::vector<char*> blocks;
+	void* freeList;
+	uint used; // Elements taken from last block
+	uint liveCount; // Elements out of the pool, including those in thread caches
+	std::mutex mutex;
+private:
+	void* take();
+public:
+	MemoryPool(uint size, uint count);
+	~MemoryPool();
+	void* alloc();
+	void release(void* element);
+	uint allocBatch(uint count, void*& head);
+	void releaseBatch(void* head, void* tail, uint count);
+	uint trim();
+	uint getElementSize() { return elementSize; }
+	uint getLiveCount() { return liveCount; }
+	uint getBlockCount() { return blocks.size(); }
+};
+
+// One pool per size, used by class operator new & delete,
+//   each thread keeps a small cache per size so the pool lock is taken once per batch
+void* PoolAlloc(size_t size);
+void PoolFree(void* element, size_t size);
+MemoryPool* GetSizedPool(size_t size);
+// Return this thread's cached elements to their pools
+void FlushPoolCache();
+// Free blocks of all pools whose elements are all released, 
+//   elements still cached by other threads keep their blocks
+uint ReleasePools();
+
+#endif
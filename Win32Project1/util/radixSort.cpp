@@ -0,0 +1,40 @@
+#include "radixSort.h"
+#include <string.h>
+
+void RadixSort(u64* keys, uint* values, uint count, u64* tmpKeys, uint* tmpValues) {
+	if (count < 2) return;
+	uint histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (uint i = 0; i < count; ++i) {
+		u64 key = keys[i];
+		for (uint d = 0; d < 8; ++d)
+			histograms[d][(key >> (d * 8)) & 0xff]++;
+	}
+
+	u64* srcKeys = keys, *dstKeys = tmpKeys;
+	uint* srcValues = values, *dstValues = tmpValues;
+	for (uint d = 0; d < 8; ++d) {
+		uint* histogram = histograms[d];
+		if (histogram[(srcKeys[0] >> (d * 8)) & 0xff] == count) continue;
+
+		uint offset = 0;
+		for (uint b = 0; b < 256; ++b) {
+			uint num = histogram[b];
+			histogram[b] = offset;
+			offset += num;
+		}
+		for (uint i = 0; i < count; ++i) {
+			uint dst = histogram[(srcKeys[i] >> (d * 8)) & 0xff]++;
+			dstKeys[dst] = srcKeys[i];
+			dstValues[dst] = srcValues[i];
+		}
+
+		u64* swapKeys = srcKeys; srcKeys = dstKeys; dstKeys = swapKeys;
+		uint* swapValues = srcValues; srcValues = dstValues; dstValues = swapValues;
+	}
+
+	if (srcKeys != keys) {
+		memcpy(keys, srcKeys, count * sizeof(u64));
+		memcpy(values, srcValues, count * sizeof(uint));
+	}
+}
@@ -0,0 +1,11 @@
+#ifndef RADIX_SORT_H_
+#define RADIX_SORT_H_
+
+#include "../constants/constants.h"
+
+// LSD radix sort of keys with their values, 8 bits per pass,
+//   passes where all keys share the same digit are skipped,
+//   tmpKeys & tmpValues must hold count items, result ends in keys & values
+void RadixSort(u64* keys, uint* values, uint count, u64* tmpKeys, uint* tmpValues);
+
+#endif
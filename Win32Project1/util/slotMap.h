@@ -0,0 +1,139 @@
+#ifndef SLOT_MAP_H_
+#define SLOT_MAP_H_
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <assert.h>
+#include "../constants/constants.h"
+
+// Handle layout: low bits slot index, high bits generation of that slot
+#define SLOT_INDEX_BITS 20
+#define SLOT_INDEX_MASK ((1 << SLOT_INDEX_BITS) - 1)
+#define SLOT_GENERATION_MASK ((1 << (32 - SLOT_INDEX_BITS)) - 1)
+#define SLOT_CHUNK_BITS 10
+#define SLOT_CHUNK_SIZE (1 << SLOT_CHUNK_BITS)
+#define SLOT_CHUNK_COUNT (1 << (SLOT_INDEX_BITS - SLOT_CHUNK_BITS))
+#define INVALID_HANDLE 0
+
+// Values kept contiguous for iteration, removal moves the last value into the hole,
+//   a removed slot increases its generation so old handles to it become stale.
+//   Slots live in chunks that never move, so get & contains read them without lock,
+//   T must fit std::atomic (pointers). add & remove lock since objects & nodes
+//   are created and deleted on several threads, iterating values directly
+//   is only safe while nothing is added or removed
+template <typename T>
+class SlotMap {
+private:
+	struct Slot {
+		std::atomic<uint> generation; // Never 0 so no valid handle is 0
+		std::atomic<T> value;
+		uint denseIndex; // Index into values, writers only
+	};
+	std::atomic<Slot*> chunks[SLOT_CHUNK_COUNT];
+	uint slotCount;
+	std::vector<uint> freeSlots;
+	std::mutex lock;
+private:
+	Slot* findSlot(uint slot) const {
+		Slot* chunk = chunks[slot >> SLOT_CHUNK_BITS].load(std::memory_order_acquire);
+		return chunk ? &chunk[slot & (SLOT_CHUNK_SIZE - 1)] : NULL;
+	}
+public:
+	std::vector<T> values;
+	std::vector<uint> handles; // Handle of each value, same order as values
+public:
+	SlotMap() {
+		for (int i = 0; i < SLOT_CHUNK_COUNT; i++) chunks[i].store(NULL, std::memory_order_relaxed);
+		slotCount = 0;
+	}
+	~SlotMap() { clear(); }
+
+	uint add(const T& value) {
+		std::lock_guard<std::mutex> guard(lock);
+		uint slot;
+		Slot* entry = NULL;
+		if (freeSlots.size() > 0) {
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+			entry = findSlot(slot);
+		} else {
+			slot = slotCount;
+			assert(slot <= SLOT_INDEX_MASK); // Out of slots, raise SLOT_INDEX_BITS
+			if (slot > SLOT_INDEX_MASK) return INVALID_HANDLE;
+			if ((slot & (SLOT_CHUNK_SIZE - 1)) == 0) {
+				Slot* chunk = new Slot[SLOT_CHUNK_SIZE];
+				for (int i = 0; i < SLOT_CHUNK_SIZE; i++) {
+					chunk[i].generation.store(1, std::memory_order_relaxed);
+					chunk[i].value.store(T(), std::memory_order_relaxed);
+				}
+				chunks[slot >> SLOT_CHUNK_BITS].store(chunk, std::memory_order_release);
+			}
+			slotCount++;
+			entry = findSlot(slot);
+		}
+		// Handle is not seen by readers before add returns, so value needs no ordering with it
+		entry->value.store(value, std::memory_order_release);
+		entry->denseIndex = values.size();
+		uint handle = (entry->generation.load(std::memory_order_relaxed) << SLOT_INDEX_BITS) | slot;
+		values.push_back(value);
+		handles.push_back(handle);
+		return handle;
+	}
+
+	bool contains(uint handle) const {
+		Slot* entry = findSlot(handle & SLOT_INDEX_MASK);
+		return entry && entry->generation.load(std::memory_order_acquire) == (handle >> SLOT_INDEX_BITS);
+	}
+
+	// Copy of the value, false if handle is stale. Generation is read again after value,
+	//   so a slot removed & reused in between is not taken for the handle's one
+	bool get(uint handle, T& value) const {
+		Slot* entry = findSlot(handle & SLOT_INDEX_MASK);
+		uint generation = handle >> SLOT_INDEX_BITS;
+		if (!entry || entry->generation.load(std::memory_order_acquire) != generation) return false;
+		T found = entry->value.load(std::memory_order_acquire);
+		if (entry->generation.load(std::memory_order_acquire) != generation) return false;
+		value = found;
+		return true;
+	}
+
+	bool remove(uint handle) {
+		std::lock_guard<std::mutex> guard(lock);
+		if (!contains(handle)) return false;
+		uint slot = handle & SLOT_INDEX_MASK;
+		Slot* entry = findSlot(slot);
+		uint generation = (entry->generation.load(std::memory_order_relaxed) + 1) & SLOT_GENERATION_MASK;
+		entry->generation.store(generation == 0 ? 1 : generation, std::memory_order_release);
+		entry->value.store(T(), std::memory_order_release);
+
+		uint index = entry->denseIndex, last = values.size() - 1;
+		if (index != last) {
+			values[index] = values[last];
+			handles[index] = handles[last];
+			findSlot(handles[index] & SLOT_INDEX_MASK)->denseIndex = index;
+		}
+		values.pop_back();
+		handles.pop_back();
+		freeSlots.push_back(slot);
+		return true;
+	}
+
+	uint size() const { return values.size(); }
+
+	// No reader may be running
+	void clear() {
+		std::lock_guard<std::mutex> guard(lock);
+		for (int i = 0; i < SLOT_CHUNK_COUNT; i++) {
+			Slot* chunk = chunks[i].load(std::memory_order_relaxed);
+			if (chunk) delete[] chunk;
+			chunks[i].store(NULL, std::memory_order_relaxed);
+		}
+		slotCount = 0;
+		freeSlots.clear();
+		values.clear();
+		handles.clear();
+	}
+};
+
+#endif
@@ -353,6 +353,11 @@ struct ConfigArg {
 	bool dynsky;
 	bool cartoon;
 	bool debug;
+	bool partition;
+	bool coherentcull;
+	int frameDepth;
+	float updateBudget;
+	int triBudget;
 };
 
 #endif /* UTIL_H_ */